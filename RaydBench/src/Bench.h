@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Core/Core.h"
+
+class BenchTimer {
+public:
+	BenchTimer() : m_Start(std::chrono::high_resolution_clock::now()) {}
+	inline double ElapsedMs() const { return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_Start).count(); }
+private:
+	std::chrono::high_resolution_clock::time_point m_Start;
+};
+
+//Each suite takes the arguments after its name and returns the process exit code
+int RunMeshLoadBench(const std::vector<std::string>& args);
+int RunObjImportBench(const std::vector<std::string>& args);
+int RunMeshOptimizeBench(const std::vector<std::string>& args);
+int RunMeshLodBench(const std::vector<std::string>& args);
+int RunTextureCompressBench(const std::vector<std::string>& args);
+int RunTextureMipsBench(const std::vector<std::string>& args);
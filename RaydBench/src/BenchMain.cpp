@@ -0,0 +1,34 @@
+#include "raydpch.h"
+#include "Bench.h"
+
+struct BenchSuite {
+	const char* Name;
+	const char* Usage;
+	int (*Run)(const std::vector<std::string>& args);
+};
+
+static const BenchSuite s_Suites[] = {
+	{ "mesh-load", "mesh-load [iterations] <model.obj>...", RunMeshLoadBench },
+	{ "obj-import", "obj-import [iterations] [--threads N] [model.obj]...", RunObjImportBench },
+	{ "mesh-optimize", "mesh-optimize [model.obj]...", RunMeshOptimizeBench },
+	{ "mesh-lod", "mesh-lod [model.obj]...", RunMeshLodBench },
+	{ "texture-compress", "texture-compress [--threads N] <image>...", RunTextureCompressBench },
+	{ "texture-mips", "texture-mips [iterations] <image>...", RunTextureMipsBench }
+};
+
+int main(int argc, char** argv)
+{
+	Log::Init();
+
+	if (argc > 1) {
+		std::vector<std::string> args(argv + 2, argv + argc);
+		for (auto& suite : s_Suites)
+			if (suite.Name == std::string(argv[1]))
+				return suite.Run(args);
+	}
+
+	RAYD_INFO("Usage: RaydBench <suite> [args]");
+	for (auto& suite : s_Suites)
+		RAYD_INFO("  {0}", suite.Usage);
+	return 1;
+}
@@ -0,0 +1,68 @@
+#include "raydpch.h"
+#include "Bench.h"
+
+#include "Asset/ObjImporter.h"
+#include "Asset/MeshCache.h"
+
+//Measures the time from file to bytes ready in staging memory, which is all Model does before recording copies
+int RunMeshLoadBench(const std::vector<std::string>& args)
+{
+	uint32_t iterations = 5;
+	std::vector<std::string> paths;
+	for (auto& arg : args) {
+		if (!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit))
+			iterations = std::max(1, std::stoi(arg));
+		else
+			paths.push_back(arg);
+	}
+	if (paths.empty())
+		paths.push_back("Raydriarch/res/models/viking_room/viking_room.obj");
+
+	std::vector<char> staging;
+	RAYD_INFO("{0:<40} | {1:>9} | {2:>9} | {3:>10} | {4:>10} | {5:>8}", "model", "vertices", "indices", "obj ms", "cache ms", "speedup");
+	for (auto& path : paths) {
+		double objMs = std::numeric_limits<double>::max();
+		MeshData mesh;
+		for (uint32_t i = 0; i < iterations; i++) {
+			BenchTimer timer;
+			if (!ObjImporter::Import(path, mesh))
+				return 1;
+			staging.resize(mesh.Vertices.size() * sizeof(MeshVertex) + mesh.Indices.size() * sizeof(uint32_t));
+			memcpy(staging.data(), mesh.Vertices.data(), mesh.Vertices.size() * sizeof(MeshVertex));
+			memcpy(staging.data() + mesh.Vertices.size() * sizeof(MeshVertex), mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+			objMs = std::min(objMs, timer.ElapsedMs());
+		}
+
+		//Bake exactly what Model would, so the cache stays usable by the engine
+		VertexFormat format;
+		PackedMesh packed;
+		std::string cachePath = MeshCache::GetCachePath(path);
+		if (!MeshCache::Bake(path, format, packed)) {
+			RAYD_ERROR("Failed to bake {0}", cachePath);
+			return 1;
+		}
+
+		//Best of N, so the cache numbers reflect a warm page cache just like the OBJ reads do
+		double cacheMs = std::numeric_limits<double>::max();
+		for (uint32_t i = 0; i < iterations; i++) {
+			BenchTimer timer;
+			MeshCache cache(cachePath, path, format);
+			if (!cache.IsValid()) {
+				RAYD_ERROR("Cache {0} failed validation", cachePath);
+				return 1;
+			}
+			auto& header = cache.GetHeader();
+			size_t vertexBytes = static_cast<size_t>(header.VertexCount) * header.VertexStride;
+			size_t indexBytes = static_cast<size_t>(header.IndexCount) * sizeof(uint32_t);
+			staging.resize(vertexBytes + indexBytes);
+			memcpy(staging.data(), cache.GetVertices(), vertexBytes);
+			memcpy(staging.data() + vertexBytes, cache.GetIndices(), indexBytes);
+			cacheMs = std::min(cacheMs, timer.ElapsedMs());
+		}
+
+		RAYD_INFO("{0:<40} | {1:>9} | {2:>9} | {3:>10.3f} | {4:>10.3f} | {5:>7.1f}x", std::filesystem::path(path).filename().string(),
+			mesh.Vertices.size(), mesh.Indices.size(), objMs, cacheMs, objMs / cacheMs);
+	}
+
+	return 0;
+}
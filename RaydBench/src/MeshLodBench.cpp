@@ -0,0 +1,109 @@
+#include "raydpch.h"
+#include "Bench.h"
+
+#include "Asset/ObjImporter.h"
+#include "Asset/MeshOptimizer.h"
+#include "Asset/MeshSimplifier.h"
+
+//Checked-in fixture every run starts with, so a change in the simplifier's output between builds fails even without a model
+#define LOD_FIXTURE_PATH "RaydBench/res/lod_sphere.obj"
+//Triangles per level the fixture simplified to when its output was last reviewed; update them only for an intended change
+static const uint32_t s_FixtureTriangles[] = { 960, 480, 368 };
+
+//Triangle rotated to start at its smallest index, so the same triangle compares equal however it was rotated
+static std::array<uint32_t, 3> GetTriangleKey(const uint32_t* triangle)
+{
+	uint32_t first = 0;
+	for (uint32_t k = 1; k < 3; k++)
+		if (triangle[k] < triangle[first])
+			first = k;
+	return { triangle[first], triangle[(first + 1) % 3], triangle[(first + 2) % 3] };
+}
+
+//Triangles of a level that its source, the level it was simplified from, does not have and that face away from the source
+//surface at all three of their corners; what a collapse that turned them inside out leaves behind. Triangles carried over
+//unchanged are skipped, since a fold already in the source is not the simplifier's doing.
+static uint32_t CountReversedTriangles(const MeshData& mesh, const MeshLod& lod, const MeshLod& source)
+{
+	std::vector<glm::vec3> sourceNormals(mesh.Vertices.size(), glm::vec3(0.0f));
+	std::set<std::array<uint32_t, 3>> sourceTriangles;
+	for (uint32_t i = source.FirstIndex; i < source.FirstIndex + source.IndexCount; i += 3) {
+		const uint32_t* triangle = &mesh.Indices[i];
+		glm::vec3 normal = glm::cross(mesh.Vertices[triangle[1]].Position - mesh.Vertices[triangle[0]].Position,
+			mesh.Vertices[triangle[2]].Position - mesh.Vertices[triangle[0]].Position);
+		for (uint32_t k = 0; k < 3; k++)
+			sourceNormals[triangle[k]] += normal;
+		sourceTriangles.insert(GetTriangleKey(triangle));
+	}
+
+	uint32_t reversed = 0;
+	for (uint32_t i = lod.FirstIndex; i < lod.FirstIndex + lod.IndexCount; i += 3) {
+		const uint32_t* triangle = &mesh.Indices[i];
+		if (sourceTriangles.count(GetTriangleKey(triangle)))
+			continue;
+
+		glm::vec3 normal = glm::cross(mesh.Vertices[triangle[1]].Position - mesh.Vertices[triangle[0]].Position,
+			mesh.Vertices[triangle[2]].Position - mesh.Vertices[triangle[0]].Position);
+		bool facesAway = true;
+		for (uint32_t k = 0; k < 3 && facesAway; k++)
+			facesAway = glm::dot(normal, sourceNormals[triangle[k]]) < 0.0f;
+		reversed += facesAway;
+	}
+	return reversed;
+}
+
+//Reports each LOD's triangle count and error and what the chain costs at bake time. Exits with 1 when a second run does
+//not reproduce the chain, a level holds a reversed triangle, or the fixture no longer simplifies to its golden counts
+int RunMeshLodBench(const std::vector<std::string>& args)
+{
+	std::vector<std::string> paths = { LOD_FIXTURE_PATH };
+	paths.insert(paths.end(), args.begin(), args.end());
+
+	int result = 0;
+	for (auto& path : paths) {
+		MeshData mesh;
+		if (!ObjImporter::Import(path, mesh))
+			return 1;
+		MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+		std::string name = std::filesystem::path(path).filename().string();
+		MeshData first = mesh;
+		std::vector<MeshLod> lods;
+		BenchTimer timer;
+		MeshSimplifier::GenerateLods(first, lods, name);
+		double ms = timer.ElapsedMs();
+
+		MeshData second = mesh;
+		std::vector<MeshLod> repeatLods;
+		MeshSimplifier::GenerateLods(second, repeatLods, name);
+		bool deterministic = first.Indices == second.Indices;
+		if (!deterministic)
+			result = 1;
+
+		RAYD_INFO("{0:<24} | {1:>3} | {2:>9} | {3:>6} | {4:>10} | {5:>10} | {6:>8}", "model", "lod", "triangles", "%", "error/r", "ACMR", "reversed");
+		for (size_t level = 0; level < lods.size(); level++) {
+			const MeshLod& lod = lods[level];
+			VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(first.Indices.data() + lod.FirstIndex, lod.IndexCount, first.Vertices.size());
+			uint32_t reversed = level > 0 ? CountReversedTriangles(first, lod, lods[level - 1]) : 0;
+			RAYD_INFO("{0:<24} | {1:>3} | {2:>9} | {3:>6.1f} | {4:>10.6f} | {5:>10.3f} | {6:>8}", name, level, lod.IndexCount / 3,
+				100.0 * lod.IndexCount / lods[0].IndexCount, mesh.Bounds.Radius > 0.0f ? lod.Error / mesh.Bounds.Radius : 0.0f, stats.ACMR, reversed);
+			if (reversed > 0) {
+				RAYD_ERROR("{0}: LOD {1} has {2} triangles reversed against LOD {3}", name, level, reversed, level - 1);
+				result = 1;
+			}
+		}
+		RAYD_INFO("{0}: chain generated in {1:.3f} ms, {2}", name, ms, deterministic ? "deterministic" : "NOT deterministic");
+
+		if (path == LOD_FIXTURE_PATH) {
+			bool golden = lods.size() == std::size(s_FixtureTriangles);
+			for (size_t level = 0; golden && level < lods.size(); level++)
+				golden = lods[level].IndexCount / 3 == s_FixtureTriangles[level];
+			if (!golden) {
+				RAYD_ERROR("{0}: LOD triangle counts no longer match the golden ones in MeshLodBench.cpp", name);
+				result = 1;
+			}
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,93 @@
+#include "raydpch.h"
+#include "Bench.h"
+
+#include "Asset/ObjImporter.h"
+#include "Asset/MeshOptimizer.h"
+
+//Every triangle as the bytes of its three vertices, rotated to start at the smallest one and sorted, so two meshes compare
+//equal when they draw the same triangles with the same winding however indices and vertices were reordered
+static std::vector<std::string> GetTriangleKeys(const MeshData& mesh)
+{
+	std::vector<std::string> keys(mesh.Indices.size() / 3);
+	for (size_t t = 0; t < keys.size(); t++) {
+		const uint32_t* triangle = &mesh.Indices[t * 3];
+		uint32_t first = 0;
+		for (uint32_t k = 1; k < 3; k++)
+			if (memcmp(&mesh.Vertices[triangle[k]], &mesh.Vertices[triangle[first]], sizeof(MeshVertex)) < 0)
+				first = k;
+		for (uint32_t k = 0; k < 3; k++)
+			keys[t].append(reinterpret_cast<const char*>(&mesh.Vertices[triangle[(first + k) % 3]]), sizeof(MeshVertex));
+	}
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+//After the fetch pass every vertex is referenced and they are numbered in the order the indices first use them
+static bool IsFirstUseOrder(const MeshData& mesh)
+{
+	uint32_t next = 0;
+	for (uint32_t index : mesh.Indices) {
+		if (index > next)
+			return false;
+		if (index == next)
+			next++;
+	}
+	return next == mesh.Vertices.size();
+}
+
+//Reports the simulated post-transform cache behaviour after each optimization pass and what each pass costs at bake time.
+//Exits with 1 when a pass drops or flips a triangle, the vertex cache pass makes ACMR worse, or the fetch pass changes
+//the cache behaviour or leaves vertices out of first-use order
+int RunMeshOptimizeBench(const std::vector<std::string>& args)
+{
+	std::vector<std::string> paths = args;
+	if (paths.empty())
+		paths.push_back("Raydriarch/res/models/viking_room/viking_room.obj");
+
+	int result = 0;
+	RAYD_INFO("{0:<24} | {1:<14} | {2:>9} | {3:>6} | {4:>6} | {5:>6} | {6:>6} | {7:>10}", "model", "stage", "vertices", "ACMR", "ATVR", "ACMR32", "ATVR32", "ms");
+	for (auto& path : paths) {
+		MeshData mesh;
+		if (!ObjImporter::Import(path, mesh))
+			return 1;
+
+		std::string name = std::filesystem::path(path).filename().string();
+		std::vector<std::string> triangles = GetTriangleKeys(mesh);
+		auto report = [&](const char* stage, double ms) {
+			VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+			VertexCacheStats large = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size(), 32);
+			RAYD_INFO("{0:<24} | {1:<14} | {2:>9} | {3:>6.3f} | {4:>6.3f} | {5:>6.3f} | {6:>6.3f} | {7:>10.3f}", name, stage,
+				mesh.Vertices.size(), stats.ACMR, stats.ATVR, large.ACMR, large.ATVR, ms);
+			if (GetTriangleKeys(mesh) != triangles) {
+				RAYD_ERROR("{0}: {1} pass changed the triangles", name, stage);
+				result = 1;
+			}
+			return stats;
+		};
+
+		VertexCacheStats imported = report("imported", 0.0);
+
+		BenchTimer cacheTimer;
+		MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+		VertexCacheStats cached = report("vertex cache", cacheTimer.ElapsedMs());
+		if (cached.Transformed > imported.Transformed) {
+			RAYD_ERROR("{0}: vertex cache pass raised ACMR from {1:.3f} to {2:.3f}", name, imported.ACMR, cached.ACMR);
+			result = 1;
+		}
+
+		BenchTimer overdrawTimer;
+		MeshOptimizer::OptimizeOverdraw(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.data(), mesh.Vertices.size());
+		VertexCacheStats overdraw = report("overdraw", overdrawTimer.ElapsedMs());
+
+		BenchTimer fetchTimer;
+		mesh.Vertices.resize(MeshOptimizer::OptimizeVertexFetch(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size()));
+		VertexCacheStats fetched = report("vertex fetch", fetchTimer.ElapsedMs());
+		//Renumbering vertices must not change which ones the cache holds
+		if (fetched.Transformed != overdraw.Transformed || !IsFirstUseOrder(mesh)) {
+			RAYD_ERROR("{0}: vertex fetch pass changed the cache behaviour or left vertices out of first-use order", name);
+			result = 1;
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,122 @@
+#include "raydpch.h"
+#include "Bench.h"
+
+#include "Asset/ObjImporter.h"
+#include "Core/ThreadPool.h"
+
+//Writes a UV sphere with (segments + 1)^2 positions and texcoords and 2 * segments^2 triangles
+static bool WriteSphereObj(const std::string& path, uint32_t segments)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	const float pi = 3.14159265358979f;
+	char line[128];
+	for (uint32_t i = 0; i <= segments; i++) {
+		for (uint32_t j = 0; j <= segments; j++) {
+			float theta = 2.0f * pi * i / segments, phi = pi * j / segments;
+			int length = snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", cosf(theta) * sinf(phi), sinf(theta) * sinf(phi), cosf(phi));
+			file.write(line, length);
+		}
+	}
+	for (uint32_t i = 0; i <= segments; i++) {
+		for (uint32_t j = 0; j <= segments; j++) {
+			int length = snprintf(line, sizeof(line), "vt %.6f %.6f\n", float(i) / segments, float(j) / segments);
+			file.write(line, length);
+		}
+	}
+	for (uint32_t i = 0; i < segments; i++) {
+		for (uint32_t j = 0; j < segments; j++) {
+			uint32_t a = i * (segments + 1) + j + 1, b = a + 1, c = a + segments + 1, d = c + 1;
+			int length = snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u\nf %u/%u %u/%u %u/%u\n", a, a, c, c, d, d, a, a, d, d, b, b);
+			file.write(line, length);
+		}
+	}
+	return static_cast<bool>(file);
+}
+
+static bool SameMesh(const MeshData& a, const MeshData& b)
+{
+	return a.Vertices.size() == b.Vertices.size() && a.Indices == b.Indices &&
+		memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(MeshVertex)) == 0;
+}
+
+//Compares the tinyobjloader importer against the chunked one on one thread and on every worker
+int RunObjImportBench(const std::vector<std::string>& args)
+{
+	uint32_t iterations = 5;
+	uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < args.size(); i++) {
+		if (args[i] == "--threads" && i + 1 < args.size())
+			threadCount = std::max(1, std::stoi(args[++i]));
+		else if (!args[i].empty() && std::all_of(args[i].begin(), args[i].end(), ::isdigit))
+			iterations = std::max(1, std::stoi(args[i]));
+		else
+			paths.push_back(args[i]);
+	}
+
+	if (paths.empty()) {
+		auto directory = std::filesystem::temp_directory_path() / "raydbench_models";
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		for (uint32_t segments : { 128u, 384u, 1024u }) {
+			std::string path = (directory / ("sphere_" + std::to_string(segments) + ".obj")).string();
+			if (!std::filesystem::exists(path) && !WriteSphereObj(path, segments)) {
+				RAYD_ERROR("Failed to write {0}", path);
+				return 1;
+			}
+			paths.push_back(path);
+		}
+	}
+
+	ThreadPool workers(threadCount);
+	struct Importer {
+		std::string Name;
+		std::function<bool(const std::string&, MeshData&)> Run;
+	};
+	const Importer importers[] = {
+		{ "tinyobj", [](const std::string& path, MeshData& mesh) { return ObjImporter::ImportReference(path, mesh); } },
+		{ "chunked x1", [](const std::string& path, MeshData& mesh) { return ObjImporter::Import(path, mesh); } },
+		{ "chunked x" + std::to_string(threadCount), [&workers](const std::string& path, MeshData& mesh) { return ObjImporter::Import(path, mesh, &workers); } }
+	};
+
+	RAYD_INFO("{0:<24} | {1:<12} | {2:>9} | {3:>9} | {4:>10} | {5:>9} | {6:>11} | {7:>8}", "model", "importer", "MB", "vertices", "ms", "MB/s", "Mvertices/s", "speedup");
+	for (auto& path : paths) {
+		std::error_code error;
+		double megabytes = std::filesystem::file_size(path, error) / (1024.0 * 1024.0);
+		if (error) {
+			RAYD_ERROR("Failed to stat {0}", path);
+			return 1;
+		}
+
+		MeshData reference;
+		double referenceMs = 0.0;
+		for (auto& importer : importers) {
+			double bestMs = std::numeric_limits<double>::max();
+			MeshData mesh;
+			for (uint32_t i = 0; i < iterations; i++) {
+				BenchTimer timer;
+				if (!importer.Run(path, mesh))
+					return 1;
+				bestMs = std::min(bestMs, timer.ElapsedMs());
+			}
+
+			if (&importer == &importers[0]) {
+				reference = std::move(mesh);
+				referenceMs = bestMs;
+			}
+			else if (!SameMesh(reference, mesh)) {
+				RAYD_ERROR("{0} produced a different mesh than the reference for {1}", importer.Name, path);
+				return 1;
+			}
+
+			size_t vertices = (&importer == &importers[0] ? reference : mesh).Vertices.size();
+			RAYD_INFO("{0:<24} | {1:<12} | {2:>9.2f} | {3:>9} | {4:>10.3f} | {5:>9.1f} | {6:>11.2f} | {7:>7.1f}x", std::filesystem::path(path).filename().string(),
+				importer.Name, megabytes, vertices, bestMs, megabytes * 1000.0 / bestMs, vertices / (bestMs * 1000.0), referenceMs / bestMs);
+		}
+	}
+
+	return 0;
+}
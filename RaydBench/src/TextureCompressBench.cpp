@@ -0,0 +1,87 @@
+#include "raydpch.h"
+#include "Bench.h"
+
+#include "Asset/BlockCompressor.h"
+#include "Core/ThreadPool.h"
+
+#include <stb_image.h>
+
+static double ComputePsnr(const TextureLevel& a, const TextureLevel& b, uint32_t channelCount)
+{
+	double error = 0.0;
+	for (size_t i = 0; i < a.Pixels.size(); i += 4)
+		for (uint32_t c = 0; c < channelCount; c++) {
+			double d = static_cast<double>(a.Pixels[i + c]) - b.Pixels[i + c];
+			error += d * d;
+		}
+
+	double mse = error / (static_cast<double>(a.Width) * a.Height * channelCount);
+	return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+//Encodes the base level of each image in every format and reports size, encode time on one thread and on every worker,
+//and the PSNR of the decoded result over the channels the format keeps
+int RunTextureCompressBench(const std::vector<std::string>& args)
+{
+	uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < args.size(); i++) {
+		if (args[i] == "--threads" && i + 1 < args.size())
+			threadCount = std::max(1, std::stoi(args[++i]));
+		else
+			paths.push_back(args[i]);
+	}
+
+	if (paths.empty()) {
+		RAYD_ERROR("texture-compress needs at least one image");
+		return 1;
+	}
+
+	ThreadPool workers(threadCount);
+	const std::pair<TextureFormat, uint32_t> formats[] = {
+		{ TextureFormat::BC1, 3 }, { TextureFormat::BC3, 4 }, { TextureFormat::BC5, 2 }, { TextureFormat::BC7, 4 }
+	};
+
+	int result = 0;
+	RAYD_INFO("{0:<24} | {1:<6} | {2:>9} | {3:>9} | {4:>10} | {5:>10} | {6:>7}", "image", "format", "MB", "RGBA8 MB", "ms x1",
+		"ms x" + std::to_string(threadCount), "PSNR");
+	for (auto& path : paths) {
+		int32_t width = 0, height = 0, channelCount = 0;
+		stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channelCount, STBI_rgb_alpha);
+		if (!pixels) {
+			RAYD_ERROR("Failed to load {0}", path);
+			return 1;
+		}
+
+		TextureLevel source{ static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+			std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(width) * height * 4) };
+		stbi_image_free(pixels);
+
+		std::string name = std::filesystem::path(path).filename().string();
+		for (auto& [format, keptChannels] : formats) {
+			std::vector<uint8_t> serial(GetTextureLevelSize(format, source.Width, source.Height));
+			BenchTimer serialTimer;
+			BlockCompressor::Compress(source, format, serial.data());
+			double serialMs = serialTimer.ElapsedMs();
+
+			std::vector<uint8_t> parallel(serial.size());
+			BenchTimer parallelTimer;
+			BlockCompressor::Compress(source, format, parallel.data(), &workers);
+			double parallelMs = parallelTimer.ElapsedMs();
+
+			//Rows are encoded independently, so the thread count must not change a single byte
+			if (serial != parallel) {
+				RAYD_ERROR("{0}: {1} output differs between one and {2} threads", name, GetTextureFormatName(format), threadCount);
+				result = 1;
+			}
+
+			TextureLevel decoded{ source.Width, source.Height, {} };
+			BlockCompressor::Decompress(serial.data(), format, decoded);
+			RAYD_INFO("{0:<24} | {1:<6} | {2:>9.3f} | {3:>9.3f} | {4:>10.2f} | {5:>10.2f} | {6:>7.2f}", name, GetTextureFormatName(format),
+				serial.size() / (1024.0 * 1024.0), source.Pixels.size() / (1024.0 * 1024.0), serialMs, parallelMs,
+				ComputePsnr(source, decoded, keptChannels));
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,74 @@
+#include "raydpch.h"
+#include "Bench.h"
+
+#include "Asset/MipGenerator.h"
+
+#include <stb_image.h>
+
+//Builds the mip chain of each image on one thread with every filter path the CPU supports, reporting the best time of
+//the given iterations, and checks the vector paths reproduce the scalar chain byte for byte
+int RunTextureMipsBench(const std::vector<std::string>& args)
+{
+	uint32_t iterations = 5;
+	size_t first = 0;
+	if (!args.empty() && std::all_of(args[0].begin(), args[0].end(), ::isdigit)) {
+		iterations = std::max(1, std::stoi(args[0]));
+		first = 1;
+	}
+
+	if (first >= args.size()) {
+		RAYD_ERROR("texture-mips needs at least one image");
+		return 1;
+	}
+
+	int result = 0;
+	RAYD_INFO("{0:<24} | {1:<6} | {2:<6} | {3:>6} | {4:>10} | {5:>8}", "image", "space", "path", "levels", "ms", "speedup");
+	for (size_t i = first; i < args.size(); i++) {
+		int32_t width = 0, height = 0, channelCount = 0;
+		stbi_uc* pixels = stbi_load(args[i].c_str(), &width, &height, &channelCount, STBI_rgb_alpha);
+		if (!pixels) {
+			RAYD_ERROR("Failed to load {0}", args[i]);
+			return 1;
+		}
+
+		TextureLevel base{ static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+			std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(width) * height * 4) };
+		stbi_image_free(pixels);
+
+		std::string name = std::filesystem::path(args[i]).filename().string();
+		for (bool srgb : { true, false }) {
+			TextureData reference;
+			double scalarMs = 0.0;
+			for (uint32_t level = 0; level <= static_cast<uint32_t>(MipGenerator::GetSupportedLevel()); level++) {
+				SimdLevel simd = static_cast<SimdLevel>(level);
+				TextureData texture;
+				double bestMs = std::numeric_limits<double>::max();
+				for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+					texture.Levels.assign(1, base);
+					BenchTimer timer;
+					MipGenerator::Generate(texture, srgb, simd);
+					bestMs = std::min(bestMs, timer.ElapsedMs());
+				}
+
+				if (simd == SimdLevel::Scalar) {
+					reference = std::move(texture);
+					scalarMs = bestMs;
+				}
+				else {
+					bool same = reference.Levels.size() == texture.Levels.size();
+					for (size_t mip = 0; same && mip < texture.Levels.size(); mip++)
+						same = reference.Levels[mip].Pixels == texture.Levels[mip].Pixels;
+					if (!same) {
+						RAYD_ERROR("{0}: {1} mip chain differs from scalar", name, MipGenerator::GetLevelName(simd));
+						result = 1;
+					}
+				}
+
+				RAYD_INFO("{0:<24} | {1:<6} | {2:<6} | {3:>6} | {4:>10.2f} | {5:>7.2f}x", name, srgb ? "sRGB" : "linear",
+					MipGenerator::GetLevelName(simd), reference.Levels.size(), bestMs, scalarMs / bestMs);
+			}
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,545 @@
+#include "raydpch.h"
+#include "BlockCompressor.h"
+
+#define BLOCK_TEXELS 16
+//Power iterations spent finding a block's principal axis
+#define BLOCK_AXIS_ITERATIONS 8
+
+//Interpolation weights of BC7's 4-bit indices, out of 64
+static const uint32_t s_BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BitWriter {
+	uint8_t* Block;
+	uint32_t Position;
+
+	void Write(uint32_t value, uint32_t count) {
+		for (uint32_t i = 0; i < count; i++, Position++)
+			if ((value >> i) & 1)
+				Block[Position >> 3] |= static_cast<uint8_t>(1 << (Position & 7));
+	}
+};
+
+struct BitReader {
+	const uint8_t* Block;
+	uint32_t Position;
+
+	uint32_t Read(uint32_t count) {
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < count; i++, Position++)
+			value |= ((Block[Position >> 3] >> (Position & 7)) & 1u) << i;
+		return value;
+	}
+};
+
+static inline uint32_t SquaredDistance(const uint32_t* a, const uint8_t* b, uint32_t channelCount)
+{
+	uint32_t distance = 0;
+	for (uint32_t c = 0; c < channelCount; c++) {
+		int32_t d = static_cast<int32_t>(a[c]) - b[c];
+		distance += d * d;
+	}
+	return distance;
+}
+
+//Ends of the segment through the block's texels along their principal axis, over the first channelCount channels
+static void FitAxis(const uint8_t* texels, uint32_t channelCount, float* low, float* high)
+{
+	float mean[4] = {};
+	float minimum[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	float maximum[4] = {};
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		for (uint32_t c = 0; c < channelCount; c++) {
+			mean[c] += texels[i * 4 + c];
+			minimum[c] = std::min(minimum[c], static_cast<float>(texels[i * 4 + c]));
+			maximum[c] = std::max(maximum[c], static_cast<float>(texels[i * 4 + c]));
+		}
+	for (uint32_t c = 0; c < channelCount; c++)
+		mean[c] /= BLOCK_TEXELS;
+
+	float covariance[4][4] = {};
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		for (uint32_t a = 0; a < channelCount; a++)
+			for (uint32_t b = 0; b < channelCount; b++)
+				covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+
+	//Power iteration from the bounding box diagonal, which is already close for most blocks
+	float axis[4] = {};
+	for (uint32_t c = 0; c < channelCount; c++)
+		axis[c] = maximum[c] - minimum[c];
+	for (uint32_t iteration = 0; iteration < BLOCK_AXIS_ITERATIONS; iteration++) {
+		float next[4] = {};
+		float largest = 0.0f;
+		for (uint32_t a = 0; a < channelCount; a++) {
+			for (uint32_t b = 0; b < channelCount; b++)
+				next[a] += covariance[a][b] * axis[b];
+			largest = std::max(largest, std::abs(next[a]));
+		}
+		if (largest <= 0.0f)
+			break;
+		for (uint32_t c = 0; c < channelCount; c++)
+			axis[c] = next[c] / largest;
+	}
+
+	float length = 0.0f;
+	for (uint32_t c = 0; c < channelCount; c++)
+		length += axis[c] * axis[c];
+	length = std::sqrt(length);
+
+	//A flat block has no axis; both ends sit on its colour
+	float lowT = 0.0f, highT = 0.0f;
+	if (length > 0.0f) {
+		for (uint32_t c = 0; c < channelCount; c++)
+			axis[c] /= length;
+
+		lowT = std::numeric_limits<float>::max();
+		highT = std::numeric_limits<float>::lowest();
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+			float t = 0.0f;
+			for (uint32_t c = 0; c < channelCount; c++)
+				t += (texels[i * 4 + c] - mean[c]) * axis[c];
+			lowT = std::min(lowT, t);
+			highT = std::max(highT, t);
+		}
+	}
+
+	for (uint32_t c = 0; c < channelCount; c++) {
+		low[c] = std::clamp(mean[c] + lowT * axis[c], 0.0f, 255.0f);
+		high[c] = std::clamp(mean[c] + highT * axis[c], 0.0f, 255.0f);
+	}
+}
+
+//Endpoints minimizing the squared error of texels placed at the given fractions of the way from start to end; false when
+//the fractions cannot separate the two
+static bool FitEndpoints(const uint8_t* texels, const float* weights, uint32_t channelCount, float* start, float* end)
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		float b = weights[i];
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (uint32_t c = 0; c < channelCount; c++) {
+			ax[c] += a * texels[i * 4 + c];
+			bx[c] += b * texels[i * 4 + c];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (std::abs(determinant) < 1e-6f)
+		return false;
+
+	for (uint32_t c = 0; c < channelCount; c++) {
+		start[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+		end[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+static uint16_t PackRGB565(const float* color)
+{
+	uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+	uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+	uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, uint32_t* color)
+{
+	uint32_t r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void GetBC1Palette(uint16_t color0, uint16_t color1, bool fourColor, uint32_t palette[4][4])
+{
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+	for (uint32_t c = 0; c < 3; c++) {
+		if (fourColor) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	for (uint32_t i = 0; i < 4; i++)
+		palette[i][3] = 255;
+}
+
+static uint32_t AssignBC1Indices(const uint8_t* texels, uint16_t color0, uint16_t color1, uint32_t* indices)
+{
+	uint32_t palette[4][4];
+	GetBC1Palette(color0, color1, true, palette);
+
+	uint32_t error = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t best = std::numeric_limits<uint32_t>::max();
+		for (uint32_t p = 0; p < 4; p++) {
+			uint32_t distance = SquaredDistance(palette[p], &texels[i * 4], 3);
+			if (distance < best) {
+				best = distance;
+				indices[i] = p;
+			}
+		}
+		error += best;
+	}
+	return error;
+}
+
+//Colour half shared by BC1 and BC3, always in four-colour mode
+static void EncodeColorBlock(const uint8_t* texels, uint8_t* block)
+{
+	float low[4], high[4];
+	FitAxis(texels, 3, low, high);
+
+	uint16_t color0 = PackRGB565(high);
+	uint16_t color1 = PackRGB565(low);
+	uint32_t indices[BLOCK_TEXELS];
+	uint32_t error = AssignBC1Indices(texels, color0, color1, indices);
+
+	//Palette entries 2 and 3 sit a third and two thirds of the way to color1
+	static const float positions[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	float weights[BLOCK_TEXELS];
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		weights[i] = positions[indices[i]];
+	if (error > 0 && FitEndpoints(texels, weights, 3, high, low)) {
+		uint16_t refined0 = PackRGB565(high);
+		uint16_t refined1 = PackRGB565(low);
+		uint32_t refinedIndices[BLOCK_TEXELS];
+		uint32_t refinedError = AssignBC1Indices(texels, refined0, refined1, refinedIndices);
+		if (refinedError < error) {
+			color0 = refined0;
+			color1 = refined1;
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+	}
+
+	//Four-colour mode needs color0 > color1; swapping the ends swaps entries 0 and 1 and entries 2 and 3
+	if (color0 < color1) {
+		std::swap(color0, color1);
+		for (auto& index : indices)
+			index ^= 1;
+	}
+	else if (color0 == color1) {
+		for (auto& index : indices)
+			index = 0;
+	}
+
+	uint32_t bits = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		bits |= indices[i] << (i * 2);
+
+	block[0] = static_cast<uint8_t>(color0);
+	block[1] = static_cast<uint8_t>(color0 >> 8);
+	block[2] = static_cast<uint8_t>(color1);
+	block[3] = static_cast<uint8_t>(color1 >> 8);
+	memcpy(block + 4, &bits, sizeof(bits));
+}
+
+static void GetBC4Palette(uint32_t value0, uint32_t value1, uint32_t palette[8])
+{
+	palette[0] = value0;
+	palette[1] = value1;
+	if (value0 > value1) {
+		for (uint32_t i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+	}
+	else {
+		for (uint32_t i = 2; i < 6; i++)
+			palette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+//One channel at 3 bits per texel between its extremes, which are exact for a single channel
+static void EncodeChannelBlock(const uint8_t* texels, uint32_t channel, uint8_t* block)
+{
+	uint32_t lowest = 255, highest = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		lowest = std::min<uint32_t>(lowest, texels[i * 4 + channel]);
+		highest = std::max<uint32_t>(highest, texels[i * 4 + channel]);
+	}
+
+	uint64_t bits = 0;
+	if (highest > lowest) {
+		uint32_t palette[8];
+		GetBC4Palette(highest, lowest, palette);
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+			uint32_t best = 0;
+			uint32_t bestDistance = std::numeric_limits<uint32_t>::max();
+			for (uint32_t p = 0; p < 8; p++) {
+				int32_t d = static_cast<int32_t>(palette[p]) - texels[i * 4 + channel];
+				if (static_cast<uint32_t>(d * d) < bestDistance) {
+					bestDistance = d * d;
+					best = p;
+				}
+			}
+			bits |= static_cast<uint64_t>(best) << (i * 3);
+		}
+	}
+
+	block[0] = static_cast<uint8_t>(highest);
+	block[1] = static_cast<uint8_t>(lowest);
+	for (uint32_t i = 0; i < 6; i++)
+		block[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+}
+
+//7-bit endpoint plus the p-bit its four channels share as their lowest bit; both p-bits are tried
+static void QuantizeBC7Endpoint(const float* color, uint32_t* quantized, uint32_t& pbit)
+{
+	float bestError = std::numeric_limits<float>::max();
+	for (uint32_t p = 0; p < 2; p++) {
+		uint32_t candidate[4];
+		float error = 0.0f;
+		for (uint32_t c = 0; c < 4; c++) {
+			candidate[c] = static_cast<uint32_t>(std::clamp(std::lround((color[c] - p) * 0.5f), 0l, 127l));
+			float d = static_cast<float>((candidate[c] << 1) | p) - color[c];
+			error += d * d;
+		}
+		if (error < bestError) {
+			bestError = error;
+			pbit = p;
+			memcpy(quantized, candidate, sizeof(candidate));
+		}
+	}
+}
+
+static uint32_t AssignBC7Indices(const uint8_t* texels, const uint32_t* endpoint0, uint32_t pbit0, const uint32_t* endpoint1, uint32_t pbit1,
+	uint32_t* indices)
+{
+	uint32_t palette[16][4];
+	for (uint32_t i = 0; i < 16; i++)
+		for (uint32_t c = 0; c < 4; c++) {
+			uint32_t e0 = (endpoint0[c] << 1) | pbit0;
+			uint32_t e1 = (endpoint1[c] << 1) | pbit1;
+			palette[i][c] = ((64 - s_BC7Weights[i]) * e0 + s_BC7Weights[i] * e1 + 32) >> 6;
+		}
+
+	uint32_t error = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t best = std::numeric_limits<uint32_t>::max();
+		for (uint32_t p = 0; p < 16; p++) {
+			uint32_t distance = SquaredDistance(palette[p], &texels[i * 4], 4);
+			if (distance < best) {
+				best = distance;
+				indices[i] = p;
+			}
+		}
+		error += best;
+	}
+	return error;
+}
+
+void BlockCompressor::EncodeBC1(const uint8_t* texels, uint8_t* block)
+{
+	EncodeColorBlock(texels, block);
+}
+
+void BlockCompressor::EncodeBC3(const uint8_t* texels, uint8_t* block)
+{
+	EncodeChannelBlock(texels, 3, block);
+	EncodeColorBlock(texels, block + 8);
+}
+
+void BlockCompressor::EncodeBC5(const uint8_t* texels, uint8_t* block)
+{
+	EncodeChannelBlock(texels, 0, block);
+	EncodeChannelBlock(texels, 1, block + 8);
+}
+
+void BlockCompressor::EncodeBC7(const uint8_t* texels, uint8_t* block)
+{
+	float low[4], high[4];
+	FitAxis(texels, 4, low, high);
+
+	uint32_t endpoint0[4], endpoint1[4], pbit0, pbit1;
+	QuantizeBC7Endpoint(low, endpoint0, pbit0);
+	QuantizeBC7Endpoint(high, endpoint1, pbit1);
+	uint32_t indices[BLOCK_TEXELS];
+	uint32_t error = AssignBC7Indices(texels, endpoint0, pbit0, endpoint1, pbit1, indices);
+
+	float weights[BLOCK_TEXELS];
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		weights[i] = s_BC7Weights[indices[i]] / 64.0f;
+	if (error > 0 && FitEndpoints(texels, weights, 4, low, high)) {
+		uint32_t refined0[4], refined1[4], refinedPbit0, refinedPbit1;
+		QuantizeBC7Endpoint(low, refined0, refinedPbit0);
+		QuantizeBC7Endpoint(high, refined1, refinedPbit1);
+		uint32_t refinedIndices[BLOCK_TEXELS];
+		uint32_t refinedError = AssignBC7Indices(texels, refined0, refinedPbit0, refined1, refinedPbit1, refinedIndices);
+		if (refinedError < error) {
+			memcpy(endpoint0, refined0, sizeof(endpoint0));
+			memcpy(endpoint1, refined1, sizeof(endpoint1));
+			pbit0 = refinedPbit0;
+			pbit1 = refinedPbit1;
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+	}
+
+	//The first texel's index drops its top bit, so it must point into the first half of the palette
+	if (indices[0] & 8) {
+		std::swap(endpoint0, endpoint1);
+		std::swap(pbit0, pbit1);
+		for (auto& index : indices)
+			index = 15 - index;
+	}
+
+	memset(block, 0, 16);
+	BitWriter writer{ block, 0 };
+	writer.Write(1 << 6, 7);
+	for (uint32_t c = 0; c < 4; c++) {
+		writer.Write(endpoint0[c], 7);
+		writer.Write(endpoint1[c], 7);
+	}
+	writer.Write(pbit0, 1);
+	writer.Write(pbit1, 1);
+	writer.Write(indices[0], 3);
+	for (uint32_t i = 1; i < BLOCK_TEXELS; i++)
+		writer.Write(indices[i], 4);
+}
+
+static void DecodeColorBlock(const uint8_t* block, bool allowThreeColor, uint8_t* texels)
+{
+	uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+	uint32_t palette[4][4];
+	GetBC1Palette(color0, color1, !allowThreeColor || color0 > color1, palette);
+
+	uint32_t bits;
+	memcpy(&bits, block + 4, sizeof(bits));
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t index = (bits >> (i * 2)) & 3;
+		for (uint32_t c = 0; c < 3; c++)
+			texels[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+		texels[i * 4 + 3] = allowThreeColor && color0 <= color1 && index == 3 ? 0 : 255;
+	}
+}
+
+static void DecodeChannelBlock(const uint8_t* block, uint32_t channel, uint8_t* texels)
+{
+	uint32_t palette[8];
+	GetBC4Palette(block[0], block[1], palette);
+
+	uint64_t bits = 0;
+	for (uint32_t i = 0; i < 6; i++)
+		bits |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		texels[i * 4 + channel] = static_cast<uint8_t>(palette[(bits >> (i * 3)) & 7]);
+}
+
+void BlockCompressor::DecodeBlock(TextureFormat format, const uint8_t* block, uint8_t* texels)
+{
+	switch (format) {
+	case TextureFormat::BC1:
+		DecodeColorBlock(block, true, texels);
+		break;
+	case TextureFormat::BC3:
+		DecodeColorBlock(block + 8, false, texels);
+		DecodeChannelBlock(block, 3, texels);
+		break;
+	case TextureFormat::BC5:
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+			texels[i * 4 + 2] = 0;
+			texels[i * 4 + 3] = 255;
+		}
+		DecodeChannelBlock(block, 0, texels);
+		DecodeChannelBlock(block + 8, 1, texels);
+		break;
+	case TextureFormat::BC7: {
+		memset(texels, 0, BLOCK_TEXELS * 4);
+		BitReader reader{ block, 0 };
+		if (reader.Read(7) != 1 << 6)
+			break;
+
+		uint32_t endpoints[2][4];
+		for (uint32_t c = 0; c < 4; c++) {
+			endpoints[0][c] = reader.Read(7) << 1;
+			endpoints[1][c] = reader.Read(7) << 1;
+		}
+		uint32_t pbit0 = reader.Read(1), pbit1 = reader.Read(1);
+		for (uint32_t c = 0; c < 4; c++) {
+			endpoints[0][c] |= pbit0;
+			endpoints[1][c] |= pbit1;
+		}
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+			uint32_t weight = s_BC7Weights[reader.Read(i == 0 ? 3 : 4)];
+			for (uint32_t c = 0; c < 4; c++)
+				texels[i * 4 + c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+		}
+		break;
+	}
+	case TextureFormat::RGBA8:
+		memcpy(texels, block, BLOCK_TEXELS * 4);
+		break;
+	}
+}
+
+void BlockCompressor::Compress(const TextureLevel& level, TextureFormat format, uint8_t* output, ThreadPool* workers)
+{
+	if (format == TextureFormat::RGBA8) {
+		memcpy(output, level.Pixels.data(), level.Pixels.size());
+		return;
+	}
+
+	uint32_t blocksX = (level.Width + TEXTURE_BLOCK_DIMENSION - 1) / TEXTURE_BLOCK_DIMENSION;
+	uint32_t blocksY = (level.Height + TEXTURE_BLOCK_DIMENSION - 1) / TEXTURE_BLOCK_DIMENSION;
+	uint32_t blockSize = GetTextureBlockSize(format);
+
+	auto encodeRow = [&](uint32_t by) {
+		uint8_t texels[BLOCK_TEXELS * 4];
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			for (uint32_t y = 0; y < TEXTURE_BLOCK_DIMENSION; y++) {
+				uint32_t sy = std::min(by * TEXTURE_BLOCK_DIMENSION + y, level.Height - 1);
+				for (uint32_t x = 0; x < TEXTURE_BLOCK_DIMENSION; x++) {
+					uint32_t sx = std::min(bx * TEXTURE_BLOCK_DIMENSION + x, level.Width - 1);
+					memcpy(&texels[(y * TEXTURE_BLOCK_DIMENSION + x) * 4], &level.Pixels[(static_cast<size_t>(sy) * level.Width + sx) * 4], 4);
+				}
+			}
+
+			uint8_t* block = output + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+			switch (format) {
+			case TextureFormat::BC1: EncodeBC1(texels, block); break;
+			case TextureFormat::BC3: EncodeBC3(texels, block); break;
+			case TextureFormat::BC5: EncodeBC5(texels, block); break;
+			case TextureFormat::BC7: EncodeBC7(texels, block); break;
+			case TextureFormat::RGBA8: break;
+			}
+		}
+	};
+
+	//Rows of blocks are independent, so the output does not depend on how they are spread
+	if (workers && blocksY > 1)
+		workers->ParallelFor(blocksY, encodeRow);
+	else
+		for (uint32_t by = 0; by < blocksY; by++)
+			encodeRow(by);
+}
+
+void BlockCompressor::Decompress(const uint8_t* input, TextureFormat format, TextureLevel& level)
+{
+	if (format == TextureFormat::RGBA8) {
+		level.Pixels.assign(input, input + static_cast<size_t>(level.Width) * level.Height * 4);
+		return;
+	}
+
+	uint32_t blocksX = (level.Width + TEXTURE_BLOCK_DIMENSION - 1) / TEXTURE_BLOCK_DIMENSION;
+	uint32_t blocksY = (level.Height + TEXTURE_BLOCK_DIMENSION - 1) / TEXTURE_BLOCK_DIMENSION;
+	uint32_t blockSize = GetTextureBlockSize(format);
+	level.Pixels.resize(static_cast<size_t>(level.Width) * level.Height * 4);
+
+	uint8_t texels[BLOCK_TEXELS * 4];
+	for (uint32_t by = 0; by < blocksY; by++)
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			DecodeBlock(format, input + (static_cast<size_t>(by) * blocksX + bx) * blockSize, texels);
+			for (uint32_t y = 0; y < TEXTURE_BLOCK_DIMENSION && by * TEXTURE_BLOCK_DIMENSION + y < level.Height; y++)
+				for (uint32_t x = 0; x < TEXTURE_BLOCK_DIMENSION && bx * TEXTURE_BLOCK_DIMENSION + x < level.Width; x++)
+					memcpy(&level.Pixels[(static_cast<size_t>(by * TEXTURE_BLOCK_DIMENSION + y) * level.Width + bx * TEXTURE_BLOCK_DIMENSION + x) * 4],
+						&texels[(y * TEXTURE_BLOCK_DIMENSION + x) * 4], 4);
+		}
+}
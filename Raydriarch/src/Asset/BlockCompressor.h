@@ -0,0 +1,26 @@
+#pragma once
+
+#include "TextureData.h"
+#include "Core/ThreadPool.h"
+
+//CPU encoder for the BC formats. Every block is fitted along its principal axis and refined once by least squares; BC7
+//only ever writes mode 6, a single RGBA subset with 16 palette entries, which covers smooth colour and alpha well.
+class BlockCompressor {
+public:
+	BlockCompressor() = delete;
+
+	//Block encoders take the 16 RGBA8 texels of one block, rows first
+	static void EncodeBC1(const uint8_t* texels, uint8_t* block);
+	static void EncodeBC3(const uint8_t* texels, uint8_t* block);
+	static void EncodeBC5(const uint8_t* texels, uint8_t* block);
+	static void EncodeBC7(const uint8_t* texels, uint8_t* block);
+	//Decodes what the encoders write, for measuring their error; BC7 blocks in modes other than 6 decode to zero and an
+	//RGBA8 block is taken to be 16 texels, rows first
+	static void DecodeBlock(TextureFormat format, const uint8_t* block, uint8_t* texels);
+
+	//Encodes a whole level into output, which must hold GetTextureLevelSize bytes; edge blocks repeat the last row and
+	//column. Rows of blocks are spread over the workers when given. RGBA8 is copied as is.
+	static void Compress(const TextureLevel& level, TextureFormat format, uint8_t* output, ThreadPool* workers = nullptr);
+	//Inverse of Compress; the level's dimensions must already be set
+	static void Decompress(const uint8_t* input, TextureFormat format, TextureLevel& level);
+};
@@ -0,0 +1,183 @@
+#include "raydpch.h"
+#include "MeshCache.h"
+
+#include "ObjImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+
+static inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//Whether count elements of size bytes starting at offset lie inside the file, without overflowing on a corrupt header
+static inline bool FitsInFile(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+{
+	return offset <= fileSize && count <= (fileSize - offset) / size;
+}
+
+static inline bool IsRangeInside(uint32_t first, uint32_t count, uint32_t total)
+{
+	return first <= total && count <= total - first;
+}
+
+//Every LOD and meshlet has to stay inside the index and meshlet blobs and every index inside the vertex blob, since all of
+//them go to the GPU as they are
+static bool AreRangesValid(const MeshCacheHeader& header, const uint32_t* indices, const Meshlet* meshlets, const MeshLod* lods)
+{
+	for (uint32_t i = 0; i < header.LodCount; i++)
+		if (!IsRangeInside(lods[i].FirstIndex, lods[i].IndexCount, header.IndexCount) ||
+			!IsRangeInside(lods[i].FirstMeshlet, lods[i].MeshletCount, header.MeshletCount))
+			return false;
+
+	for (uint32_t i = 0; i < header.MeshletCount; i++)
+		if (!IsRangeInside(meshlets[i].FirstIndex, meshlets[i].IndexCount, header.IndexCount))
+			return false;
+
+	for (uint32_t i = 0; i < header.IndexCount; i++)
+		if (indices[i] >= header.VertexCount)
+			return false;
+
+	return true;
+}
+
+MeshCache::MeshCache(const std::string& cachePath, const std::string& sourcePath, const VertexFormat& format)
+	:m_File(cachePath), m_Header(nullptr)
+{
+	if (!m_File.IsOpen() || m_File.GetSize() < sizeof(MeshCacheHeader))
+		return;
+
+	auto header = reinterpret_cast<const MeshCacheHeader*>(m_File.GetData());
+	if (header->Magic != MESH_CACHE_MAGIC || header->Version != MESH_CACHE_VERSION ||
+		header->Format != format.GetKey() || header->VertexStride != format.GetStride())
+		return;
+
+	uint64_t fileSize = m_File.GetSize();
+	if (header->VertexStride == 0 || !FitsInFile(header->VertexOffset, header->VertexCount, header->VertexStride, fileSize) ||
+		!FitsInFile(header->IndexOffset, header->IndexCount, sizeof(uint32_t), fileSize) ||
+		!FitsInFile(header->MeshletOffset, header->MeshletCount, sizeof(Meshlet), fileSize) ||
+		!FitsInFile(header->LodOffset, header->LodCount, sizeof(MeshLod), fileSize) ||
+		header->LodCount == 0 || header->LodCount > MESH_LOD_COUNT)
+		return;
+
+	//A cache shipped without its source is taken as-is
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (GetFileStamp(sourcePath, sourceSize, sourceTime) && (sourceSize != header->SourceSize || sourceTime != header->SourceTime))
+		return;
+
+	const char* data = m_File.GetData();
+	if (!AreRangesValid(*header, reinterpret_cast<const uint32_t*>(data + header->IndexOffset),
+		reinterpret_cast<const Meshlet*>(data + header->MeshletOffset), reinterpret_cast<const MeshLod*>(data + header->LodOffset)))
+		return;
+
+	m_Header = header;
+}
+
+bool MeshCache::Write(const std::string& cachePath, const std::string& sourcePath, const PackedMesh& mesh)
+{
+	MeshCacheHeader header{};
+	header.Magic = MESH_CACHE_MAGIC;
+	header.Version = MESH_CACHE_VERSION;
+	header.VertexStride = mesh.Format.GetStride();
+	header.VertexCount = mesh.VertexCount;
+	header.IndexCount = static_cast<uint32_t>(mesh.Indices.size());
+	header.Format = mesh.Format.GetKey();
+	header.MeshletCount = static_cast<uint32_t>(mesh.Meshlets.size());
+	header.LodCount = static_cast<uint32_t>(mesh.Lods.size());
+	header.Bounds = mesh.Bounds;
+	header.Decode = mesh.Decode;
+	GetFileStamp(sourcePath, header.SourceSize, header.SourceTime);
+
+	uint64_t vertexBytes = static_cast<uint64_t>(header.VertexCount) * header.VertexStride;
+	uint64_t indexBytes = static_cast<uint64_t>(header.IndexCount) * sizeof(uint32_t);
+	header.VertexOffset = AlignUp(sizeof(MeshCacheHeader), MESH_CACHE_ALIGNMENT);
+	uint64_t meshletBytes = static_cast<uint64_t>(header.MeshletCount) * sizeof(Meshlet);
+	header.IndexOffset = AlignUp(header.VertexOffset + vertexBytes, MESH_CACHE_ALIGNMENT);
+	uint64_t lodBytes = static_cast<uint64_t>(header.LodCount) * sizeof(MeshLod);
+	header.MeshletOffset = AlignUp(header.IndexOffset + indexBytes, MESH_CACHE_ALIGNMENT);
+	header.LodOffset = AlignUp(header.MeshletOffset + meshletBytes, MESH_CACHE_ALIGNMENT);
+
+	//Written beside the target and renamed over it, so a crash never leaves a torn cache behind
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream output(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!output)
+			return false;
+
+		std::vector<char> padding(MESH_CACHE_ALIGNMENT, 0);
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(padding.data(), header.VertexOffset - sizeof(header));
+		output.write(reinterpret_cast<const char*>(mesh.Vertices.data()), vertexBytes);
+		output.write(padding.data(), header.IndexOffset - header.VertexOffset - vertexBytes);
+		output.write(reinterpret_cast<const char*>(mesh.Indices.data()), indexBytes);
+		output.write(padding.data(), header.MeshletOffset - header.IndexOffset - indexBytes);
+		output.write(reinterpret_cast<const char*>(mesh.Meshlets.data()), meshletBytes);
+		output.write(padding.data(), header.LodOffset - header.MeshletOffset - meshletBytes);
+		output.write(reinterpret_cast<const char*>(mesh.Lods.data()), lodBytes);
+		if (!output)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error) {
+		RAYD_WARN("Failed to write mesh cache {0}: {1}", cachePath, error.message());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshCache::Bake(const std::string& sourcePath, const VertexFormat& format, PackedMesh& mesh, ThreadPool* workers)
+{
+	MeshData source;
+	if (!ObjImporter::Import(sourcePath, source, workers))
+		return false;
+
+	Process(source, sourcePath, format, mesh);
+
+	if (!Write(GetCachePath(sourcePath), sourcePath, mesh))
+		RAYD_WARN("Could not cache {0}, it will be parsed again on the next launch", sourcePath);
+	return true;
+}
+
+void MeshCache::Process(MeshData& source, const std::string& name, const VertexFormat& format, PackedMesh& mesh)
+{
+	MeshOptimizer::Optimize(source, name);
+	std::vector<MeshLod> lods;
+	MeshSimplifier::GenerateLods(source, lods, name);
+
+	VertexPacker::Pack(source, format, mesh);
+	mesh.Lods = lods;
+	mesh.Meshlets.clear();
+	for (auto& lod : mesh.Lods) {
+		lod.FirstMeshlet = static_cast<uint32_t>(mesh.Meshlets.size());
+		MeshletBuilder::Build(source, lod.FirstIndex, lod.IndexCount, mesh.Meshlets);
+		lod.MeshletCount = static_cast<uint32_t>(mesh.Meshlets.size()) - lod.FirstMeshlet;
+	}
+	VertexPacker::LogSizeReport(name, source, mesh);
+}
+
+bool MeshCache::Load(const std::string& sourcePath, const VertexFormat& format, PackedMesh& mesh, ThreadPool* workers)
+{
+	RAYD_PROFILE_SCOPE("MeshCache::Load");
+	MeshCache cache(GetCachePath(sourcePath), sourcePath, format);
+	if (!cache.IsValid())
+		return Bake(sourcePath, format, mesh, workers);
+
+	//Copying faults the mapping in on the calling thread rather than whichever one uploads the mesh
+	const MeshCacheHeader& header = cache.GetHeader();
+	const uint8_t* vertices = static_cast<const uint8_t*>(cache.GetVertices());
+	mesh.Format = format;
+	mesh.VertexCount = header.VertexCount;
+	mesh.Vertices.assign(vertices, vertices + static_cast<size_t>(header.VertexCount) * header.VertexStride);
+	mesh.Indices.assign(cache.GetIndices(), cache.GetIndices() + header.IndexCount);
+	mesh.Bounds = header.Bounds;
+	mesh.Decode = header.Decode;
+	mesh.Lods.assign(cache.GetLods(), cache.GetLods() + header.LodCount);
+	mesh.Meshlets.assign(cache.GetMeshlets(), cache.GetMeshlets() + header.MeshletCount);
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "VertexPacker.h"
+#include "Core/MappedFile.h"
+#include "Core/ThreadPool.h"
+
+#define MESH_CACHE_MAGIC 0x48534D52
+//2: indices and vertices are stored in MeshOptimizer order
+//3: vertices are stored packed in the VertexFormat the cache was baked for
+//4: meshlets are stored after the indices
+//5: coarser levels of detail follow the full-resolution indices, described by a LOD table after the meshlets
+//6: LODs are rebuilt with collapses that would turn a triangle away from the input surface rejected
+#define MESH_CACHE_VERSION 6
+//Blob offsets are aligned so they can be copied into staging memory as-is
+#define MESH_CACHE_ALIGNMENT 256
+
+struct MeshCacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	//VertexFormat::GetKey of the packed vertices
+	uint32_t Format;
+	uint32_t MeshletCount;
+	uint32_t LodCount;
+	//Size and modification time of the source asset, to detect a stale cache
+	uint64_t SourceSize;
+	int64_t SourceTime;
+	uint64_t VertexOffset;
+	uint64_t IndexOffset;
+	uint64_t MeshletOffset;
+	uint64_t LodOffset;
+	MeshBounds Bounds;
+	VertexDecode Decode;
+};
+
+//Versioned binary mesh: a header followed by packed vertex, index, meshlet and LOD blobs, read through a file mapping
+class MeshCache {
+public:
+	MeshCache(const std::string& cachePath, const std::string& sourcePath, const VertexFormat& format);
+
+	static bool Write(const std::string& cachePath, const std::string& sourcePath, const PackedMesh& mesh);
+	//Imports, optimizes, simplifies, clusters and packs the source, then writes its cache; the mesh is usable even if the write fails
+	static bool Bake(const std::string& sourcePath, const VertexFormat& format, PackedMesh& mesh, ThreadPool* workers = nullptr);
+	//Optimizes, simplifies, clusters and packs a mesh already in memory; name only labels the log
+	static void Process(MeshData& source, const std::string& name, const VertexFormat& format, PackedMesh& mesh);
+	//Copies the mesh out of a valid cache, or bakes it; safe to call from any thread, since it touches nothing on the GPU
+	static bool Load(const std::string& sourcePath, const VertexFormat& format, PackedMesh& mesh, ThreadPool* workers = nullptr);
+	static inline std::string GetCachePath(const std::string& sourcePath) { return sourcePath + ".rmesh"; }
+
+	//False when the file is missing, corrupt, from another version or format, or older than its source
+	inline bool IsValid() const { return m_Header != nullptr; }
+	inline const MeshCacheHeader& GetHeader() const { return *m_Header; }
+	inline const void* GetVertices() const { return m_File.GetData() + m_Header->VertexOffset; }
+	inline const uint32_t* GetIndices() const { return reinterpret_cast<const uint32_t*>(m_File.GetData() + m_Header->IndexOffset); }
+	inline const Meshlet* GetMeshlets() const { return reinterpret_cast<const Meshlet*>(m_File.GetData() + m_Header->MeshletOffset); }
+	inline const MeshLod* GetLods() const { return reinterpret_cast<const MeshLod*>(m_File.GetData() + m_Header->LodOffset); }
+private:
+	MappedFile m_File;
+	const MeshCacheHeader* m_Header;
+};
@@ -0,0 +1,22 @@
+#include "raydpch.h"
+#include "MeshData.h"
+
+MeshBounds ComputeBounds(const MeshVertex* vertices, size_t vertexCount)
+{
+	MeshBounds bounds{};
+	if (vertexCount == 0)
+		return bounds;
+
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+	for (size_t i = 0; i < vertexCount; i++) {
+		minPos = glm::min(minPos, vertices[i].Position);
+		maxPos = glm::max(maxPos, vertices[i].Position);
+	}
+
+	bounds.Center = (minPos + maxPos) * 0.5f;
+	for (size_t i = 0; i < vertexCount; i++)
+		bounds.Radius = std::max(bounds.Radius, glm::length(vertices[i].Position - bounds.Center));
+
+	return bounds;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Core/Core.h"
+
+#include <glm/glm.hpp>
+
+//Full-precision vertex every importer produces; VertexPacker shrinks it to the engine's VertexFormat when baking
+struct MeshVertex {
+	glm::vec3 Position;
+	//Zero when the source has no normals
+	glm::vec3 Normal;
+	glm::vec2 TexCoord;
+
+	bool operator==(const MeshVertex& other) const {
+		return Position == other.Position && Normal == other.Normal && TexCoord == other.TexCoord;
+	}
+};
+
+struct MeshBounds {
+	glm::vec3 Center;
+	float Radius;
+};
+
+//CPU-side mesh with deduplicated vertices, independent of any graphics API
+struct MeshData {
+	std::vector<MeshVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	MeshBounds Bounds;
+};
+
+//Bounding sphere around the box centre of the vertices
+MeshBounds ComputeBounds(const MeshVertex* vertices, size_t vertexCount);
@@ -0,0 +1,263 @@
+#include "raydpch.h"
+#include "MeshOptimizer.h"
+
+//Vertex to triangle adjacency in compressed rows
+struct TriangleAdjacency {
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Triangles;
+};
+
+static TriangleAdjacency BuildAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	TriangleAdjacency adjacency;
+	adjacency.Offsets.assign(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		adjacency.Offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacency.Offsets[v + 1] += adjacency.Offsets[v];
+
+	std::vector<uint32_t> cursor(adjacency.Offsets.begin(), adjacency.Offsets.end() - 1);
+	adjacency.Triangles.resize(indexCount);
+	for (size_t i = 0; i < indexCount; i++)
+		adjacency.Triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+	return adjacency;
+}
+
+void MeshOptimizer::Optimize(MeshData& mesh, const std::string& name)
+{
+	if (mesh.Indices.empty())
+		return;
+
+	VertexCacheStats before = AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+	OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+	OptimizeOverdraw(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.data(), mesh.Vertices.size());
+	size_t vertexCount = OptimizeVertexFetch(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+	mesh.Vertices.resize(vertexCount);
+
+	VertexCacheStats after = AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+	RAYD_INFO("Optimized {0}: ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}", name, before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	TriangleAdjacency adjacency = BuildAdjacency(indices, indexCount, vertexCount);
+
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacency.Offsets[v + 1] - adjacency.Offsets[v];
+
+	//A vertex is in the cache while time - cacheTime[v] <= cacheSize
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	size_t cursor = 0;
+	int64_t fanning = 0;
+	while (fanning >= 0) {
+		uint32_t vertex = static_cast<uint32_t>(fanning);
+		candidates.clear();
+
+		for (uint32_t a = adjacency.Offsets[vertex]; a < adjacency.Offsets[vertex + 1]; a++) {
+			uint32_t triangle = adjacency.Triangles[a];
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[triangle * 3 + k];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		//Prefer the oldest candidate that will still be cached after its remaining triangles are emitted
+		fanning = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t v : candidates) {
+			if (liveTriangles[v] == 0)
+				continue;
+
+			int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = time - cacheTime[v];
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+
+		//Dead end: back up through recently emitted vertices, then fall back to the next vertex in input order
+		while (fanning < 0 && !deadEnds.empty()) {
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[v] > 0)
+				fanning = v;
+		}
+		while (fanning < 0 && cursor < vertexCount) {
+			if (liveTriangles[cursor] > 0)
+				fanning = cursor;
+			cursor++;
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount, float threshold, uint32_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	//Hard boundaries fall where Tipsify hit a dead end, which shows up as a triangle missing on all three vertices
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	auto simulate = [&](size_t triangle) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t v = indices[triangle * 3 + k];
+			if (time - cacheTime[v] > cacheSize) {
+				cacheTime[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	std::vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; t++)
+		if (simulate(t) == 3 || t == 0)
+			hardBoundaries.push_back(t);
+	hardBoundaries.push_back(triangleCount);
+
+	//Soft boundaries split a hard cluster as soon as the piece so far, rendered from a cold cache, is within
+	//threshold of the whole cluster's ACMR; the leftover tail is merged into the piece before it
+	std::vector<size_t> clusters;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+		size_t begin = hardBoundaries[h], end = hardBoundaries[h + 1];
+
+		time += cacheSize + 1;
+		uint32_t clusterMisses = 0;
+		for (size_t t = begin; t < end; t++)
+			clusterMisses += simulate(t);
+		float clusterThreshold = threshold * clusterMisses / (end - begin);
+
+		time += cacheSize + 1;
+		clusters.push_back(begin);
+		uint32_t misses = 0;
+		size_t start = begin;
+		for (size_t t = begin; t < end; t++) {
+			misses += simulate(t);
+			if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= clusterThreshold) {
+				clusters.push_back(t + 1);
+				start = t + 1;
+				misses = 0;
+				time += cacheSize + 1;
+			}
+		}
+		if (start != begin && static_cast<float>(misses) / (end - start) > clusterThreshold)
+			clusters.pop_back();
+	}
+	clusters.push_back(triangleCount);
+
+	//Sort key is how far the cluster sits out along its own facing direction from the mesh centroid
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	std::vector<glm::vec3> clusterCenters(clusters.size() - 1, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusters.size() - 1, glm::vec3(0.0f));
+	std::vector<float> clusterAreas(clusters.size() - 1, 0.0f);
+	for (size_t c = 0; c + 1 < clusters.size(); c++) {
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			const glm::vec3& p0 = vertices[indices[t * 3 + 0]].Position;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].Position;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].Position;
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			glm::vec3 center = (p0 + p1 + p2) * (area / 3.0f);
+
+			clusterCenters[c] += center;
+			clusterNormals[c] += normal;
+			clusterAreas[c] += area;
+			meshCenter += center;
+			meshArea += area;
+		}
+	}
+	meshCenter = meshArea > 0.0f ? meshCenter / meshArea : meshCenter;
+
+	std::vector<float> sortKeys(clusters.size() - 1);
+	std::vector<uint32_t> order(clusters.size() - 1);
+	for (size_t c = 0; c < order.size(); c++) {
+		glm::vec3 center = clusterAreas[c] > 0.0f ? clusterCenters[c] / clusterAreas[c] : clusterCenters[c];
+		float normalLength = glm::length(clusterNormals[c]);
+		glm::vec3 normal = normalLength > 0.0f ? clusterNormals[c] / normalLength : glm::vec3(0.0f);
+		sortKeys[c] = glm::dot(center - meshCenter, normal);
+		order[c] = static_cast<uint32_t>(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (uint32_t c : order)
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(MeshVertex* vertices, size_t vertexCount, uint32_t* indices, size_t indexCount)
+{
+	constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(vertexCount, unused);
+	std::vector<MeshVertex> reordered;
+	reordered.reserve(vertexCount);
+
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t& id = remap[indices[i]];
+		if (id == unused) {
+			id = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[indices[i]]);
+		}
+		indices[i] = id;
+	}
+
+	std::copy(reordered.begin(), reordered.end(), vertices);
+	return reordered.size();
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats{};
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t time = cacheSize + 1;
+	size_t referencedCount = 0;
+
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t v = indices[i];
+		if (time - cacheTime[v] > cacheSize) {
+			cacheTime[v] = time++;
+			stats.Transformed++;
+		}
+		if (!referenced[v]) {
+			referenced[v] = true;
+			referencedCount++;
+		}
+	}
+
+	stats.ACMR = indexCount >= 3 ? static_cast<float>(stats.Transformed) / (indexCount / 3) : 0.0f;
+	stats.ATVR = referencedCount ? static_cast<float>(stats.Transformed) / referencedCount : 0.0f;
+	return stats;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MeshData.h"
+
+//Post-transform cache size the reorderings target and the analysis simulates
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+//How much worse than the vertex cache order a cluster may get to buy a better draw order
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+struct VertexCacheStats {
+	uint32_t Transformed;
+	//Transformed vertices per triangle; 0.5 is the limit for a regular grid, 3 means no reuse at all
+	float ACMR;
+	//Transformed vertices per referenced vertex; 1 means every vertex is shaded exactly once
+	float ATVR;
+};
+
+//CPU-only index and vertex reordering run once when a mesh is baked into its cache
+class MeshOptimizer {
+public:
+	MeshOptimizer() = delete;
+
+	//Runs every pass below in order and logs the cache statistics before and after
+	static void Optimize(MeshData& mesh, const std::string& name);
+
+	//Tipsify: emits triangles fanning around recently used vertices so they are still in the post-transform cache
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+	//Splits a cache-optimized index buffer into clusters and sorts them outside-in so near surfaces tend to draw first
+	static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount,
+		float threshold = MESH_OPTIMIZER_OVERDRAW_THRESHOLD, uint32_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+	//Renumbers vertices in first-use order so fetches walk memory linearly; returns the count of vertices still referenced
+	static size_t OptimizeVertexFetch(MeshVertex* vertices, size_t vertexCount, uint32_t* indices, size_t indexCount);
+
+	//FIFO cache simulation of the index buffer
+	static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+};
@@ -0,0 +1,433 @@
+#include "raydpch.h"
+#include "MeshSimplifier.h"
+
+#include "MeshOptimizer.h"
+
+//Open borders and seams are held in place this many times harder than the surface around them
+#define MESH_SIMPLIFIER_EDGE_WEIGHT 10.0
+//A pass takes collapses up to this multiple of the error of the one that would just meet its goal
+#define MESH_SIMPLIFIER_PASS_ERROR_SLACK 1.5f
+
+enum class VertexKind : uint8_t {
+	//Interior vertex, free to collapse anywhere
+	Manifold,
+	//On an open edge of the surface, collapses only along it
+	Border,
+	//One of two vertices sharing a position across a texture seam, collapses only along the seam with its twin
+	Seam,
+	//Anything more tangled, never moves
+	Locked
+};
+
+//Sum of squared distances to a set of weighted planes, kept in double so large meshes do not lose the small terms
+struct Quadric {
+	double A00, A11, A22, A10, A20, A21;
+	double B0, B1, B2;
+	double C;
+	double Weight;
+
+	void AddPlane(const glm::vec3& normal, float distance, double weight)
+	{
+		double x = normal.x, y = normal.y, z = normal.z, d = distance;
+		A00 += weight * x * x; A11 += weight * y * y; A22 += weight * z * z;
+		A10 += weight * y * x; A20 += weight * z * x; A21 += weight * z * y;
+		B0 += weight * x * d; B1 += weight * y * d; B2 += weight * z * d;
+		C += weight * d * d;
+		Weight += weight;
+	}
+
+	void Add(const Quadric& other)
+	{
+		A00 += other.A00; A11 += other.A11; A22 += other.A22;
+		A10 += other.A10; A20 += other.A20; A21 += other.A21;
+		B0 += other.B0; B1 += other.B1; B2 += other.B2;
+		C += other.C;
+		Weight += other.Weight;
+	}
+
+	//Weighted mean squared distance, so errors stay in model units squared whatever the triangle sizes
+	double Evaluate(const glm::vec3& point) const
+	{
+		double x = point.x, y = point.y, z = point.z;
+		double r = A00 * x * x + A11 * y * y + A22 * z * z + 2.0 * (A10 * x * y + A20 * x * z + A21 * y * z)
+			+ 2.0 * (B0 * x + B1 * y + B2 * z) + C;
+		return Weight > 0.0 ? std::abs(r) / Weight : 0.0;
+	}
+};
+
+struct EdgeCollapse {
+	uint32_t From;
+	uint32_t To;
+	float Error;
+
+	bool operator<(const EdgeCollapse& other) const
+	{
+		if (Error != other.Error)
+			return Error < other.Error;
+		return From != other.From ? From < other.From : To < other.To;
+	}
+};
+
+//Open-addressing set of directed edges
+class EdgeSet {
+public:
+	explicit EdgeSet(size_t edgeCount)
+	{
+		size_t capacity = 16;
+		while (capacity < edgeCount * 2)
+			capacity <<= 1;
+		m_Keys.assign(capacity, EMPTY);
+	}
+
+	void Insert(uint32_t from, uint32_t to)
+	{
+		uint64_t key = static_cast<uint64_t>(from) << 32 | to;
+		size_t slot = Find(key);
+		m_Keys[slot] = key;
+	}
+
+	bool Contains(uint32_t from, uint32_t to) const
+	{
+		uint64_t key = static_cast<uint64_t>(from) << 32 | to;
+		return m_Keys[Find(key)] == key;
+	}
+private:
+	size_t Find(uint64_t key) const
+	{
+		uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+		size_t mask = m_Keys.size() - 1;
+		size_t slot = static_cast<size_t>(hash >> 32) & mask;
+		while (m_Keys[slot] != EMPTY && m_Keys[slot] != key)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+private:
+	static constexpr uint64_t EMPTY = ~0ull;
+	std::vector<uint64_t> m_Keys;
+};
+
+static constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+//Links vertices that share a position: remap points at the first of them, wedge cycles through all of them
+static void BuildPositionRemap(const MeshVertex* vertices, size_t vertexCount, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedge)
+{
+	size_t capacity = 16;
+	while (capacity < vertexCount * 2)
+		capacity <<= 1;
+	std::vector<uint32_t> table(capacity, NO_VERTEX);
+
+	remap.resize(vertexCount);
+	wedge.resize(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		uint32_t bits[3];
+		memcpy(bits, &vertices[v].Position, sizeof(bits));
+		uint32_t hash = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+
+		size_t slot = hash & (capacity - 1);
+		while (table[slot] != NO_VERTEX && !(vertices[table[slot]].Position == vertices[v].Position))
+			slot = (slot + 1) & (capacity - 1);
+		if (table[slot] == NO_VERTEX)
+			table[slot] = v;
+
+		remap[v] = table[slot];
+		wedge[v] = v;
+		if (remap[v] != v) {
+			uint32_t first = remap[v];
+			wedge[v] = wedge[first];
+			wedge[first] = v;
+		}
+	}
+}
+
+static inline bool IsOpenEdge(uint32_t from, uint32_t to, const std::vector<uint32_t>& openNext, const std::vector<uint32_t>& openPrev)
+{
+	return openNext[from] == to || openPrev[from] == to;
+}
+
+size_t MeshSimplifier::Simplify(const MeshVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, uint32_t* output, float* resultError)
+{
+	std::copy(indices, indices + indexCount, output);
+	if (resultError)
+		*resultError = 0.0f;
+	if (indexCount <= targetIndexCount || indexCount < 3)
+		return indexCount;
+
+	std::vector<uint32_t> remap, wedge;
+	BuildPositionRemap(vertices, vertexCount, remap, wedge);
+
+	//An edge is open when no triangle runs along it the other way; openNext and openPrev keep the neighbour along the
+	//vertex's single open edge out and in, NO_VERTEX when there is none and manyEdges when there are several
+	constexpr uint32_t manyEdges = NO_VERTEX - 1;
+	EdgeSet edges(indexCount);
+	for (size_t i = 0; i < indexCount; i += 3)
+		for (uint32_t k = 0; k < 3; k++)
+			edges.Insert(indices[i + k], indices[i + (k + 1) % 3]);
+
+	std::vector<uint32_t> openNext(vertexCount, NO_VERTEX), openPrev(vertexCount, NO_VERTEX);
+	for (size_t i = 0; i < indexCount; i += 3) {
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+			if (edges.Contains(b, a))
+				continue;
+			openNext[a] = openNext[a] == NO_VERTEX ? b : manyEdges;
+			openPrev[b] = openPrev[b] == NO_VERTEX ? a : manyEdges;
+		}
+	}
+
+	auto hasSingleOpenEdge = [&](uint32_t v) {
+		return openNext[v] < manyEdges && openPrev[v] < manyEdges;
+	};
+
+	std::vector<VertexKind> kinds(vertexCount, VertexKind::Locked);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		uint32_t twin = wedge[v];
+		if (twin == v) {
+			if (openNext[v] == NO_VERTEX && openPrev[v] == NO_VERTEX)
+				kinds[v] = VertexKind::Manifold;
+			else if (hasSingleOpenEdge(v))
+				kinds[v] = VertexKind::Border;
+		}
+		//A seam closes in position space: each twin's open edge runs back along the other's
+		else if (wedge[twin] == v && hasSingleOpenEdge(v) && hasSingleOpenEdge(twin)) {
+			if (remap[openNext[v]] == remap[openPrev[twin]] && remap[openPrev[v]] == remap[openNext[twin]])
+				kinds[v] = VertexKind::Seam;
+		}
+	}
+
+	//Quadrics live on the first vertex of each position, so seam twins share theirs
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < indexCount; i += 3) {
+		const glm::vec3& p0 = vertices[indices[i + 0]].Position;
+		const glm::vec3& p1 = vertices[indices[i + 1]].Position;
+		const glm::vec3& p2 = vertices[indices[i + 2]].Position;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+
+		normal /= length;
+		Quadric plane{};
+		plane.AddPlane(normal, -glm::dot(normal, p0), length * 0.5);
+		for (uint32_t k = 0; k < 3; k++)
+			quadrics[remap[indices[i + k]]].Add(plane);
+
+		//Open edges also get a plane standing up from the triangle through the edge, so collapses keep to the outline
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+			if (edges.Contains(b, a))
+				continue;
+
+			glm::vec3 edge = vertices[b].Position - vertices[a].Position;
+			glm::vec3 edgeNormal = glm::cross(edge, normal);
+			float edgeLength = glm::length(edgeNormal);
+			if (edgeLength == 0.0f)
+				continue;
+
+			edgeNormal /= edgeLength;
+			Quadric border{};
+			border.AddPlane(edgeNormal, -glm::dot(edgeNormal, vertices[a].Position), glm::dot(edge, edge) * MESH_SIMPLIFIER_EDGE_WEIGHT);
+			quadrics[remap[a]].Add(border);
+			quadrics[remap[b]].Add(border);
+		}
+	}
+
+	//Area-weighted normal of every vertex over the input triangles; checking each collapse against these as well as against
+	//the triangle it replaces keeps a run of small turns from adding up to a triangle facing away from the input surface
+	std::vector<glm::vec3> sourceNormals(vertexCount, glm::vec3(0.0f));
+	for (size_t i = 0; i < indexCount; i += 3) {
+		glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - vertices[indices[i]].Position,
+			vertices[indices[i + 2]].Position - vertices[indices[i]].Position);
+		for (uint32_t k = 0; k < 3; k++)
+			sourceNormals[indices[i + k]] += normal;
+	}
+
+	auto canCollapse = [&](uint32_t from, uint32_t to) {
+		switch (kinds[from]) {
+		case VertexKind::Manifold: return true;
+		case VertexKind::Border: return kinds[to] == VertexKind::Border && IsOpenEdge(from, to, openNext, openPrev);
+		case VertexKind::Seam: return kinds[to] == VertexKind::Seam && IsOpenEdge(from, to, openNext, openPrev);
+		default: return false;
+		}
+	};
+
+	double maxError2 = static_cast<double>(maxError) * maxError;
+	double worstError2 = 0.0;
+	size_t resultCount = indexCount;
+
+	std::vector<EdgeCollapse> collapses;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+
+	while (resultCount > targetIndexCount) {
+		//Triangles around each position, for the flip test
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (size_t i = 0; i < resultCount; i++)
+			adjacencyOffsets[remap[output[i]] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		adjacency.resize(resultCount);
+		for (size_t i = 0; i < resultCount; i++)
+			adjacency[cursor[remap[output[i]]]++] = static_cast<uint32_t>(i / 3);
+
+		collapses.clear();
+		for (size_t i = 0; i < resultCount; i += 3) {
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t a = output[i + k], b = output[i + (k + 1) % 3];
+				bool forward = canCollapse(a, b), backward = canCollapse(b, a);
+				if (!forward && !backward)
+					continue;
+
+				Quadric combined = quadrics[remap[a]];
+				combined.Add(quadrics[remap[b]]);
+				float forwardError = forward ? static_cast<float>(combined.Evaluate(vertices[b].Position)) : std::numeric_limits<float>::max();
+				float backwardError = backward ? static_cast<float>(combined.Evaluate(vertices[a].Position)) : std::numeric_limits<float>::max();
+				if (forwardError <= backwardError)
+					collapses.push_back({ a, b, forwardError });
+				else
+					collapses.push_back({ b, a, backwardError });
+			}
+		}
+		if (collapses.empty())
+			break;
+		std::sort(collapses.begin(), collapses.end());
+
+		//Collapses in a pass must not share vertices, so aim for half as many as the triangles still to remove
+		size_t triangleGoal = (resultCount - targetIndexCount) / 3;
+		size_t collapseGoal = std::max<size_t>(triangleGoal / 2, 1);
+		float passError = collapseGoal < collapses.size() ? collapses[collapseGoal].Error * MESH_SIMPLIFIER_PASS_ERROR_SLACK : std::numeric_limits<float>::max();
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+			collapseRemap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		//Moving a vertex onto the target must not turn any surviving triangle that uses it inside out, either against its
+		//current shape or against the input surface at its corners
+		auto flips = [&](uint32_t from, uint32_t to) {
+			const glm::vec3& target = vertices[to].Position;
+			for (uint32_t a = adjacencyOffsets[remap[from]]; a < adjacencyOffsets[remap[from] + 1]; a++) {
+				const uint32_t* triangle = &output[adjacency[a] * 3];
+				if (triangle[0] != from && triangle[1] != from && triangle[2] != from)
+					continue;
+
+				glm::vec3 before[3], after[3];
+				bool collapsing = false;
+				for (uint32_t k = 0; k < 3; k++) {
+					collapsing |= remap[triangle[k]] == remap[to];
+					before[k] = vertices[triangle[k]].Position;
+					after[k] = triangle[k] == from ? target : before[k];
+				}
+				if (collapsing)
+					continue;
+
+				glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+					return true;
+
+				bool facesAway = true;
+				for (uint32_t k = 0; k < 3 && facesAway; k++)
+					facesAway = glm::dot(normalAfter, sourceNormals[triangle[k] == from ? to : triangle[k]]) < 0.0f;
+				if (facesAway)
+					return true;
+			}
+			return false;
+		};
+
+		size_t removedTriangles = 0;
+		size_t performed = 0;
+		for (auto& collapse : collapses) {
+			if (collapse.Error > maxError2 || (collapse.Error > passError && performed > 0) || removedTriangles >= triangleGoal)
+				break;
+
+			uint32_t from = collapse.From, to = collapse.To;
+			if (touched[remap[from]] || touched[remap[to]])
+				continue;
+
+			//The seam twin follows onto the target twin on its own side of the seam, so it has to pass the same tests
+			uint32_t fromTwin = from, toTwin = to;
+			if (kinds[from] == VertexKind::Seam) {
+				fromTwin = wedge[from];
+				toTwin = wedge[to];
+				if (!IsOpenEdge(fromTwin, toTwin, openNext, openPrev) || touched[remap[fromTwin]] || touched[remap[toTwin]])
+					continue;
+			}
+			if (flips(from, to) || (fromTwin != from && flips(fromTwin, toTwin)))
+				continue;
+
+			collapseRemap[from] = to;
+			collapseRemap[fromTwin] = toTwin;
+			quadrics[remap[to]].Add(quadrics[remap[from]]);
+
+			//Every triangle around the source changes shape, so none of their corners may move again this pass; the flip
+			//tests above ran against the positions they have now
+			for (uint32_t a = adjacencyOffsets[remap[from]]; a < adjacencyOffsets[remap[from] + 1]; a++)
+				for (uint32_t k = 0; k < 3; k++)
+					touched[remap[output[adjacency[a] * 3 + k]]] = true;
+			touched[remap[to]] = true;
+			removedTriangles += kinds[from] == VertexKind::Border ? 1 : 2;
+			worstError2 = std::max(worstError2, static_cast<double>(collapse.Error));
+			performed++;
+		}
+		if (performed == 0)
+			break;
+
+		size_t written = 0;
+		for (size_t i = 0; i < resultCount; i += 3) {
+			uint32_t a = collapseRemap[output[i + 0]], b = collapseRemap[output[i + 1]], c = collapseRemap[output[i + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+				continue;
+			output[written++] = a;
+			output[written++] = b;
+			output[written++] = c;
+		}
+		resultCount = written;
+	}
+
+	if (resultError)
+		*resultError = static_cast<float>(std::sqrt(worstError2));
+	return resultCount;
+}
+
+void MeshSimplifier::GenerateLods(MeshData& mesh, std::vector<MeshLod>& lods, const std::string& name)
+{
+	uint32_t baseCount = static_cast<uint32_t>(mesh.Indices.size());
+	lods.clear();
+	lods.push_back({ 0, baseCount, 0, 0, 0.0f });
+
+	float maxError = mesh.Bounds.Radius * MESH_LOD_MAX_ERROR;
+	std::vector<uint32_t> previous(mesh.Indices.begin(), mesh.Indices.end());
+	std::vector<uint32_t> simplified(previous.size());
+	float targetRatio = 1.0f;
+
+	//Each level simplifies the one before it, which is faster than starting over and keeps the levels nested
+	for (uint32_t level = 1; level < MESH_LOD_COUNT; level++) {
+		targetRatio *= MESH_LOD_RATIO;
+		size_t target = static_cast<size_t>(baseCount / 3 * targetRatio) * 3;
+
+		float error;
+		size_t count = Simplify(mesh.Vertices.data(), mesh.Vertices.size(), previous.data(), previous.size(), target, maxError - lods.back().Error,
+			simplified.data(), &error);
+		if (count == 0 || count > previous.size() * (1.0f - MESH_LOD_MIN_REDUCTION))
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(simplified.data(), count, mesh.Vertices.size());
+
+		//Errors of consecutive passes are measured against different surfaces, so their sum bounds the total
+		MeshLod lod{};
+		lod.FirstIndex = static_cast<uint32_t>(mesh.Indices.size());
+		lod.IndexCount = static_cast<uint32_t>(count);
+		lod.Error = lods.back().Error + error;
+		lods.push_back(lod);
+
+		mesh.Indices.insert(mesh.Indices.end(), simplified.begin(), simplified.begin() + count);
+		previous.assign(simplified.begin(), simplified.begin() + count);
+	}
+
+	for (size_t level = 0; level < lods.size(); level++)
+		RAYD_INFO("LOD {0} of {1}: {2} triangles ({3:.0f}%), error {4:.5f}", level, name, lods[level].IndexCount / 3,
+			baseCount ? 100.0 * lods[level].IndexCount / baseCount : 0.0, lods[level].Error);
+}
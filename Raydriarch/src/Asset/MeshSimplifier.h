@@ -0,0 +1,39 @@
+#pragma once
+
+#include "MeshData.h"
+
+//Levels of detail per mesh, the full-resolution one included
+#define MESH_LOD_COUNT 4
+//Each level targets this fraction of the previous level's triangles
+#define MESH_LOD_RATIO 0.5f
+//Largest error a level may reach, as a fraction of the mesh's bounding radius; the chain stops early past it
+#define MESH_LOD_MAX_ERROR 0.05f
+//A level that removes less than this fraction of its predecessor's triangles is not worth a draw range
+#define MESH_LOD_MIN_REDUCTION 0.15f
+
+//One level of detail: a range of the mesh's shared index buffer and the meshlets built over it
+struct MeshLod {
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	uint32_t FirstMeshlet;
+	uint32_t MeshletCount;
+	//Largest distance, in model units, the level's surface may sit from the full-resolution one
+	float Error;
+};
+
+//CPU-only quadric edge-collapse simplification; vertices only ever collapse onto existing vertices, so every level
+//indexes the same vertex buffer. Results depend on nothing but the input, so they can be compared across runs.
+class MeshSimplifier {
+public:
+	MeshSimplifier() = delete;
+
+	//Collapses edges until at most targetIndexCount indices remain or the next collapse would exceed maxError; returns
+	//the index count written to output, which must hold indexCount entries. Open borders and UV seams only collapse
+	//along themselves, so the outline and texture layout survive.
+	static size_t Simplify(const MeshVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+		size_t targetIndexCount, float maxError, uint32_t* output, float* resultError = nullptr);
+
+	//Appends each coarser level's indices after the full-resolution ones and describes every level in lods, the first
+	//being the original index range; meshlet ranges are left for MeshletBuilder to fill
+	static void GenerateLods(MeshData& mesh, std::vector<MeshLod>& lods, const std::string& name);
+};
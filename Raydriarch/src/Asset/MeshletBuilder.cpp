@@ -0,0 +1,100 @@
+#include "raydpch.h"
+#include "MeshletBuilder.h"
+
+static void FinishMeshlet(const MeshData& mesh, Meshlet& meshlet, const std::vector<uint32_t>& vertices)
+{
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+	for (uint32_t v : vertices) {
+		minPos = glm::min(minPos, mesh.Vertices[v].Position);
+		maxPos = glm::max(maxPos, mesh.Vertices[v].Position);
+	}
+	glm::vec3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t v : vertices)
+		radius = std::max(radius, glm::length(mesh.Vertices[v].Position - center));
+	meshlet.Sphere = glm::vec4(center, radius);
+	meshlet.VertexCount = static_cast<uint32_t>(vertices.size());
+
+	//The cone is built from face normals, so it holds whether or not the source had vertex normals
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.IndexCount / 3);
+	glm::vec3 axis(0.0f);
+	for (uint32_t i = meshlet.FirstIndex; i < meshlet.FirstIndex + meshlet.IndexCount; i += 3) {
+		const glm::vec3& p0 = mesh.Vertices[mesh.Indices[i + 0]].Position;
+		const glm::vec3& p1 = mesh.Vertices[mesh.Indices[i + 1]].Position;
+		const glm::vec3& p2 = mesh.Vertices[mesh.Indices[i + 2]].Position;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+		normals.push_back(normal / length);
+		axis += normals.back();
+	}
+
+	meshlet.Cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float axisLength = glm::length(axis);
+	if (normals.empty() || axisLength == 0.0f)
+		return;
+
+	axis /= axisLength;
+	float minDot = 1.0f;
+	for (auto& normal : normals)
+		minDot = std::min(minDot, glm::dot(normal, axis));
+
+	//Normals spread over a hemisphere or more leave no direction from which every triangle faces away
+	if (minDot > 0.0f)
+		meshlet.Cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+}
+
+void MeshletBuilder::Build(const MeshData& mesh, uint32_t firstIndex, uint32_t indexCount, std::vector<Meshlet>& meshlets)
+{
+	//Stamp per vertex instead of a set per cluster, so a vertex is "in the current meshlet" in O(1)
+	constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> stamp(mesh.Vertices.size(), none);
+	std::vector<uint32_t> vertices;
+	vertices.reserve(MESHLET_MAX_VERTICES);
+
+	Meshlet meshlet{};
+	meshlet.FirstIndex = firstIndex;
+	size_t endIndex = static_cast<size_t>(firstIndex) + indexCount;
+	for (size_t i = firstIndex; i + 2 < endIndex; i += 3) {
+		uint32_t id = static_cast<uint32_t>(meshlets.size());
+		uint32_t newVertices = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t v = mesh.Indices[i + k];
+			newVertices += stamp[v] != id && std::find(mesh.Indices.begin() + i, mesh.Indices.begin() + i + k, v) == mesh.Indices.begin() + i + k;
+		}
+
+		if (vertices.size() + newVertices > MESHLET_MAX_VERTICES || meshlet.IndexCount / 3 >= MESHLET_MAX_TRIANGLES) {
+			FinishMeshlet(mesh, meshlet, vertices);
+			meshlets.push_back(meshlet);
+			meshlet = {};
+			meshlet.FirstIndex = static_cast<uint32_t>(i);
+			vertices.clear();
+			id++;
+		}
+
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t v = mesh.Indices[i + k];
+			if (stamp[v] != id) {
+				stamp[v] = id;
+				vertices.push_back(v);
+			}
+		}
+		meshlet.IndexCount += 3;
+	}
+
+	if (meshlet.IndexCount > 0) {
+		FinishMeshlet(mesh, meshlet, vertices);
+		meshlets.push_back(meshlet);
+	}
+}
+
+bool MeshletBuilder::IsBackFacing(const Meshlet& meshlet, const glm::vec3& eye)
+{
+	glm::vec3 center(meshlet.Sphere);
+	glm::vec3 axis(meshlet.Cone);
+	glm::vec3 toCenter = center - eye;
+	return glm::dot(toCenter, axis) >= meshlet.Cone.w * glm::length(toCenter) + meshlet.Sphere.w;
+}
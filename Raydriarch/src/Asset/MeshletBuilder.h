@@ -0,0 +1,28 @@
+#pragma once
+
+#include "MeshData.h"
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+//A run of the mesh's index buffer touching at most MESHLET_MAX_VERTICES vertices; laid out to match MeshletData in Meshlet.comp
+struct Meshlet {
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	uint32_t VertexCount;
+	uint32_t Padding;
+	glm::vec4 Sphere;
+	//Average facing in xyz; w is the sine of the widest angle any triangle leans away from it, 1 when the cluster cannot be back-face culled
+	glm::vec4 Cone;
+};
+
+class MeshletBuilder {
+public:
+	MeshletBuilder() = delete;
+
+	//Splits a range of the index buffer, in its current order, into consecutive clusters appended to meshlets; run it after
+	//MeshOptimizer so clusters are compact
+	static void Build(const MeshData& mesh, uint32_t firstIndex, uint32_t indexCount, std::vector<Meshlet>& meshlets);
+	//True when no triangle of the cluster can face a viewer at eye
+	static bool IsBackFacing(const Meshlet& meshlet, const glm::vec3& eye);
+};
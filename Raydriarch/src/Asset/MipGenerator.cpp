@@ -0,0 +1,239 @@
+#include "raydpch.h"
+#include "MipGenerator.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define MIP_GENERATOR_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		//MSVC compiles AVX2 intrinsics without /arch, the CPU check alone guards them
+		#define MIP_TARGET_AVX2
+	#else
+		#define MIP_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+//Resolution of the tables that quantize filtered values back to 8 bits; fine enough that the dark end of the sRGB curve,
+//where a linear step covers the most codes, still rounds to the nearest one
+#define MIP_ENCODE_STEPS 65535
+
+struct MipTables {
+	float SrgbToLinear[256];
+	float UnormToFloat[256];
+	uint8_t LinearToSrgb[MIP_ENCODE_STEPS + 1];
+	uint8_t FloatToUnorm[MIP_ENCODE_STEPS + 1];
+
+	MipTables() {
+		for (uint32_t i = 0; i < 256; i++) {
+			float value = i / 255.0f;
+			SrgbToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+			UnormToFloat[i] = value;
+		}
+		for (uint32_t i = 0; i <= MIP_ENCODE_STEPS; i++) {
+			float value = static_cast<float>(i) / MIP_ENCODE_STEPS;
+			float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+			LinearToSrgb[i] = static_cast<uint8_t>(std::lround(std::clamp(encoded, 0.0f, 1.0f) * 255.0f));
+			FloatToUnorm[i] = static_cast<uint8_t>(std::lround(value * 255.0f));
+		}
+	}
+};
+
+static const MipTables& GetTables()
+{
+	static MipTables tables;
+	return tables;
+}
+
+//Per-channel decode and encode tables; alpha always takes the plain ones
+struct ChannelTables {
+	const float* Decode[4];
+	const uint8_t* Encode[4];
+};
+
+static void DecodeRow(const uint8_t* pixels, uint32_t width, const ChannelTables& tables, float* row)
+{
+	for (uint32_t i = 0; i < width * 4; i += 4)
+		for (uint32_t c = 0; c < 4; c++)
+			row[i + c] = tables.Decode[c][pixels[i + c]];
+}
+
+//Sums run vertical pair first, then horizontal, in every path so they all round the same way
+static inline float FilterTexel(const float* row0, const float* row1, uint32_t x0, uint32_t x1)
+{
+	return ((row0[x0] + row1[x0]) + (row0[x1] + row1[x1])) * 0.25f;
+}
+
+static void FilterRowScalar(const float* row0, const float* row1, uint32_t sourceWidth, float* out, uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x++) {
+		uint32_t x0 = std::min(x * 2, sourceWidth - 1);
+		uint32_t x1 = std::min(x * 2 + 1, sourceWidth - 1);
+		for (uint32_t c = 0; c < 4; c++)
+			out[x * 4 + c] = FilterTexel(row0, row1, x0 * 4 + c, x1 * 4 + c);
+	}
+}
+
+static void EncodeRowScalar(const float* row, uint32_t width, const ChannelTables& tables, uint8_t* pixels)
+{
+	for (uint32_t i = 0; i < width * 4; i += 4)
+		for (uint32_t c = 0; c < 4; c++) {
+			//nearbyint rounds half to even, like the vector conversions under the default rounding mode
+			int32_t index = static_cast<int32_t>(std::nearbyint(std::clamp(row[i + c], 0.0f, 1.0f) * MIP_ENCODE_STEPS));
+			pixels[i + c] = tables.Encode[c][index];
+		}
+}
+
+#ifdef MIP_GENERATOR_X86
+//One texel is one register, so both source columns of an output texel are a single load each
+static void FilterRowSSE2(const float* row0, const float* row1, float* out, uint32_t width)
+{
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for (uint32_t x = 0; x < width; x++) {
+		__m128 left = _mm_add_ps(_mm_loadu_ps(row0 + x * 8), _mm_loadu_ps(row1 + x * 8));
+		__m128 right = _mm_add_ps(_mm_loadu_ps(row0 + x * 8 + 4), _mm_loadu_ps(row1 + x * 8 + 4));
+		_mm_storeu_ps(out + x * 4, _mm_mul_ps(_mm_add_ps(left, right), quarter));
+	}
+}
+
+static void EncodeRowSSE2(const float* row, uint32_t width, const ChannelTables& tables, uint8_t* pixels)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 steps = _mm_set1_ps(static_cast<float>(MIP_ENCODE_STEPS));
+	alignas(16) int32_t indices[4];
+	for (uint32_t x = 0; x < width; x++) {
+		__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + x * 4), zero), one);
+		_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvtps_epi32(_mm_mul_ps(value, steps)));
+		for (uint32_t c = 0; c < 4; c++)
+			pixels[x * 4 + c] = tables.Encode[c][indices[c]];
+	}
+}
+
+//Two output texels per iteration: the vertical sums of four source texels are regrouped into left and right columns
+MIP_TARGET_AVX2 static void FilterRowAVX2(const float* row0, const float* row1, float* out, uint32_t width)
+{
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+	uint32_t x = 0;
+	for (; x + 2 <= width; x += 2) {
+		__m256 first = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+		__m256 second = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+		__m256 left = _mm256_permute2f128_ps(first, second, 0x20);
+		__m256 right = _mm256_permute2f128_ps(first, second, 0x31);
+		_mm256_storeu_ps(out + x * 4, _mm256_mul_ps(_mm256_add_ps(left, right), quarter));
+	}
+	for (; x < width; x++)
+		for (uint32_t c = 0; c < 4; c++)
+			out[x * 4 + c] = FilterTexel(row0, row1, x * 8 + c, x * 8 + 4 + c);
+}
+
+MIP_TARGET_AVX2 static void EncodeRowAVX2(const float* row, uint32_t width, const ChannelTables& tables, uint8_t* pixels)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 steps = _mm256_set1_ps(static_cast<float>(MIP_ENCODE_STEPS));
+	alignas(32) int32_t indices[8];
+	uint32_t x = 0;
+	for (; x + 2 <= width; x += 2) {
+		__m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(row + x * 4), zero), one);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(indices), _mm256_cvtps_epi32(_mm256_mul_ps(value, steps)));
+		for (uint32_t c = 0; c < 8; c++)
+			pixels[x * 4 + c] = tables.Encode[c & 3][indices[c]];
+	}
+	EncodeRowScalar(row + x * 4, width - x, tables, pixels + x * 4);
+}
+#endif
+
+SimdLevel MipGenerator::GetSupportedLevel()
+{
+#ifdef MIP_GENERATOR_X86
+	#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] >= 7) {
+			__cpuid(info, 1);
+			//The OS must also save the wide registers on context switches
+			bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			if (osAvx && (info[1] & (1 << 5)))
+				return SimdLevel::AVX2;
+		}
+	#else
+		if (__builtin_cpu_supports("avx2"))
+			return SimdLevel::AVX2;
+	#endif
+	//Part of the x86-64 baseline
+	return SimdLevel::SSE2;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+const char* MipGenerator::GetLevelName(SimdLevel level)
+{
+	switch (level) {
+	case SimdLevel::Scalar: return "scalar";
+	case SimdLevel::SSE2: return "SSE2";
+	case SimdLevel::AVX2: return "AVX2";
+	}
+	return "unknown";
+}
+
+void MipGenerator::Generate(TextureData& texture, bool srgb, SimdLevel level, ThreadPool* workers)
+{
+	RAYD_ASSERT(!texture.Levels.empty(), "Mip chain needs a base level!");
+	RAYD_ASSERT(level <= GetSupportedLevel(), "Mip filter path is not supported on this CPU!");
+
+	const MipTables& lookup = GetTables();
+	ChannelTables tables;
+	for (uint32_t c = 0; c < 4; c++) {
+		bool color = srgb && c < 3;
+		tables.Decode[c] = color ? lookup.SrgbToLinear : lookup.UnormToFloat;
+		tables.Encode[c] = color ? lookup.LinearToSrgb : lookup.FloatToUnorm;
+	}
+
+	uint32_t levelCount = GetMipLevelCount(texture.Levels[0].Width, texture.Levels[0].Height);
+	texture.Levels.resize(levelCount);
+	for (uint32_t mip = 1; mip < levelCount; mip++) {
+		const TextureLevel& source = texture.Levels[mip - 1];
+		TextureLevel& target = texture.Levels[mip];
+		target.Width = std::max(source.Width / 2, 1u);
+		target.Height = std::max(source.Height / 2, 1u);
+		target.Pixels.resize(static_cast<size_t>(target.Width) * target.Height * 4);
+
+		//An odd source dimension drops its last row or column, the same footprint a linear blit samples. The vector
+		//paths need two source columns per output texel, which every level but a one-texel-wide one has.
+		SimdLevel rowLevel = source.Width > 1 ? level : SimdLevel::Scalar;
+		auto filterRow = [&](uint32_t y) {
+			std::vector<float> rows(static_cast<size_t>(source.Width) * 8 + static_cast<size_t>(target.Width) * 4);
+			float* row0 = rows.data();
+			float* row1 = row0 + source.Width * 4;
+			float* out = row1 + source.Width * 4;
+			DecodeRow(&source.Pixels[static_cast<size_t>(std::min(y * 2, source.Height - 1)) * source.Width * 4], source.Width, tables, row0);
+			DecodeRow(&source.Pixels[static_cast<size_t>(std::min(y * 2 + 1, source.Height - 1)) * source.Width * 4], source.Width, tables, row1);
+
+			uint8_t* pixels = &target.Pixels[static_cast<size_t>(y) * target.Width * 4];
+			switch (rowLevel) {
+#ifdef MIP_GENERATOR_X86
+			case SimdLevel::AVX2:
+				FilterRowAVX2(row0, row1, out, target.Width);
+				EncodeRowAVX2(out, target.Width, tables, pixels);
+				break;
+			case SimdLevel::SSE2:
+				FilterRowSSE2(row0, row1, out, target.Width);
+				EncodeRowSSE2(out, target.Width, tables, pixels);
+				break;
+#endif
+			default:
+				FilterRowScalar(row0, row1, source.Width, out, target.Width);
+				EncodeRowScalar(out, target.Width, tables, pixels);
+				break;
+			}
+		};
+
+		if (workers && target.Height > 1)
+			workers->ParallelFor(target.Height, filterRow);
+		else
+			for (uint32_t y = 0; y < target.Height; y++)
+				filterRow(y);
+	}
+}
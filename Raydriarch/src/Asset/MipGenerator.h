@@ -0,0 +1,26 @@
+#pragma once
+
+#include "TextureData.h"
+#include "Core/ThreadPool.h"
+
+//Instruction sets the mip filter has a path for
+enum class SimdLevel {
+	Scalar,
+	SSE2,
+	AVX2
+};
+
+//Builds a texture's mip chain on the CPU at bake time, replacing the chain of GPU blits. Each level is a 2x2 box filter
+//of the one above it; sRGB colour is decoded to linear before averaging and re-encoded after, alpha and non-colour data
+//are averaged as stored. Every path rounds identically, so the output does not depend on the CPU it was baked on.
+class MipGenerator {
+public:
+	MipGenerator() = delete;
+
+	//Widest path both the build target and the running CPU support
+	static SimdLevel GetSupportedLevel();
+	static const char* GetLevelName(SimdLevel level);
+
+	//Fills every level below the first; rows of each level are spread over the workers when given
+	static void Generate(TextureData& texture, bool srgb, SimdLevel level = GetSupportedLevel(), ThreadPool* workers = nullptr);
+};
@@ -0,0 +1,491 @@
+#include "raydpch.h"
+#include "ObjImporter.h"
+
+#include "Core/MappedFile.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+namespace std {
+	template<> struct hash<MeshVertex> {
+		size_t operator()(MeshVertex const& vertex) const {
+			return ((hash<glm::vec3>()(vertex.Position) ^
+				(hash<glm::vec3>()(vertex.Normal) << 1)) >> 1) ^
+				(hash<glm::vec2>()(vertex.TexCoord) << 1);
+		}
+	};
+}
+
+//Chunks below this size cost more in scheduling than they save in parsing
+static constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+static constexpr uint32_t CHUNKS_PER_WORKER = 4;
+//Hash bits above the table index pick the shard, so every shard sees well-mixed keys
+static constexpr uint32_t DEDUP_SHARD_BITS = 6;
+static constexpr uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+
+//Negative OBJ indices count back from the end of the attributes parsed so far, which a chunk only
+//knows relative to its own start; those are rebased once every chunk's attribute count is known
+static constexpr uint32_t CORNER_RELATIVE_POSITION = 1 << 0;
+static constexpr uint32_t CORNER_RELATIVE_TEXCOORD = 1 << 1;
+static constexpr uint32_t CORNER_RELATIVE_NORMAL = 1 << 2;
+static constexpr uint32_t CORNER_NO_TEXCOORD = 1 << 3;
+static constexpr uint32_t CORNER_NO_NORMAL = 1 << 4;
+//First of the six corners a quad expands to; its diagonal is picked once all positions are known
+static constexpr uint32_t CORNER_QUAD = 1 << 5;
+
+struct ObjCorner {
+	int64_t Position;
+	int64_t TexCoord;
+	int64_t Normal;
+	uint32_t Flags;
+};
+
+struct ObjChunk {
+	const char* Begin;
+	const char* End;
+	std::vector<float> Positions;
+	std::vector<float> TexCoords;
+	std::vector<float> Normals;
+	std::vector<ObjCorner> Corners;
+	size_t FirstPosition;
+	size_t FirstTexCoord;
+	size_t FirstNormal;
+	size_t FirstCorner;
+	bool Failed;
+};
+
+static inline uint64_t MixBits(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ull;
+	key ^= key >> 33;
+	return key;
+}
+
+//Hashes the exact bits of the vertex, so it agrees with the memcmp used to resolve collisions
+static inline uint64_t HashVertex(const MeshVertex& vertex)
+{
+	static_assert(sizeof(MeshVertex) % sizeof(uint64_t) == 0, "MeshVertex must pack into whole words");
+	uint64_t words[sizeof(MeshVertex) / sizeof(uint64_t)];
+	memcpy(words, &vertex, sizeof(MeshVertex));
+
+	uint64_t hash = 0x9e3779b97f4a7c15ull;
+	for (uint64_t word : words)
+		hash = MixBits(hash ^ word) + 0x9e3779b97f4a7c15ull;
+	return hash;
+}
+
+static inline uint32_t NextPowerOfTwo(uint32_t value)
+{
+	uint32_t result = 1;
+	while (result < value)
+		result <<= 1;
+	return result;
+}
+
+static inline const char* SkipSpaces(const char* it, const char* end)
+{
+	while (it < end && (*it == ' ' || *it == '\t'))
+		it++;
+	return it;
+}
+
+static inline const char* ParseFloats(const char* it, const char* end, float* values, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		it = SkipSpaces(it, end);
+		if (it < end && *it == '+')
+			it++;
+		auto result = std::from_chars(it, end, values[i]);
+		if (result.ec != std::errc())
+			return nullptr;
+		it = result.ptr;
+	}
+	return it;
+}
+
+//Resolves one OBJ index against the number of attributes this chunk has parsed so far
+static inline bool ParseIndex(const char*& it, const char* end, size_t localCount, int64_t& index, bool& relative)
+{
+	int64_t value = 0;
+	auto result = std::from_chars(it, end, value);
+	if (result.ec != std::errc() || value == 0)
+		return false;
+	it = result.ptr;
+
+	relative = value < 0;
+	index = relative ? static_cast<int64_t>(localCount) + value : value - 1;
+	return true;
+}
+
+static bool ParseFace(const char* it, const char* end, ObjChunk& chunk)
+{
+	ObjCorner first{}, previous{};
+	uint32_t cornerCount = 0;
+	while (true) {
+		it = SkipSpaces(it, end);
+		if (it == end || *it == '\r' || *it == '#')
+			break;
+
+		ObjCorner corner{};
+		bool relative;
+		if (!ParseIndex(it, end, chunk.Positions.size() / 3, corner.Position, relative))
+			return false;
+		corner.Flags |= relative ? CORNER_RELATIVE_POSITION : 0;
+
+		corner.Flags |= CORNER_NO_TEXCOORD | CORNER_NO_NORMAL;
+		if (it < end && *it == '/') {
+			it++;
+			if (it < end && *it != '/') {
+				if (!ParseIndex(it, end, chunk.TexCoords.size() / 2, corner.TexCoord, relative))
+					return false;
+				corner.Flags &= ~CORNER_NO_TEXCOORD;
+				corner.Flags |= relative ? CORNER_RELATIVE_TEXCOORD : 0;
+			}
+			if (it < end && *it == '/') {
+				it++;
+				if (!ParseIndex(it, end, chunk.Normals.size() / 3, corner.Normal, relative))
+					return false;
+				corner.Flags &= ~CORNER_NO_NORMAL;
+				corner.Flags |= relative ? CORNER_RELATIVE_NORMAL : 0;
+			}
+		}
+
+		//Fan triangulation, matching what tinyobjloader does for convex polygons other than quads
+		if (cornerCount == 0)
+			first = corner;
+		else if (cornerCount >= 2) {
+			chunk.Corners.push_back(first);
+			chunk.Corners.push_back(previous);
+			chunk.Corners.push_back(corner);
+		}
+		previous = corner;
+		cornerCount++;
+	}
+
+	if (cornerCount == 4)
+		chunk.Corners[chunk.Corners.size() - 6].Flags |= CORNER_QUAD;
+	return cornerCount >= 3;
+}
+
+static void ParseChunk(ObjChunk& chunk)
+{
+	//Rough per-line reservations keep the vectors from regrowing more than a couple of times
+	size_t estimatedLines = (chunk.End - chunk.Begin) / 24;
+	chunk.Positions.reserve(estimatedLines * 3 / 2);
+	chunk.Corners.reserve(estimatedLines * 3);
+
+	const char* it = chunk.Begin;
+	while (it < chunk.End) {
+		const char* lineEnd = static_cast<const char*>(memchr(it, '\n', chunk.End - it));
+		if (!lineEnd)
+			lineEnd = chunk.End;
+
+		it = SkipSpaces(it, lineEnd);
+		bool parsed = true;
+		if (lineEnd - it > 2 && it[0] == 'v' && it[1] == ' ') {
+			float position[3];
+			parsed = ParseFloats(it + 2, lineEnd, position, 3) != nullptr;
+			chunk.Positions.insert(chunk.Positions.end(), position, position + 3);
+		}
+		else if (lineEnd - it > 3 && it[0] == 'v' && it[1] == 't' && it[2] == ' ') {
+			float texCoord[2];
+			parsed = ParseFloats(it + 3, lineEnd, texCoord, 2) != nullptr;
+			chunk.TexCoords.insert(chunk.TexCoords.end(), texCoord, texCoord + 2);
+		}
+		else if (lineEnd - it > 3 && it[0] == 'v' && it[1] == 'n' && it[2] == ' ') {
+			float normal[3];
+			parsed = ParseFloats(it + 3, lineEnd, normal, 3) != nullptr;
+			chunk.Normals.insert(chunk.Normals.end(), normal, normal + 3);
+		}
+		else if (lineEnd - it > 2 && it[0] == 'f' && it[1] == ' ')
+			parsed = ParseFace(it + 2, lineEnd, chunk);
+
+		if (!parsed) {
+			chunk.Failed = true;
+			return;
+		}
+		it = lineEnd + 1;
+	}
+}
+
+bool ObjImporter::Import(const std::string& path, MeshData& mesh, ThreadPool* workers)
+{
+	MappedFile file(path);
+	if (!file.IsOpen()) {
+		RAYD_ERROR("Failed to open {0}", path);
+		return false;
+	}
+
+	auto parallelFor = [workers](uint32_t count, const std::function<void(uint32_t)>& task) {
+		if (workers)
+			workers->ParallelFor(count, task);
+		else
+			for (uint32_t i = 0; i < count; i++)
+				task(i);
+	};
+
+	//Split on line boundaries so every chunk parses independently
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+	uint32_t chunkCount = workers ? workers->GetThreadCount() * CHUNKS_PER_WORKER : 1;
+	chunkCount = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(chunkCount, size / MIN_CHUNK_BYTES)));
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* begin = data;
+	for (uint32_t i = 0; i < chunkCount; i++) {
+		const char* end = data + size * (i + 1) / chunkCount;
+		if (i + 1 < chunkCount) {
+			const char* lineEnd = static_cast<const char*>(memchr(end, '\n', data + size - end));
+			end = lineEnd ? lineEnd + 1 : data + size;
+		}
+		chunks[i].Begin = begin;
+		chunks[i].End = std::max(begin, end);
+		begin = chunks[i].End;
+	}
+
+	parallelFor(chunkCount, [&](uint32_t i) { ParseChunk(chunks[i]); });
+
+	size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+	for (auto& chunk : chunks) {
+		if (chunk.Failed) {
+			RAYD_ERROR("Failed to parse {0}", path);
+			return false;
+		}
+		chunk.FirstPosition = positionCount;
+		chunk.FirstTexCoord = texCoordCount;
+		chunk.FirstNormal = normalCount;
+		chunk.FirstCorner = cornerCount;
+		positionCount += chunk.Positions.size() / 3;
+		texCoordCount += chunk.TexCoords.size() / 2;
+		normalCount += chunk.Normals.size() / 3;
+		cornerCount += chunk.Corners.size();
+	}
+	if (cornerCount >= EMPTY_SLOT) {
+		RAYD_ERROR("{0} has too many face corners to index with 32 bits", path);
+		return false;
+	}
+
+	std::vector<float> positions(positionCount * 3);
+	std::vector<float> texCoords(texCoordCount * 2);
+	std::vector<float> normals(normalCount * 3);
+	parallelFor(chunkCount, [&](uint32_t i) {
+		auto& chunk = chunks[i];
+		std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + chunk.FirstPosition * 3);
+		std::copy(chunk.TexCoords.begin(), chunk.TexCoords.end(), texCoords.begin() + chunk.FirstTexCoord * 2);
+		std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + chunk.FirstNormal * 3);
+	});
+
+	//Expand every face corner into a full vertex and hash it
+	std::vector<MeshVertex> corners(cornerCount);
+	std::vector<uint64_t> hashes(cornerCount);
+	std::atomic<bool> outOfRange = false;
+	parallelFor(chunkCount, [&](uint32_t i) {
+		auto& chunk = chunks[i];
+		auto resolvePosition = [&](const ObjCorner& corner) {
+			return corner.Position + ((corner.Flags & CORNER_RELATIVE_POSITION) ? static_cast<int64_t>(chunk.FirstPosition) : 0);
+		};
+		auto validPosition = [&](int64_t position) { return position >= 0 && position < static_cast<int64_t>(positionCount); };
+
+		for (size_t c = 0; c < chunk.Corners.size(); c++) {
+			const ObjCorner& corner = chunk.Corners[c];
+			int64_t position = resolvePosition(corner);
+			int64_t texCoord = corner.TexCoord + ((corner.Flags & CORNER_RELATIVE_TEXCOORD) ? chunk.FirstTexCoord : 0);
+			int64_t normal = corner.Normal + ((corner.Flags & CORNER_RELATIVE_NORMAL) ? chunk.FirstNormal : 0);
+			bool hasTexCoord = !(corner.Flags & CORNER_NO_TEXCOORD);
+			bool hasNormal = !(corner.Flags & CORNER_NO_NORMAL);
+			if (!validPosition(position) || (hasTexCoord && (texCoord < 0 || texCoord >= static_cast<int64_t>(texCoordCount))) ||
+				(hasNormal && (normal < 0 || normal >= static_cast<int64_t>(normalCount)))) {
+				outOfRange = true;
+				return;
+			}
+
+			//Split quads along their shorter diagonal like tinyobjloader: [0, 1, 2], [0, 2, 3] or [0, 1, 3], [1, 2, 3]
+			if (corner.Flags & CORNER_QUAD) {
+				ObjCorner* quad = &chunk.Corners[c];
+				ObjCorner q[4] = { quad[0], quad[1], quad[2], quad[5] };
+				int64_t p[4];
+				for (uint32_t k = 0; k < 4; k++) {
+					p[k] = resolvePosition(q[k]);
+					if (!validPosition(p[k])) {
+						outOfRange = true;
+						return;
+					}
+				}
+				auto at = [&](int64_t index) { return glm::vec3(positions[3 * index + 0], positions[3 * index + 1], positions[3 * index + 2]); };
+				glm::vec3 e02 = at(p[2]) - at(p[0]), e13 = at(p[3]) - at(p[1]);
+				if (glm::dot(e02, e02) >= glm::dot(e13, e13)) {
+					quad[2] = q[3];
+					quad[3] = q[1];
+					quad[4] = q[2];
+					quad[5] = q[3];
+				}
+			}
+
+			MeshVertex& vertex = corners[chunk.FirstCorner + c];
+			vertex = MeshVertex{};
+			vertex.Position = { positions[3 * position + 0], positions[3 * position + 1], positions[3 * position + 2] };
+			vertex.TexCoord = hasTexCoord ? glm::vec2(texCoords[2 * texCoord + 0], 1.0f - texCoords[2 * texCoord + 1]) : glm::vec2(0.0f, 1.0f);
+			vertex.Normal = hasNormal ? glm::vec3(normals[3 * normal + 0], normals[3 * normal + 1], normals[3 * normal + 2]) : glm::vec3(0.0f);
+			hashes[chunk.FirstCorner + c] = HashVertex(vertex);
+		}
+	});
+	if (outOfRange) {
+		RAYD_ERROR("{0} references a vertex that does not exist", path);
+		return false;
+	}
+	chunks.clear();
+	positions = {};
+	texCoords = {};
+	normals = {};
+
+	//Corner ranges for the remaining passes, independent of how the file happened to split
+	uint32_t rangeCount = workers ? workers->GetThreadCount() * CHUNKS_PER_WORKER : 1;
+	rangeCount = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(rangeCount, cornerCount / 4096)));
+	auto rangeBegin = [&](uint32_t range) { return cornerCount * range / rangeCount; };
+
+	//Bucket corners by shard, keeping them in file order within each shard
+	uint32_t shardCount = workers ? 1u << DEDUP_SHARD_BITS : 1;
+	auto shardOf = [shardCount](uint64_t hash) { return static_cast<uint32_t>(hash >> (64 - DEDUP_SHARD_BITS)) & (shardCount - 1); };
+	std::vector<uint32_t> shardCounts(static_cast<size_t>(rangeCount) * shardCount, 0);
+	parallelFor(rangeCount, [&](uint32_t range) {
+		uint32_t* counts = &shardCounts[static_cast<size_t>(range) * shardCount];
+		for (size_t c = rangeBegin(range); c < rangeBegin(range + 1); c++)
+			counts[shardOf(hashes[c])]++;
+	});
+
+	std::vector<uint32_t> shardStarts(shardCount + 1, 0);
+	std::vector<uint32_t> scatterOffsets(shardCounts.size());
+	uint32_t offset = 0;
+	for (uint32_t shard = 0; shard < shardCount; shard++) {
+		shardStarts[shard] = offset;
+		for (uint32_t range = 0; range < rangeCount; range++) {
+			scatterOffsets[static_cast<size_t>(range) * shardCount + shard] = offset;
+			offset += shardCounts[static_cast<size_t>(range) * shardCount + shard];
+		}
+	}
+	shardStarts[shardCount] = offset;
+
+	std::vector<uint32_t> shardCorners(cornerCount);
+	parallelFor(rangeCount, [&](uint32_t range) {
+		uint32_t* offsets = &scatterOffsets[static_cast<size_t>(range) * shardCount];
+		for (size_t c = rangeBegin(range); c < rangeBegin(range + 1); c++)
+			shardCorners[offsets[shardOf(hashes[c])]++] = static_cast<uint32_t>(c);
+	});
+
+	//Open addressing with linear probing per shard; the first corner with a given vertex represents it
+	std::vector<uint32_t> representatives(cornerCount);
+	parallelFor(shardCount, [&](uint32_t shard) {
+		uint32_t count = shardStarts[shard + 1] - shardStarts[shard];
+		uint32_t capacity = NextPowerOfTwo(std::max(16u, count * 2));
+		std::vector<uint32_t> table(capacity, EMPTY_SLOT);
+		for (uint32_t s = shardStarts[shard]; s < shardStarts[shard + 1]; s++) {
+			uint32_t corner = shardCorners[s];
+			uint64_t hash = hashes[corner];
+			uint32_t slot = static_cast<uint32_t>(hash) & (capacity - 1);
+			while (true) {
+				uint32_t existing = table[slot];
+				if (existing == EMPTY_SLOT) {
+					table[slot] = corner;
+					representatives[corner] = corner;
+					break;
+				}
+				if (hashes[existing] == hash && memcmp(&corners[existing], &corners[corner], sizeof(MeshVertex)) == 0) {
+					representatives[corner] = existing;
+					break;
+				}
+				slot = (slot + 1) & (capacity - 1);
+			}
+		}
+	});
+	shardCorners = {};
+
+	//Number unique vertices in first-seen order, so the output matches a sequential import exactly
+	std::vector<uint32_t> uniqueStarts(rangeCount + 1, 0);
+	parallelFor(rangeCount, [&](uint32_t range) {
+		uint32_t unique = 0;
+		for (size_t c = rangeBegin(range); c < rangeBegin(range + 1); c++)
+			unique += representatives[c] == c;
+		uniqueStarts[range + 1] = unique;
+	});
+	for (uint32_t range = 0; range < rangeCount; range++)
+		uniqueStarts[range + 1] += uniqueStarts[range];
+
+	mesh.Vertices.resize(uniqueStarts[rangeCount]);
+	mesh.Indices.resize(cornerCount);
+	std::vector<uint32_t> vertexIds(cornerCount);
+	parallelFor(rangeCount, [&](uint32_t range) {
+		uint32_t id = uniqueStarts[range];
+		for (size_t c = rangeBegin(range); c < rangeBegin(range + 1); c++) {
+			if (representatives[c] == c) {
+				vertexIds[c] = id;
+				mesh.Vertices[id++] = corners[c];
+			}
+		}
+	});
+	parallelFor(rangeCount, [&](uint32_t range) {
+		for (size_t c = rangeBegin(range); c < rangeBegin(range + 1); c++)
+			mesh.Indices[c] = vertexIds[representatives[c]];
+	});
+
+	mesh.Bounds = ComputeBounds(mesh.Vertices.data(), mesh.Vertices.size());
+	return true;
+}
+
+bool ObjImporter::ImportReference(const std::string& path, MeshData& mesh)
+{
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> mats;
+	tinyobj::attrib_t attrib;
+	std::string warn, err;
+	if (!tinyobj::LoadObj(&attrib, &shapes, &mats, &warn, &err, path.c_str())) {
+		RAYD_ERROR("Failed to load {0}: {1}", path, warn + err);
+		return false;
+	}
+
+	std::unordered_map<MeshVertex, uint32_t> uniqueVertices{};
+	mesh.Vertices.clear();
+	mesh.Indices.clear();
+	for (const auto& shape : shapes) {
+		for (const auto& index : shape.mesh.indices) {
+			MeshVertex vertex{};
+
+			vertex.Position = {
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2]
+			};
+
+			vertex.TexCoord = { 0.0f, 1.0f };
+			if (index.texcoord_index >= 0) {
+				vertex.TexCoord = {
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+				};
+			}
+
+			if (index.normal_index >= 0) {
+				vertex.Normal = {
+					attrib.normals[3 * index.normal_index + 0],
+					attrib.normals[3 * index.normal_index + 1],
+					attrib.normals[3 * index.normal_index + 2]
+				};
+			}
+
+			if (uniqueVertices.count(vertex) == 0) {
+				uniqueVertices[vertex] = static_cast<uint32_t>(mesh.Vertices.size());
+				mesh.Vertices.push_back(vertex);
+			}
+
+			mesh.Indices.push_back(uniqueVertices[vertex]);
+		}
+	}
+
+	mesh.Bounds = ComputeBounds(mesh.Vertices.data(), mesh.Vertices.size());
+	return true;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "MeshData.h"
+#include "Core/ThreadPool.h"
+
+class ObjImporter {
+public:
+	ObjImporter() = delete;
+	//Parses the file in line-aligned chunks across the workers and deduplicates vertices by their packed bits;
+	//without workers everything runs on the calling thread
+	static bool Import(const std::string& path, MeshData& mesh, ThreadPool* workers = nullptr);
+	//tinyobjloader-based importer the parallel path is validated and benchmarked against
+	static bool ImportReference(const std::string& path, MeshData& mesh);
+};
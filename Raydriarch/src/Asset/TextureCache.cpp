@@ -0,0 +1,135 @@
+#include "raydpch.h"
+#include "TextureCache.h"
+
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+
+#include <stb_image.h>
+
+static inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+TextureCache::TextureCache(const std::string& cachePath, const std::string& sourcePath, TextureFormat format, bool srgb)
+	:m_File(cachePath), m_Header(nullptr)
+{
+	if (!m_File.IsOpen() || m_File.GetSize() < sizeof(TextureCacheHeader))
+		return;
+
+	auto header = reinterpret_cast<const TextureCacheHeader*>(m_File.GetData());
+	if (header->Magic != TEXTURE_CACHE_MAGIC || header->Version != TEXTURE_CACHE_VERSION ||
+		header->Format != format || header->Srgb != static_cast<uint32_t>(srgb))
+		return;
+
+	//Bounds are compared by subtraction so a corrupt header cannot wrap them; every level has to be the next step of the
+	//chain, since the image's copy regions are sized from these extents
+	uint64_t fileSize = m_File.GetSize();
+	if (header->Width == 0 || header->Height == 0 || header->LevelCount == 0 || header->LevelCount > TEXTURE_CACHE_MAX_LEVELS ||
+		header->DataOffset > fileSize || header->DataSize > fileSize - header->DataOffset)
+		return;
+	for (uint32_t i = 0; i < header->LevelCount; i++) {
+		const TextureCacheLevel& level = header->Levels[i];
+		if (level.Width != std::max(header->Width >> i, 1u) || level.Height != std::max(header->Height >> i, 1u) ||
+			level.Offset > header->DataSize || level.Size > header->DataSize - level.Offset ||
+			level.Size != GetTextureLevelSize(format, level.Width, level.Height))
+			return;
+	}
+
+	//A cache shipped without its source is taken as-is
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (GetFileStamp(sourcePath, sourceSize, sourceTime) && (sourceSize != header->SourceSize || sourceTime != header->SourceTime))
+		return;
+
+	m_Header = header;
+}
+
+bool TextureCache::Write(const std::string& cachePath, const std::string& sourcePath, const BakedTexture& texture)
+{
+	RAYD_ASSERT(!texture.Levels.empty() && texture.Levels.size() <= TEXTURE_CACHE_MAX_LEVELS, "Texture has no levels or too many to cache!");
+
+	TextureCacheHeader header{};
+	header.Magic = TEXTURE_CACHE_MAGIC;
+	header.Version = TEXTURE_CACHE_VERSION;
+	header.Format = texture.Format;
+	header.Srgb = texture.Srgb;
+	header.Width = texture.Levels[0].Width;
+	header.Height = texture.Levels[0].Height;
+	header.LevelCount = static_cast<uint32_t>(texture.Levels.size());
+	GetFileStamp(sourcePath, header.SourceSize, header.SourceTime);
+	header.DataOffset = AlignUp(sizeof(TextureCacheHeader), TEXTURE_CACHE_ALIGNMENT);
+	header.DataSize = texture.Data.size();
+	std::copy(texture.Levels.begin(), texture.Levels.end(), header.Levels);
+
+	//Written beside the target and renamed over it, so a crash never leaves a torn cache behind
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream output(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!output)
+			return false;
+
+		std::vector<char> padding(TEXTURE_CACHE_ALIGNMENT, 0);
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(padding.data(), header.DataOffset - sizeof(header));
+		output.write(reinterpret_cast<const char*>(texture.Data.data()), texture.Data.size());
+		if (!output)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error) {
+		RAYD_WARN("Failed to write texture cache {0}: {1}", cachePath, error.message());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool TextureCache::Bake(const std::string& sourcePath, TextureFormat format, bool srgb, BakedTexture& texture, ThreadPool* workers)
+{
+	RAYD_PROFILE_SCOPE("TextureCache::Bake");
+	int32_t width = 0, height = 0, channelCount = 0;
+	stbi_uc* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channelCount, STBI_rgb_alpha);
+	if (!pixels) {
+		RAYD_ERROR("Failed to load texture {0}: {1}", sourcePath, stbi_failure_reason());
+		return false;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	TextureData source;
+	source.Levels.resize(1);
+	source.Levels[0].Width = static_cast<uint32_t>(width);
+	source.Levels[0].Height = static_cast<uint32_t>(height);
+	source.Levels[0].Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+	MipGenerator::Generate(source, srgb, MipGenerator::GetSupportedLevel(), workers);
+
+	texture.Format = format;
+	texture.Srgb = srgb;
+	texture.Levels.resize(source.Levels.size());
+	uint64_t dataSize = 0, rawSize = 0;
+	for (size_t i = 0; i < source.Levels.size(); i++) {
+		TextureCacheLevel& level = texture.Levels[i];
+		level.Width = source.Levels[i].Width;
+		level.Height = source.Levels[i].Height;
+		level.Offset = AlignUp(dataSize, TEXTURE_CACHE_ALIGNMENT);
+		level.Size = GetTextureLevelSize(format, level.Width, level.Height);
+		dataSize = level.Offset + level.Size;
+		rawSize += source.Levels[i].Pixels.size();
+	}
+
+	texture.Data.assign(dataSize, 0);
+	for (size_t i = 0; i < source.Levels.size(); i++)
+		BlockCompressor::Compress(source.Levels[i], format, texture.Data.data() + texture.Levels[i].Offset, workers);
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	RAYD_INFO("Baked {0} as {1}: {2} levels, {3:.2f} MB from {4:.2f} MB of RGBA8 in {5:.1f} ms", sourcePath, GetTextureFormatName(format),
+		texture.Levels.size(), dataSize / (1024.0 * 1024.0), rawSize / (1024.0 * 1024.0), ms);
+
+	if (!Write(GetCachePath(sourcePath), sourcePath, texture))
+		RAYD_WARN("Could not cache {0}, it will be compressed again on the next launch", sourcePath);
+	return true;
+}
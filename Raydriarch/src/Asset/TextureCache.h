@@ -0,0 +1,67 @@
+#pragma once
+
+#include "TextureData.h"
+#include "Core/MappedFile.h"
+#include "Core/ThreadPool.h"
+
+#define TEXTURE_CACHE_MAGIC 0x58455452
+//2: mips are filtered in linear space for sRGB textures, and RGBA8 is stored uncompressed
+#define TEXTURE_CACHE_VERSION 2
+//Levels start on this boundary, which covers every block size and the buffer-to-image copy offset rules
+#define TEXTURE_CACHE_ALIGNMENT 256
+//Enough for a 32768 texel edge
+#define TEXTURE_CACHE_MAX_LEVELS 16
+
+struct TextureCacheLevel {
+	uint32_t Width;
+	uint32_t Height;
+	//Relative to the start of the level data
+	uint64_t Offset;
+	uint64_t Size;
+};
+
+struct TextureCacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	TextureFormat Format;
+	//Nonzero when the texels are sRGB-encoded colour
+	uint32_t Srgb;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t LevelCount;
+	uint32_t Padding;
+	//Size and modification time of the source image, to detect a stale cache
+	uint64_t SourceSize;
+	int64_t SourceTime;
+	uint64_t DataOffset;
+	uint64_t DataSize;
+	TextureCacheLevel Levels[TEXTURE_CACHE_MAX_LEVELS];
+};
+
+//Encoded mip chain ready to be staged as one blob
+struct BakedTexture {
+	TextureFormat Format;
+	bool Srgb;
+	std::vector<TextureCacheLevel> Levels;
+	std::vector<uint8_t> Data;
+};
+
+//Versioned binary texture: a header followed by every mip level's texels, read through a file mapping
+class TextureCache {
+public:
+	TextureCache(const std::string& cachePath, const std::string& sourcePath, TextureFormat format, bool srgb);
+
+	static bool Write(const std::string& cachePath, const std::string& sourcePath, const BakedTexture& texture);
+	//Decodes the source, builds its mip chain and encodes every level, then writes its cache; the texture is usable even
+	//if the write fails. The workers, when given, share both the filtering and the encoding.
+	static bool Bake(const std::string& sourcePath, TextureFormat format, bool srgb, BakedTexture& texture, ThreadPool* workers = nullptr);
+	static inline std::string GetCachePath(const std::string& sourcePath) { return sourcePath + ".rtex"; }
+
+	//False when the file is missing, corrupt, from another version or format, or older than its source
+	inline bool IsValid() const { return m_Header != nullptr; }
+	inline const TextureCacheHeader& GetHeader() const { return *m_Header; }
+	inline const uint8_t* GetData() const { return reinterpret_cast<const uint8_t*>(m_File.GetData() + m_Header->DataOffset); }
+private:
+	MappedFile m_File;
+	const TextureCacheHeader* m_Header;
+};
@@ -0,0 +1,34 @@
+#include "raydpch.h"
+#include "TextureData.h"
+
+const char* GetTextureFormatName(TextureFormat format)
+{
+	switch (format) {
+	case TextureFormat::BC1: return "BC1";
+	case TextureFormat::BC3: return "BC3";
+	case TextureFormat::BC5: return "BC5";
+	case TextureFormat::BC7: return "BC7";
+	case TextureFormat::RGBA8: return "RGBA8";
+	}
+	return "unknown";
+}
+
+uint32_t GetTextureBlockSize(TextureFormat format)
+{
+	return format == TextureFormat::BC1 ? 8 : 16;
+}
+
+uint64_t GetTextureLevelSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+	if (format == TextureFormat::RGBA8)
+		return static_cast<uint64_t>(width) * height * 4;
+
+	uint64_t blocksX = (width + TEXTURE_BLOCK_DIMENSION - 1) / TEXTURE_BLOCK_DIMENSION;
+	uint64_t blocksY = (height + TEXTURE_BLOCK_DIMENSION - 1) / TEXTURE_BLOCK_DIMENSION;
+	return blocksX * blocksY * GetTextureBlockSize(format);
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
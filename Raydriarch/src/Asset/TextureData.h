@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Core/Core.h"
+
+//Encodings a baked texture can hold; the BC formats store 4x4 texel blocks
+enum class TextureFormat : uint32_t {
+	//Opaque RGB, 8 bytes per block
+	BC1,
+	//BC1 colour plus separately interpolated alpha, 16 bytes per block
+	BC3,
+	//Two independent channels, for tangent-space normal maps; 16 bytes per block
+	BC5,
+	//RGBA with finer endpoints and 16 palette entries, 16 bytes per block
+	BC7,
+	//Uncompressed, for devices that cannot sample BC formats
+	RGBA8
+};
+
+#define TEXTURE_BLOCK_DIMENSION 4
+
+//One mip level of RGBA8 texels, rows tightly packed
+struct TextureLevel {
+	uint32_t Width;
+	uint32_t Height;
+	std::vector<uint8_t> Pixels;
+};
+
+//CPU-side texture, independent of any graphics API; levels run from full resolution down to 1x1
+struct TextureData {
+	std::vector<TextureLevel> Levels;
+};
+
+const char* GetTextureFormatName(TextureFormat format);
+//Bytes per 4x4 block of a BC format
+uint32_t GetTextureBlockSize(TextureFormat format);
+//Bytes a level of the given size takes in the format, partial edge blocks included
+uint64_t GetTextureLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
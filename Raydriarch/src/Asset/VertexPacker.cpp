@@ -0,0 +1,192 @@
+#include "raydpch.h"
+#include "VertexPacker.h"
+
+uint32_t VertexFormat::GetPositionSize() const
+{
+	switch (Position) {
+	case PositionEncoding::Float32: return 3 * sizeof(float);
+	case PositionEncoding::Half:
+	case PositionEncoding::SNorm16: return 4 * sizeof(uint16_t);
+	}
+	return 0;
+}
+
+uint32_t VertexFormat::GetNormalSize() const
+{
+	return Normal == NormalEncoding::Octahedral ? 2 * sizeof(int16_t) : 0;
+}
+
+uint32_t VertexFormat::GetTexCoordSize() const
+{
+	switch (TexCoord) {
+	case TexCoordEncoding::None: return 0;
+	case TexCoordEncoding::Float32: return 2 * sizeof(float);
+	case TexCoordEncoding::Half:
+	case TexCoordEncoding::UNorm16: return 2 * sizeof(uint16_t);
+	}
+	return 0;
+}
+
+//Round to nearest even, including subnormals; infinities and NaNs keep their class
+static uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent == 0xff)
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+	int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+	if (halfExponent >= 31)
+		return static_cast<uint16_t>(sign | 0x7c00);
+
+	uint32_t shift = 13;
+	uint32_t half = (halfExponent << 10) | (mantissa >> 13);
+	if (halfExponent <= 0) {
+		if (halfExponent < -10)
+			return static_cast<uint16_t>(sign);
+		mantissa |= 0x800000;
+		shift = 14 - halfExponent;
+		half = mantissa >> shift;
+	}
+
+	//A carry out of the mantissa correctly bumps the exponent
+	uint32_t remainder = mantissa & ((1u << shift) - 1);
+	uint32_t midpoint = 1u << (shift - 1);
+	if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+		half++;
+	return static_cast<uint16_t>(sign | half);
+}
+
+static inline int16_t ToSNorm16(float value)
+{
+	return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static inline uint16_t ToUNorm16(float value)
+{
+	return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+//Projects the unit sphere onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the corners
+static glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+	float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (length == 0.0f)
+		return glm::vec2(0.0f);
+
+	glm::vec2 folded(normal.x / length, normal.y / length);
+	if (normal.z < 0.0f) {
+		glm::vec2 sign(folded.x >= 0.0f ? 1.0f : -1.0f, folded.y >= 0.0f ? 1.0f : -1.0f);
+		folded = glm::vec2((1.0f - std::abs(folded.y)) * sign.x, (1.0f - std::abs(folded.x)) * sign.y);
+	}
+	return folded;
+}
+
+void VertexPacker::Pack(const MeshData& mesh, const VertexFormat& format, PackedMesh& packed)
+{
+	packed.Format = format;
+	packed.Bounds = mesh.Bounds;
+	packed.Decode = { glm::vec3(0.0f), 1.0f };
+
+	//One uniform scale keeps the decode a similarity transform, so folding it into instance matrices leaves normals intact
+	if (format.Position != PositionEncoding::Float32 && !mesh.Vertices.empty()) {
+		glm::vec3 minPos(std::numeric_limits<float>::max());
+		glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+		for (auto& vertex : mesh.Vertices) {
+			minPos = glm::min(minPos, vertex.Position);
+			maxPos = glm::max(maxPos, vertex.Position);
+		}
+		glm::vec3 extent = (maxPos - minPos) * 0.5f;
+		float scale = std::max(extent.x, std::max(extent.y, extent.z));
+		packed.Decode = { (minPos + maxPos) * 0.5f, scale > 0.0f ? scale : 1.0f };
+	}
+
+	uint32_t stride = format.GetStride();
+	size_t vertexCount = mesh.Vertices.size();
+	std::vector<uint8_t> encoded(vertexCount * stride);
+	uint32_t clampedTexCoords = 0;
+	for (size_t v = 0; v < vertexCount; v++) {
+		const MeshVertex& vertex = mesh.Vertices[v];
+		uint8_t* out = &encoded[v * stride];
+
+		glm::vec3 position = (vertex.Position - packed.Decode.Offset) / packed.Decode.Scale;
+		if (format.Position == PositionEncoding::Float32) {
+			memcpy(out, &position, sizeof(position));
+		}
+		else if (format.Position == PositionEncoding::Half) {
+			uint16_t halves[4] = { FloatToHalf(position.x), FloatToHalf(position.y), FloatToHalf(position.z), 0 };
+			memcpy(out, halves, sizeof(halves));
+		}
+		else {
+			int16_t snorms[4] = { ToSNorm16(position.x), ToSNorm16(position.y), ToSNorm16(position.z), 0 };
+			memcpy(out, snorms, sizeof(snorms));
+		}
+		out += format.GetPositionSize();
+
+		if (format.Normal == NormalEncoding::Octahedral) {
+			glm::vec2 octahedral = EncodeOctahedral(vertex.Normal);
+			int16_t snorms[2] = { ToSNorm16(octahedral.x), ToSNorm16(octahedral.y) };
+			memcpy(out, snorms, sizeof(snorms));
+			out += sizeof(snorms);
+		}
+
+		if (format.TexCoord == TexCoordEncoding::Float32) {
+			memcpy(out, &vertex.TexCoord, sizeof(vertex.TexCoord));
+		}
+		else if (format.TexCoord == TexCoordEncoding::Half) {
+			uint16_t halves[2] = { FloatToHalf(vertex.TexCoord.x), FloatToHalf(vertex.TexCoord.y) };
+			memcpy(out, halves, sizeof(halves));
+		}
+		else if (format.TexCoord == TexCoordEncoding::UNorm16) {
+			clampedTexCoords += vertex.TexCoord.x < 0.0f || vertex.TexCoord.x > 1.0f || vertex.TexCoord.y < 0.0f || vertex.TexCoord.y > 1.0f;
+			uint16_t unorms[2] = { ToUNorm16(vertex.TexCoord.x), ToUNorm16(vertex.TexCoord.y) };
+			memcpy(out, unorms, sizeof(unorms));
+		}
+	}
+	if (clampedTexCoords > 0)
+		RAYD_WARN("{0} texture coordinates fell outside [0, 1] and were clamped; use TexCoordEncoding::Half for tiling UVs", clampedTexCoords);
+
+	//Open addressing over the encoded bytes; vertices arrive in first-use order, so merged ids stay in that order
+	constexpr uint32_t emptySlot = std::numeric_limits<uint32_t>::max();
+	uint32_t capacity = 16;
+	while (capacity < vertexCount * 2)
+		capacity <<= 1;
+	std::vector<uint32_t> table(capacity, emptySlot);
+	std::vector<uint32_t> remap(vertexCount);
+	packed.Vertices.clear();
+	packed.Vertices.reserve(encoded.size());
+	packed.VertexCount = 0;
+	for (size_t v = 0; v < vertexCount; v++) {
+		const uint8_t* bytes = &encoded[v * stride];
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t b = 0; b < stride; b++)
+			hash = (hash ^ bytes[b]) * 1099511628211ull;
+
+		uint32_t slot = static_cast<uint32_t>(hash ^ (hash >> 32)) & (capacity - 1);
+		while (table[slot] != emptySlot && memcmp(&packed.Vertices[static_cast<size_t>(table[slot]) * stride], bytes, stride) != 0)
+			slot = (slot + 1) & (capacity - 1);
+
+		if (table[slot] == emptySlot) {
+			table[slot] = packed.VertexCount++;
+			packed.Vertices.insert(packed.Vertices.end(), bytes, bytes + stride);
+		}
+		remap[v] = table[slot];
+	}
+
+	packed.Indices.resize(mesh.Indices.size());
+	for (size_t i = 0; i < mesh.Indices.size(); i++)
+		packed.Indices[i] = remap[mesh.Indices[i]];
+}
+
+void VertexPacker::LogSizeReport(const std::string& name, const MeshData& mesh, const PackedMesh& packed)
+{
+	size_t sourceBytes = mesh.Vertices.size() * sizeof(MeshVertex);
+	size_t packedBytes = packed.Vertices.size();
+	RAYD_INFO("Packed {0}: {1} vertices x {2} B = {3:.1f} KB -> {4} vertices x {5} B = {6:.1f} KB ({7:.0f}%)", name,
+		mesh.Vertices.size(), sizeof(MeshVertex), sourceBytes / 1024.0, packed.VertexCount, packed.Format.GetStride(), packedBytes / 1024.0,
+		sourceBytes ? 100.0 * packedBytes / sourceBytes : 0.0);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "MeshData.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+
+enum class PositionEncoding : uint8_t {
+	//12 bytes, stored as imported
+	Float32,
+	//8 bytes of half floats, normalized to the mesh bounds first so every mesh gets the same relative precision
+	Half,
+	//8 bytes, quantized to 1/32767 of the mesh bounds
+	SNorm16
+};
+
+enum class NormalEncoding : uint8_t {
+	None,
+	//4 bytes: the unit vector folded onto an octahedron and stored as two SNORM16 coordinates
+	Octahedral
+};
+
+enum class TexCoordEncoding : uint8_t {
+	None,
+	//8 bytes
+	Float32,
+	//4 bytes, for UVs that tile outside [0, 1]
+	Half,
+	//4 bytes, UVs are clamped to [0, 1]
+	UNorm16
+};
+
+//Attributes are laid out in this order, each one dropped entirely when its encoding is None
+struct VertexFormat {
+	PositionEncoding Position = PositionEncoding::SNorm16;
+	NormalEncoding Normal = NormalEncoding::None;
+	TexCoordEncoding TexCoord = TexCoordEncoding::UNorm16;
+
+	uint32_t GetPositionSize() const;
+	uint32_t GetNormalSize() const;
+	uint32_t GetTexCoordSize() const;
+	inline uint32_t GetStride() const { return GetPositionSize() + GetNormalSize() + GetTexCoordSize(); }
+	//Stable key for the mesh cache to tell formats apart
+	inline uint32_t GetKey() const { return static_cast<uint32_t>(Position) | static_cast<uint32_t>(Normal) << 8 | static_cast<uint32_t>(TexCoord) << 16; }
+
+	bool operator==(const VertexFormat& other) const { return GetKey() == other.GetKey(); }
+};
+
+//Maps a packed position back to model space: Offset + Scale * packed
+struct VertexDecode {
+	glm::vec3 Offset;
+	float Scale;
+};
+
+struct PackedMesh {
+	VertexFormat Format;
+	uint32_t VertexCount;
+	std::vector<uint8_t> Vertices;
+	std::vector<uint32_t> Indices;
+	//Model-space bounds, before the decode is applied
+	MeshBounds Bounds;
+	VertexDecode Decode;
+	//Model space, like Bounds; filled by MeshSimplifier and MeshletBuilder, Pack leaves them alone since merging vertices
+	//keeps the index order
+	std::vector<MeshLod> Lods;
+	std::vector<Meshlet> Meshlets;
+};
+
+class VertexPacker {
+public:
+	VertexPacker() = delete;
+
+	//Encodes every vertex into the format and merges vertices that became identical once dropped or quantized attributes
+	//no longer tell them apart, keeping first-use order
+	static void Pack(const MeshData& mesh, const VertexFormat& format, PackedMesh& packed);
+	//Logs the vertex bytes before and after packing
+	static void LogSizeReport(const std::string& name, const MeshData& mesh, const PackedMesh& packed);
+};
@@ -1,10 +1,65 @@
 #include "raydpch.h"
 #include "App.h"
+#include "Json.h"
 
-App::App(const std::string& name)
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+struct TimingSummary {
+	float Mean;
+	float P50;
+	float P95;
+	float P99;
+	float Max;
+};
+
+//Nearest-rank percentiles, so every reported value is a time that was actually measured
+static TimingSummary Summarize(std::vector<float> times)
+{
+	TimingSummary summary{};
+	if (times.empty())
+		return summary;
+
+	std::sort(times.begin(), times.end());
+	float total = 0.0f;
+	for (float time : times)
+		total += time;
+
+	auto percentile = [&times](float p) {
+		size_t rank = static_cast<size_t>(std::ceil(p * times.size()));
+		return times[std::min(std::max(rank, size_t(1)), times.size()) - 1];
+	};
+
+	summary.Mean = total / times.size();
+	summary.P50 = percentile(0.50f);
+	summary.P95 = percentile(0.95f);
+	summary.P99 = percentile(0.99f);
+	summary.Max = times.back();
+	return summary;
+}
+
+//Square grid of copies that fits in the default view
+static void LayoutGrid(Scene& scene, RefPtr<Model> model, uint32_t count)
+{
+	scene.Clear();
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+	float spacing = 2.0f / side;
+	for (uint32_t i = 0; i < count; i++) {
+		glm::vec3 position((i % side) * spacing - 1.0f, (i / side) * spacing - 1.0f, 0.0f);
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+		scene.CreateEntity(model, glm::scale(transform, glm::vec3(spacing * 0.5f)));
+	}
+}
+
+static const char* GetRenderPathName(RenderPath path)
 {
-	Log::Init();
-	m_Window = MakeScopedPtr<Window>(WindowProps{ "Raydriarch", 1280, 720 });
+	const char* pathNames[] = { "instanced", "per-entity", "indirect", "meshlet" };
+	return pathNames[static_cast<int>(path)];
+}
+
+App::App(const std::string& name, bool headless)
+{
+	m_Window = MakeScopedPtr<Window>(WindowProps{ "Raydriarch", 1280, 720, headless });
 	
 	Graphics::Init(m_Window);
 }
@@ -16,8 +71,9 @@ App::~App()
 
 void App::Run()
 {
+	//Animation follows the wall clock here; RunFrameBenchmark drives it with a fixed timestep instead
+	auto startTime = std::chrono::high_resolution_clock::now();
 	while (!m_Window->IsClosed()) {
-		static auto startTime = std::chrono::high_resolution_clock::now();
 		float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
 
 		m_Window->Update();
@@ -25,3 +81,266 @@ void App::Run()
 	}
 
 }
+
+void App::RunInstancingBenchmark()
+{
+	const uint32_t warmupFrames = 30;
+	const uint32_t measuredFrames = 200;
+	const uint32_t instanceCounts[] = { 1, 10, 100, 1000, 10000, 100000 };
+
+	Scene& scene = Graphics::GetScene();
+	RefPtr<Model> room = Graphics::LoadModel("res/models/viking_room/viking_room.obj");
+
+	RAYD_INFO("{0:>9} | {1:>10} | {2:>10} | {3:>12} | {4:>16}", "instances", "mode", "draw calls", "cpu ms/frame", "clusters culled");
+	for (uint32_t count : instanceCounts) {
+		LayoutGrid(scene, room, count);
+
+		for (RenderPath path : { RenderPath::Instanced, RenderPath::PerEntity, RenderPath::Indirect, RenderPath::Meshlet }) {
+			Graphics::SetRenderPath(path);
+			if (Graphics::GetRenderPath() != path)
+				continue;
+
+			float totalMs = 0.0f;
+			for (uint32_t frame = 0; frame < warmupFrames + measuredFrames && !m_Window->IsClosed(); frame++) {
+				m_Window->Update();
+				Graphics::Present(m_Window, 0.0f);
+				if (frame >= warmupFrames)
+					totalMs += Graphics::GetFrameStats().CpuTimeMs;
+			}
+
+			//Cluster counters come from the last frame the GPU finished, so they describe the steady state of this pass
+			const FrameStats& stats = Graphics::GetFrameStats();
+			float rejected = stats.ClustersTested ? 100.0f * (stats.ClustersTested - stats.ClustersVisible) / stats.ClustersTested : 0.0f;
+			RAYD_INFO("{0:>9} | {1:>10} | {2:>10} | {3:>12.3f} | {4:>15.1f}%", count, GetRenderPathName(path),
+				stats.DrawCalls, totalMs / measuredFrames, rejected);
+		}
+	}
+
+	Graphics::SetRenderPath(RenderPath::Instanced);
+}
+
+void App::RunPipelineBenchmark()
+{
+	const uint32_t rebuildCount = 20;
+
+	//Startup covers the launch that is running, so cold against warm takes one launch with the cache file deleted and one without
+	PipelineStats startup = Graphics::GetPipelineStats();
+	RAYD_INFO("Startup: {0:.1f} ms, {1} pipelines created in {2:.2f} ms from a {3} pipeline cache ({4:.1f} KB)", startup.StartupMs,
+		startup.Cache.PipelinesCreated, startup.Cache.CreateMs, startup.Cache.Warm ? "warm" : "cold", startup.Cache.LoadedBytes / 1024.0);
+
+	RAYD_INFO("{0:>6} | {1:>8} | {2:>12} | {3:>14}", "cache", "rebuilds", "ms/rebuild", "pipeline ms");
+	for (bool warm : { false, true }) {
+		float rebuildMs = 0.0f;
+		float pipelineMs = 0.0f;
+		uint32_t rebuilt = 0;
+		for (; rebuilt < rebuildCount && !m_Window->IsClosed(); rebuilt++) {
+			//Drivers may keep a cache of their own underneath, so cold here is a lower bound on a first launch
+			if (!warm)
+				Graphics::ResetPipelineCache();
+			float createdMs = Graphics::GetPipelineStats().Cache.CreateMs;
+
+			Graphics::RebuildPipelines();
+			m_Window->Update();
+			Graphics::Present(m_Window, 0.0f);
+
+			PipelineStats stats = Graphics::GetPipelineStats();
+			rebuildMs += stats.LastRebuildMs;
+			pipelineMs += stats.Cache.CreateMs - createdMs;
+		}
+
+		if (rebuilt > 0)
+			RAYD_INFO("{0:>6} | {1:>8} | {2:>12.3f} | {3:>14.3f}", warm ? "warm" : "cold", rebuilt, rebuildMs / rebuilt, pipelineMs / rebuilt);
+	}
+
+	PipelineRegistryStats registry = Graphics::GetPipelineStats().Registry;
+	RAYD_INFO("Pipeline registry: {0} hits, {1} misses, {2} shader loads", registry.Hits, registry.Misses, registry.ShaderLoads);
+}
+
+void App::RunResizeBenchmark()
+{
+	const uint32_t resizeCount = 100;
+	const uint32_t steadyFrames = 100;
+	const std::pair<uint32_t, uint32_t> sizes[] = { { 1280, 720 }, { 960, 540 }, { 1600, 900 }, { 640, 480 }, { 1024, 768 } };
+
+	auto timePresent = [this]() {
+		auto start = std::chrono::high_resolution_clock::now();
+		m_Window->Update();
+		Graphics::Present(m_Window, 0.0f);
+		return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	std::vector<float> steady;
+	for (uint32_t frame = 0; frame < steadyFrames && !m_Window->IsClosed(); frame++)
+		steady.push_back(timePresent());
+
+	//A hitch is every present from the size change until the swap chain has been rebuilt for it
+	std::vector<float> hitches;
+	std::vector<float> recreates;
+	uint32_t pipelineMisses = Graphics::GetPipelineStats().Registry.Misses;
+	uint32_t peakRetired = 0;
+	for (uint32_t i = 0; i < resizeCount && !m_Window->IsClosed(); i++) {
+		auto [width, height] = sizes[i % std::size(sizes)];
+		uint32_t recreateCount = Graphics::GetPipelineStats().RecreateCount;
+		m_Window->SetSize(width, height);
+
+		float hitchMs = 0.0f;
+		for (uint32_t frame = 0; frame < 8 && Graphics::GetPipelineStats().RecreateCount == recreateCount; frame++)
+			hitchMs += timePresent();
+		hitches.push_back(hitchMs);
+		recreates.push_back(Graphics::GetPipelineStats().LastRecreateMs);
+		peakRetired = std::max(peakRetired, Graphics::GetPipelineStats().RetiredSwapChains);
+	}
+
+	//Once the frames rendered into them complete, every retired swap chain should be gone
+	for (uint32_t frame = 0; frame < 8 && Graphics::GetPipelineStats().RetiredSwapChains > 0 && !m_Window->IsClosed(); frame++)
+		timePresent();
+	uint32_t leftRetired = Graphics::GetPipelineStats().RetiredSwapChains;
+
+	if (steady.empty() || hitches.empty())
+		return;
+
+	auto report = [](const char* name, const std::vector<float>& times) {
+		TimingSummary summary = Summarize(times);
+		RAYD_INFO("{0:<20} | {1:>7} | {2:>8.3f} | {3:>8.3f} | {4:>8.3f}", name, times.size(), summary.Mean, summary.P95, summary.Max);
+	};
+
+	//Run on lavapipe by pointing VK_ICD_FILENAMES at its lvp_icd json, which takes GPU timing noise out of the picture
+	RAYD_INFO("{0:<20} | {1:>7} | {2:>8} | {3:>8} | {4:>8}", "", "samples", "mean ms", "p95 ms", "max ms");
+	report("steady frame", steady);
+	report("resize hitch", hitches);
+	report("swap chain rebuild", recreates);
+	RAYD_INFO("Pipelines created during the resizes: {0}", Graphics::GetPipelineStats().Registry.Misses - pipelineMisses);
+	RAYD_INFO("Retired swap chains: {0} at most, {1} left after the resizes", peakRetired, leftRetired);
+	if (leftRetired > 0)
+		RAYD_WARN("{0} retired swap chains were never released", leftRetired);
+}
+
+void App::RunFrameBenchmark(const FrameBenchmarkConfig& config)
+{
+	Scene& scene = Graphics::GetScene();
+	RefPtr<Model> room = Graphics::LoadModel("res/models/viking_room/viking_room.obj");
+	if (config.Scene == "grid")
+		LayoutGrid(scene, room, config.Instances);
+	else {
+		scene.Clear();
+		scene.CreateEntity(room, glm::mat4(1.0f));
+	}
+	Graphics::SetRenderPath(config.Path);
+	//Reported as the path that actually ran, in case the device could not run the requested one
+	RenderPath path = Graphics::GetRenderPath();
+
+	const char* metricNames[] = { "frame_ms", "cpu_ms", "gpu_ms", "submit_ms", "present_wait_ms" };
+	std::array<std::vector<float>, 5> samples;
+	for (auto& metric : samples)
+		metric.reserve(config.Frames);
+	//Per-scope GPU times, scopes sharing a name summed within a frame, in the order they were first seen
+	std::vector<std::string> scopeNames;
+	std::unordered_map<std::string, std::vector<float>> scopeSamples;
+	//Keyed by the profiler's frame index, since the last collected frame stays the same when a slot resolves late
+	std::map<uint64_t, std::string> scopeFrames;
+
+	auto present = [this, &config](uint32_t frame) {
+		//One orbit every ten simulated seconds, starting from the default eye
+		float time = frame * config.Timestep;
+		float angle = glm::radians(45.0f) + time * glm::two_pi<float>() / 10.0f;
+		float radius = 2.0f * std::sqrt(2.0f);
+		Graphics::SetCamera(glm::vec3(radius * std::cos(angle), radius * std::sin(angle), 2.0f), glm::vec3(0.0f));
+
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		m_Window->Update();
+		Graphics::Present(m_Window, time);
+		return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - frameStart).count();
+	};
+
+	for (uint32_t frame = 0; frame < config.WarmupFrames && !m_Window->IsClosed(); frame++)
+		present(frame);
+
+	//Async model loads, streamed levels and their uploads would otherwise land at different points of the measured frames
+	//from run to run, so the view of the first measured frame is held until all of them have settled
+	const uint32_t maxSettleFrames = 10000;
+	uint32_t settleFrames = 0;
+	for (; settleFrames < maxSettleFrames && !Graphics::IsSceneResident() && !m_Window->IsClosed(); settleFrames++)
+		present(config.WarmupFrames);
+	if (!Graphics::IsSceneResident())
+		RAYD_WARN("Scene still not resident after {0} extra warm-up frames, streaming will overlap the measured frames", settleFrames);
+
+	for (uint32_t frame = config.WarmupFrames; frame < config.WarmupFrames + config.Frames && !m_Window->IsClosed(); frame++) {
+		float frameMs = present(frame);
+
+		const FrameStats& stats = Graphics::GetFrameStats();
+		samples[0].push_back(frameMs);
+		samples[1].push_back(stats.CpuTimeMs);
+		samples[2].push_back(stats.GpuTimeMs);
+		samples[3].push_back(stats.SubmitMs);
+		samples[4].push_back(stats.PresentWaitMs);
+
+		const GpuFrameTimings& gpuFrame = GpuProfiler::GetLastFrame();
+		if (scopeFrames.find(gpuFrame.Frame) != scopeFrames.end())
+			continue;
+
+		std::vector<std::pair<std::string, float>> frameScopes;
+		for (auto& scope : gpuFrame.Scopes) {
+			auto it = std::find_if(frameScopes.begin(), frameScopes.end(), [&scope](auto& entry) { return entry.first == scope.Name; });
+			if (it != frameScopes.end())
+				it->second += scope.Ms;
+			else
+				frameScopes.emplace_back(scope.Name, scope.Ms);
+		}
+
+		std::string scopes;
+		for (auto& [name, ms] : frameScopes) {
+			if (scopeSamples.find(name) == scopeSamples.end())
+				scopeNames.push_back(name);
+			scopeSamples[name].push_back(ms);
+			scopes += fmt::format("{0}\"{1}\": {2:.4f}", scopes.empty() ? "" : ", ", EscapeJson(name), ms);
+		}
+		scopeFrames[gpuFrame.Frame] = scopes;
+	}
+
+	Graphics::SetCamera(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f));
+	Graphics::SetRenderPath(RenderPath::Instanced);
+
+	std::string json = "{\n";
+	json += fmt::format("\t\"device\": \"{0}\",\n", EscapeJson(Graphics::GetDeviceProperties().deviceName));
+	json += fmt::format("\t\"headless\": {0},\n", m_Window->IsHeadless() ? "true" : "false");
+	json += fmt::format("\t\"scene\": \"{0}\",\n", EscapeJson(config.Scene));
+	json += fmt::format("\t\"instances\": {0},\n", config.Scene == "grid" ? config.Instances : 1);
+	json += fmt::format("\t\"path\": \"{0}\",\n", GetRenderPathName(path));
+	json += fmt::format("\t\"warmup_frames\": {0},\n", config.WarmupFrames);
+	json += fmt::format("\t\"settle_frames\": {0},\n", settleFrames);
+	json += fmt::format("\t\"frames\": {0},\n", samples[0].size());
+	json += fmt::format("\t\"timestep\": {0},\n", config.Timestep);
+	json += "\t\"metrics\": {\n";
+
+	RAYD_INFO("{0:<16} | {1:>8} | {2:>8} | {3:>8} | {4:>8} | {5:>8}", "", "mean", "p50", "p95", "p99", "max");
+	for (size_t i = 0; i < samples.size(); i++) {
+		TimingSummary summary = Summarize(samples[i]);
+		RAYD_INFO("{0:<16} | {1:>8.3f} | {2:>8.3f} | {3:>8.3f} | {4:>8.3f} | {5:>8.3f}", metricNames[i], summary.Mean, summary.P50, summary.P95,
+			summary.P99, summary.Max);
+		json += fmt::format("\t\t\"{0}\": {{ \"mean\": {1:.4f}, \"p50\": {2:.4f}, \"p95\": {3:.4f}, \"p99\": {4:.4f}, \"max\": {5:.4f} }}{6}\n",
+			metricNames[i], summary.Mean, summary.P50, summary.P95, summary.P99, summary.Max, i + 1 < samples.size() ? "," : "");
+	}
+	json += "\t},\n";
+
+	json += "\t\"gpu_scopes\": {\n";
+	for (size_t i = 0; i < scopeNames.size(); i++) {
+		TimingSummary summary = Summarize(scopeSamples[scopeNames[i]]);
+		RAYD_INFO("{0:<16} | {1:>8.3f} | {2:>8.3f} | {3:>8.3f} | {4:>8.3f} | {5:>8.3f}", "gpu " + scopeNames[i], summary.Mean, summary.P50, summary.P95,
+			summary.P99, summary.Max);
+		json += fmt::format("\t\t\"{0}\": {{ \"mean\": {1:.4f}, \"p50\": {2:.4f}, \"p95\": {3:.4f}, \"p99\": {4:.4f}, \"max\": {5:.4f} }}{6}\n",
+			EscapeJson(scopeNames[i]), summary.Mean, summary.P50, summary.P95, summary.P99, summary.Max, i + 1 < scopeNames.size() ? "," : "");
+	}
+	json += "\t},\n";
+	//Frame indices are the profiler's, which trail the benchmark's by the frames in flight
+	json += "\t\"gpu_frames\": [\n";
+	for (auto it = scopeFrames.begin(); it != scopeFrames.end(); it++)
+		json += fmt::format("\t\t{{ \"frame\": {0}, \"scopes\": {{ {1} }} }}{2}\n", it->first, it->second, std::next(it) != scopeFrames.end() ? "," : "");
+	json += "\t]\n}\n";
+
+	std::ofstream output(config.OutputPath, std::ios::out | std::ios::trunc);
+	output << json;
+	if (!output)
+		RAYD_ERROR("Failed to write benchmark results to {0}", config.OutputPath);
+	else
+		RAYD_INFO("Benchmark results written to {0}", config.OutputPath);
+}
@@ -3,14 +3,38 @@
 #include "Core.h"
 #include "Window.h"
 
+struct FrameBenchmarkConfig {
+	//"room" draws the model once, "grid" draws Instances copies of it
+	std::string Scene = "room";
+	uint32_t Instances = 1000;
+	RenderPath Path = RenderPath::Instanced;
+	uint32_t WarmupFrames = 60;
+	uint32_t Frames = 600;
+	//Simulated seconds per frame; animation and camera advance by this much no matter how long a frame takes
+	float Timestep = 1.0f / 60.0f;
+	std::string OutputPath = "benchmark.json";
+};
+
 class App {
 public:
-	App(const std::string& name = "Raid App");
+	//A headless app renders offscreen without a window or display, for benchmarks on machines without either
+	App(const std::string& name = "Raid App", bool headless = false);
 	~App();
 	App(App&) = delete;
 	App& operator=(const App&) = delete;
 
 	void Run();
+	//Sweeps instance counts and logs draw calls, CPU frame time and, for the meshlet path, the share of clusters culled
+	void RunInstancingBenchmark();
+	//Logs startup time against the state of the pipeline cache, then pipeline rebuild times with the cache emptied before
+	//each one and with it kept
+	void RunPipelineBenchmark();
+	//Resizes the window over and over, logging the frame time hitch each resize costs against steady frames
+	void RunResizeBenchmark();
+	//Renders the same frames every run, on a fixed timestep along a scripted camera orbit, and writes frame, CPU, GPU,
+	//submit and present wait times as mean and percentiles to config.OutputPath as JSON, along with every GPU profiler
+	//scope summarized and frame by frame
+	void RunFrameBenchmark(const FrameBenchmarkConfig& config);
 
 private:
 	ScopedPtr<Window> m_Window;
@@ -34,7 +34,6 @@
 		#error "Android is not supported!"
 	#elif defined(__linux__)
 		#define RAYD_PLATFORM_LINUX
-		#error "Linux is not supported!"
 	#else
 		/* Unknown compiler/platform */
 	#error "Unknown platform!"
@@ -56,7 +55,7 @@
 #endif
 
 #ifdef RAYD_ENABLE_ASSERTS
-	#define RAYD_ASSERT(x, ...) { if(!(x)) { RAYD_ERROR("Assertion Failed: {0}", __VA_ARGS__); __debugbreak(); } }
+	#define RAYD_ASSERT(x, ...) { if(!(x)) { RAYD_ERROR("Assertion Failed: {0}", __VA_ARGS__); RAYD_DEBUGBREAK(); } }
 #else
 	#define RAYD_ASSERT(x, ...)
 #endif
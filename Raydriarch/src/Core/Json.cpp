@@ -0,0 +1,25 @@
+#include "raydpch.h"
+#include "Json.h"
+
+std::string EscapeJson(const std::string& text)
+{
+	std::string escaped;
+	escaped.reserve(text.size());
+	for (char c : text) {
+		switch (c) {
+		case '"':  escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\b': escaped += "\\b"; break;
+		case '\f': escaped += "\\f"; break;
+		case '\n': escaped += "\\n"; break;
+		case '\r': escaped += "\\r"; break;
+		case '\t': escaped += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+				escaped += fmt::format("\\u{0:04x}", static_cast<int>(c));
+			else
+				escaped += c;
+		}
+	}
+	return escaped;
+}
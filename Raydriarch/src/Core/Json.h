@@ -0,0 +1,7 @@
+#pragma once
+
+#include "Core.h"
+
+//Escapes text for a JSON string literal: quotes, backslashes and every control character, so names from the driver,
+//the command line or a thread can never break the document they are written into
+std::string EscapeJson(const std::string& text);
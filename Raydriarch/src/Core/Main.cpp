@@ -1,12 +1,137 @@
 #include "raydpch.h"
 
 #include "App.h"
+#include "Metrics.h"
 
-int main()
+//Frames between the lines of the --metrics log
+#define METRICS_INTERVAL_FRAMES 60
+
+//Whole numbers of at least min; anything else, including trailing characters, is rejected
+static bool ParseCount(const std::string& option, const std::string& value, uint32_t min, uint32_t& count)
+{
+	auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+	if (error != std::errc() || end != value.data() + value.size() || count < min) {
+		RAYD_ERROR("{0} expects a whole number of at least {1}, got \"{2}\"", option, min, value);
+		return false;
+	}
+	return true;
+}
+
+//--bench-frames [--scene room|grid] [--instances N] [--path instanced|per-entity|indirect|meshlet] [--warmup N] [--frames N]
+//[--timestep seconds] [--out path]. Logs and returns false on the first option it cannot use, so a typo never quietly
+//benchmarks something other than what was asked for.
+static bool ParseFrameBenchmarkConfig(const std::vector<std::string>& args, FrameBenchmarkConfig& config)
+{
+	for (size_t i = 1; i < args.size(); i += 2) {
+		const std::string& option = args[i];
+		if (i + 1 == args.size()) {
+			RAYD_ERROR("Benchmark option {0} is missing its value", option);
+			return false;
+		}
+
+		const std::string& value = args[i + 1];
+		bool valid = true;
+		if (option == "--scene") {
+			config.Scene = value;
+			valid = value == "room" || value == "grid";
+			if (!valid)
+				RAYD_ERROR("Unknown benchmark scene \"{0}\", expected room or grid", value);
+		}
+		else if (option == "--instances")
+			valid = ParseCount(option, value, 1, config.Instances);
+		else if (option == "--warmup")
+			valid = ParseCount(option, value, 0, config.WarmupFrames);
+		else if (option == "--frames")
+			valid = ParseCount(option, value, 1, config.Frames);
+		else if (option == "--timestep") {
+			char* end = nullptr;
+			config.Timestep = std::strtof(value.c_str(), &end);
+			valid = !value.empty() && *end == '\0' && std::isfinite(config.Timestep) && config.Timestep > 0.0f;
+			if (!valid)
+				RAYD_ERROR("--timestep expects a positive number of seconds, got \"{0}\"", value);
+		}
+		else if (option == "--out")
+			config.OutputPath = value;
+		else if (option == "--path") {
+			const char* paths[] = { "instanced", "per-entity", "indirect", "meshlet" };
+			auto it = std::find(std::begin(paths), std::end(paths), value);
+			valid = it != std::end(paths);
+			if (valid)
+				config.Path = static_cast<RenderPath>(it - std::begin(paths));
+			else
+				RAYD_ERROR("Unknown render path \"{0}\", expected instanced, per-entity, indirect or meshlet", value);
+		}
+		else {
+			RAYD_ERROR("Unknown benchmark option {0}", option);
+			valid = false;
+		}
+
+		if (!valid)
+			return false;
+	}
+	return true;
+}
+
+//Removes an option and its value from the arguments, returning the value or an empty string when it is absent
+static std::string TakeOption(std::vector<std::string>& args, const std::string& option)
+{
+	auto it = std::find(args.begin(), args.end(), option);
+	if (it == args.end() || std::next(it) == args.end())
+		return "";
+
+	std::string value = *std::next(it);
+	args.erase(it, std::next(it, 2));
+	return value;
+}
+
+int main(int argc, char** argv)
 {
+	//Before anything that can log, including the trace and metrics sessions opened ahead of the app
+	Log::Init();
+
+	//--headless, --trace <path> and --metrics <path> may accompany any of the benchmarks
+	std::vector<std::string> args(argv + 1, argv + argc);
+	bool headless = std::find(args.begin(), args.end(), "--headless") != args.end();
+	args.erase(std::remove(args.begin(), args.end(), "--headless"), args.end());
+	std::string tracePath = TakeOption(args, "--trace");
+	std::string metricsPath = TakeOption(args, "--metrics");
+	std::string mode = args.empty() ? "" : args[0];
+
+	//Settled before the app starts, so a typo never costs a renderer init or quietly opens the interactive window
+	const char* modes[] = { "", "--bench-instancing", "--bench-pipelines", "--bench-resize", "--bench-frames" };
+	if (std::find(std::begin(modes), std::end(modes), mode) == std::end(modes)) {
+		RAYD_ERROR("Unknown mode {0}, expected --bench-instancing, --bench-pipelines, --bench-resize or --bench-frames", mode);
+		return 1;
+	}
+	FrameBenchmarkConfig benchmarkConfig;
+	if (mode == "--bench-frames" && !ParseFrameBenchmarkConfig(args, benchmarkConfig))
+		return 1;
+
+	//Opened before the app so startup is in the trace, and written once everything has shut down
+	RAYD_PROFILE_THREAD("Main");
+	if (!tracePath.empty())
+		RAYD_PROFILE_BEGIN_SESSION(tracePath);
+	//The last line is written after shutdown, so whatever is still live there has leaked
+	if (!metricsPath.empty())
+		Metrics::Open(metricsPath, METRICS_INTERVAL_FRAMES);
 	{
-		App app("bruh");
-		app.Run();
+		App app("bruh", headless);
+#ifndef RAYD_PROFILE
+		if (!tracePath.empty())
+			RAYD_WARN("Built without RAYD_PROFILE, --trace is ignored");
+#endif
+		if (mode == "--bench-instancing")
+			app.RunInstancingBenchmark();
+		else if (mode == "--bench-pipelines")
+			app.RunPipelineBenchmark();
+		else if (mode == "--bench-resize")
+			app.RunResizeBenchmark();
+		else if (mode == "--bench-frames")
+			app.RunFrameBenchmark(benchmarkConfig);
+		else
+			app.Run();
 	}
+	Metrics::Close();
+	RAYD_PROFILE_END_SESSION();
 	return 0;
 }
\ No newline at end of file
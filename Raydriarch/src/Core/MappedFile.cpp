@@ -0,0 +1,86 @@
+#include "raydpch.h"
+#include "MappedFile.h"
+
+#ifdef RAYD_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#ifdef RAYD_PLATFORM_WINDOWS
+
+MappedFile::MappedFile(const std::string& path)
+	:m_Data(nullptr), m_Size(0), m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr)
+{
+	m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_File == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+		return;
+
+	m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_Mapping)
+		return;
+
+	m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	m_Size = m_Data ? static_cast<size_t>(size.QuadPart) : 0;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File != INVALID_HANDLE_VALUE)
+		CloseHandle(m_File);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+	:m_Data(nullptr), m_Size(0), m_File(-1)
+{
+	m_File = open(path.c_str(), O_RDONLY);
+	if (m_File < 0)
+		return;
+
+	struct stat info;
+	if (fstat(m_File, &info) != 0 || info.st_size == 0)
+		return;
+
+	void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, m_File, 0);
+	if (data == MAP_FAILED)
+		return;
+
+	m_Data = static_cast<const char*>(data);
+	m_Size = static_cast<size_t>(info.st_size);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data)
+		munmap(const_cast<char*>(m_Data), m_Size);
+	if (m_File >= 0)
+		close(m_File);
+}
+
+#endif
+
+bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& time)
+{
+	std::error_code error;
+	size = std::filesystem::file_size(path, error);
+	if (error)
+		return false;
+
+	time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	return !error;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Core.h"
+
+//Read-only memory mapping of a whole file; pages are faulted in on first touch instead of read up front
+class MappedFile {
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline bool IsOpen() const { return m_Data != nullptr; }
+	inline const char* GetData() const { return m_Data; }
+	inline size_t GetSize() const { return m_Size; }
+private:
+	const char* m_Data;
+	size_t m_Size;
+#ifdef RAYD_PLATFORM_WINDOWS
+	void* m_File;
+	void* m_Mapping;
+#else
+	int m_File;
+#endif
+};
+
+//Size and modification time of a file, which asset caches record to tell when their source has changed
+bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& time);
@@ -0,0 +1,139 @@
+#include "raydpch.h"
+#include "Metrics.h"
+
+#define METRICS_MAX 256
+
+struct MetricsData {
+	//Fixed storage, so registering never moves a value another thread is updating
+	std::atomic<int64_t> Values[METRICS_MAX];
+	std::mutex Mutex;
+	std::vector<std::string> Names;
+	std::vector<MetricKind> Kinds;
+
+	std::ofstream File;
+	uint32_t Interval = 0;
+	uint64_t Frame = 0;
+	uint32_t LineFrames = 0;
+	std::chrono::steady_clock::time_point Start;
+	//Counter values when the current frame and the current line began, and the largest frame delta within the line
+	std::vector<int64_t> FrameStart;
+	std::vector<int64_t> LineStart;
+	std::vector<int64_t> MaxPerFrame;
+};
+
+//Created on first use and never freed, since wrappers register their metrics from static initializers in other files
+static MetricsData& GetData()
+{
+	static MetricsData* data = new MetricsData();
+	return *data;
+}
+
+static void WriteLine(MetricsData& data)
+{
+	float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::steady_clock::now() - data.Start).count();
+	std::string counters, gauges;
+	for (size_t i = 0; i < data.Names.size(); i++) {
+		int64_t value = data.Values[i].load(std::memory_order_relaxed);
+		if (data.Kinds[i] == MetricKind::Gauge) {
+			gauges += fmt::format("{0}\"{1}\":{2}", gauges.empty() ? "" : ",", data.Names[i], value);
+			continue;
+		}
+
+		double perFrame = data.LineFrames > 0 ? static_cast<double>(value - data.LineStart[i]) / data.LineFrames : 0.0;
+		counters += fmt::format("{0}\"{1}\":{{\"total\":{2},\"per_frame\":{3:.2f},\"max_per_frame\":{4}}}", counters.empty() ? "" : ",", data.Names[i],
+			value, perFrame, data.MaxPerFrame[i]);
+		data.LineStart[i] = value;
+		data.MaxPerFrame[i] = 0;
+	}
+
+	data.File << fmt::format("{{\"frame\":{0},\"elapsed_ms\":{1:.1f},\"frames\":{2},\"counters\":{{{3}}},\"gauges\":{{{4}}}}}\n", data.Frame, elapsedMs,
+		data.LineFrames, counters, gauges);
+	//Flushed every line so the log can be followed while the app runs and survives it crashing
+	data.File.flush();
+	data.LineFrames = 0;
+}
+
+MetricID Metrics::Register(const std::string& name, MetricKind kind)
+{
+	MetricsData& data = GetData();
+	std::lock_guard<std::mutex> lock(data.Mutex);
+	auto it = std::find(data.Names.begin(), data.Names.end(), name);
+	if (it != data.Names.end())
+		return static_cast<MetricID>(it - data.Names.begin());
+
+	RAYD_ASSERT(data.Names.size() < METRICS_MAX, "Too many metrics registered!");
+	MetricID metric = static_cast<MetricID>(data.Names.size());
+	data.Values[metric].store(0, std::memory_order_relaxed);
+	data.Names.push_back(name);
+	data.Kinds.push_back(kind);
+	data.FrameStart.push_back(0);
+	data.LineStart.push_back(0);
+	data.MaxPerFrame.push_back(0);
+	return metric;
+}
+
+void Metrics::Add(MetricID metric, int64_t delta)
+{
+	GetData().Values[metric].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void Metrics::Set(MetricID metric, int64_t value)
+{
+	GetData().Values[metric].store(value, std::memory_order_relaxed);
+}
+
+int64_t Metrics::Get(MetricID metric)
+{
+	return GetData().Values[metric].load(std::memory_order_relaxed);
+}
+
+void Metrics::Open(const std::string& path, uint32_t intervalFrames)
+{
+	MetricsData& data = GetData();
+	std::lock_guard<std::mutex> lock(data.Mutex);
+	data.File.open(path, std::ios::trunc);
+	if (!data.File.is_open()) {
+		RAYD_ERROR("Failed to open {0} for writing metrics!", path);
+		return;
+	}
+
+	data.Interval = std::max(intervalFrames, 1u);
+	data.LineFrames = 0;
+	data.Start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < data.Names.size(); i++) {
+		data.FrameStart[i] = data.LineStart[i] = data.Values[i].load(std::memory_order_relaxed);
+		data.MaxPerFrame[i] = 0;
+	}
+}
+
+void Metrics::Close()
+{
+	MetricsData& data = GetData();
+	std::lock_guard<std::mutex> lock(data.Mutex);
+	if (!data.File.is_open())
+		return;
+
+	WriteLine(data);
+	data.File.close();
+}
+
+void Metrics::EndFrame()
+{
+	MetricsData& data = GetData();
+	std::lock_guard<std::mutex> lock(data.Mutex);
+	data.Frame++;
+	if (!data.File.is_open())
+		return;
+
+	for (size_t i = 0; i < data.Names.size(); i++) {
+		if (data.Kinds[i] != MetricKind::Counter)
+			continue;
+
+		int64_t value = data.Values[i].load(std::memory_order_relaxed);
+		data.MaxPerFrame[i] = std::max(data.MaxPerFrame[i], value - data.FrameStart[i]);
+		data.FrameStart[i] = value;
+	}
+
+	if (++data.LineFrames >= data.Interval)
+		WriteLine(data);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+//Counters only ever go up and are reported as totals and per-frame rates; gauges hold a current level, such as live bytes
+enum class MetricKind : uint8_t {
+	Counter = 0,
+	Gauge = 1
+};
+
+using MetricID = uint32_t;
+
+//Named counters and gauges that subsystems report into from any thread. Updates are single atomic operations, so they
+//are cheap enough for per-command paths. While a log is open, a JSON line with every metric is appended every few
+//frames, so resource growth and per-frame work can be followed over long runs.
+class Metrics {
+public:
+	Metrics() = delete;
+
+	//Registering a name twice returns the same metric. Safe to call during static initialization.
+	static MetricID Register(const std::string& name, MetricKind kind);
+	static void Add(MetricID metric, int64_t delta = 1);
+	static void Set(MetricID metric, int64_t value);
+	static int64_t Get(MetricID metric);
+
+	static void Open(const std::string& path, uint32_t intervalFrames);
+	//Writes out the frames since the last line
+	static void Close();
+	//Call once per frame; per-frame maximums are taken between calls
+	static void EndFrame();
+};
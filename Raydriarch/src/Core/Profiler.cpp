@@ -0,0 +1,161 @@
+#include "raydpch.h"
+#include "Profiler.h"
+#include "Json.h"
+
+#ifdef RAYD_PROFILE
+
+#define PROFILER_CHUNK_EVENTS 4096
+
+struct ProfileEvent {
+	const char* Name;
+	uint64_t Start;
+	uint64_t End;
+};
+
+//Only the owning thread writes events and links the next chunk; the count is published with release so the session can
+//read everything below it while the thread keeps recording
+struct ProfileChunk {
+	ProfileEvent Events[PROFILER_CHUNK_EVENTS];
+	std::atomic<uint32_t> Count{ 0 };
+	std::atomic<ProfileChunk*> Next{ nullptr };
+};
+
+struct ThreadBuffer {
+	uint32_t Id;
+	std::string Name;
+	//Owned by the recording thread
+	ProfileChunk* Tail;
+	//Owned by whoever holds the registry mutex; chunks before Head have been written out and freed
+	ProfileChunk* Head;
+	uint32_t HeadRead;
+};
+
+//Never freed, since threads may still record while statics are being destroyed
+static struct ProfilerData {
+	std::atomic<bool> Recording{ false };
+	std::string Path;
+	uint64_t SessionStart = 0;
+
+	std::mutex Mutex;
+	std::vector<ScopedPtr<ThreadBuffer>> Threads;
+}*s_Data = new ProfilerData;
+
+static thread_local ThreadBuffer* t_Buffer = nullptr;
+
+static ThreadBuffer* GetThreadBuffer()
+{
+	if (!t_Buffer) {
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+		ScopedPtr<ThreadBuffer> buffer = MakeScopedPtr<ThreadBuffer>();
+		buffer->Id = static_cast<uint32_t>(s_Data->Threads.size());
+		buffer->Name = "Thread " + std::to_string(buffer->Id);
+		buffer->Tail = new ProfileChunk;
+		buffer->Head = buffer->Tail;
+		buffer->HeadRead = 0;
+		t_Buffer = buffer.get();
+		s_Data->Threads.push_back(std::move(buffer));
+	}
+	return t_Buffer;
+}
+
+static double ToMicroseconds(uint64_t ticks)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::duration(ticks)).count();
+}
+
+void Profiler::BeginSession(const std::string& path)
+{
+	RAYD_ASSERT(!IsRecording(), "A profiling session is already open!");
+	s_Data->Path = path;
+	s_Data->SessionStart = GetTimestamp();
+	s_Data->Recording.store(true, std::memory_order_release);
+}
+
+void Profiler::EndSession()
+{
+	if (!s_Data->Recording.exchange(false, std::memory_order_acq_rel))
+		return;
+
+	std::ofstream file(s_Data->Path);
+	if (!file.is_open()) {
+		RAYD_ERROR("Failed to open {0} for writing the trace!", s_Data->Path);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_Data->Mutex);
+	file << "{\"traceEvents\":[";
+	size_t eventCount = 0;
+	const char* separator = "\n";
+	for (auto& thread : s_Data->Threads) {
+		file << separator << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{0},\"args\":{{\"name\":\"{1}\"}}}}",
+			thread->Id, EscapeJson(thread->Name));
+		separator = ",\n";
+
+		//Zones still open when a session begins are recorded but started before it, so they are left out
+		ProfileChunk* chunk = thread->Head;
+		uint32_t read = thread->HeadRead;
+		while (true) {
+			uint32_t count = chunk->Count.load(std::memory_order_acquire);
+			for (; read < count; read++) {
+				const ProfileEvent& event = chunk->Events[read];
+				if (event.Start < s_Data->SessionStart)
+					continue;
+				file << separator << fmt::format("{{\"name\":\"{0}\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":{1:.3f},\"dur\":{2:.3f},\"pid\":0,\"tid\":{3}}}",
+					EscapeJson(event.Name), ToMicroseconds(event.Start - s_Data->SessionStart), ToMicroseconds(event.End - event.Start), thread->Id);
+				eventCount++;
+			}
+
+			//A full chunk with a successor is never written to again
+			ProfileChunk* next = chunk->Next.load(std::memory_order_acquire);
+			if (count < PROFILER_CHUNK_EVENTS || !next)
+				break;
+			delete chunk;
+			chunk = next;
+			read = 0;
+		}
+		thread->Head = chunk;
+		thread->HeadRead = read;
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	RAYD_INFO("Wrote {0} zones from {1} threads to {2}", eventCount, s_Data->Threads.size(), s_Data->Path);
+}
+
+bool Profiler::IsRecording()
+{
+	return s_Data->Recording.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(s_Data->Mutex);
+	buffer->Name = name;
+}
+
+uint64_t Profiler::GetTimestamp()
+{
+	return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+	if (!IsRecording())
+		return;
+
+	ThreadBuffer* buffer = GetThreadBuffer();
+	ProfileChunk* chunk = buffer->Tail;
+	uint32_t count = chunk->Count.load(std::memory_order_relaxed);
+	if (count == PROFILER_CHUNK_EVENTS) {
+		ProfileChunk* next = new ProfileChunk;
+		chunk->Next.store(next, std::memory_order_release);
+		buffer->Tail = next;
+		chunk = next;
+		count = 0;
+	}
+
+	chunk->Events[count] = { name, start, end };
+	chunk->Count.store(count + 1, std::memory_order_release);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+//CPU zones are only compiled in when RAYD_PROFILE is defined; without it every macro below expands to nothing
+#ifdef RAYD_PROFILE
+
+//Records named zones of CPU time on every thread into buffers owned by that thread, so recording takes no locks. Zones
+//are kept only while a session is open; ending it writes them out as Chrome trace events, which chrome://tracing and
+//Perfetto both load.
+class Profiler {
+public:
+	Profiler() = delete;
+
+	static void BeginSession(const std::string& path);
+	static void EndSession();
+	static bool IsRecording();
+
+	//Names the calling thread in the trace; threads that never call it show up by number
+	static void SetThreadName(const std::string& name);
+
+	static uint64_t GetTimestamp();
+	//Names are kept by pointer, so they have to be string literals
+	static void Record(const char* name, uint64_t start, uint64_t end);
+};
+
+//Records a zone covering its lifetime
+class ProfileZone {
+public:
+	ProfileZone(const char* name)
+		:m_Name(name), m_Start(Profiler::IsRecording() ? Profiler::GetTimestamp() : 0)
+	{
+	}
+
+	~ProfileZone() {
+		if (m_Start != 0)
+			Profiler::Record(m_Name, m_Start, Profiler::GetTimestamp());
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+private:
+	const char* m_Name;
+	uint64_t m_Start;
+};
+
+#define RAYD_PROFILE_CONCAT_INNER(a, b) a##b
+#define RAYD_PROFILE_CONCAT(a, b) RAYD_PROFILE_CONCAT_INNER(a, b)
+
+#define RAYD_PROFILE_BEGIN_SESSION(path) ::Profiler::BeginSession(path)
+#define RAYD_PROFILE_END_SESSION()		 ::Profiler::EndSession()
+#define RAYD_PROFILE_THREAD(name)		 ::Profiler::SetThreadName(name)
+#define RAYD_PROFILE_SCOPE(name)		 ::ProfileZone RAYD_PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+#else
+
+#define RAYD_PROFILE_BEGIN_SESSION(path)
+#define RAYD_PROFILE_END_SESSION()
+#define RAYD_PROFILE_THREAD(name)
+#define RAYD_PROFILE_SCOPE(name)
+
+#endif
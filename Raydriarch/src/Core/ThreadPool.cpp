@@ -0,0 +1,299 @@
+#include "raydpch.h"
+#include "ThreadPool.h"
+
+//Pool the current thread works for and its index there, so jobs it schedules go to its own deque
+static thread_local ThreadPool* t_Pool = nullptr;
+static thread_local uint32_t t_Index = 0;
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+	:m_Queued(0), m_Active(0), m_Stopping(false), m_Start(std::chrono::high_resolution_clock::now())
+{
+	for (uint32_t i = 0; i < threadCount; i++)
+		m_Queues.push_back(MakeScopedPtr<WorkQueue>());
+
+	m_Workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_TaskAvailable.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	Push(std::move(task), false);
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Idle.wait(lock, [this] { return m_Queued == 0 && m_Active == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task)
+{
+	if (count == 1) {
+		task(0);
+		return;
+	}
+
+	std::atomic<uint32_t> remaining(count);
+	for (uint32_t i = 0; i < count; i++)
+		Push([&task, &remaining, i] { task(i); remaining.fetch_sub(1, std::memory_order_release); }, true);
+
+	//Only foreground tasks are taken here, so a frame never ends up running a long background job itself
+	uint32_t index = t_Pool == this ? t_Index : GetThreadCount();
+	while (remaining.load(std::memory_order_acquire) > 0) {
+		std::function<void()> next;
+		if (TakeTask(next, index, true))
+			Execute(next);
+		else
+			std::this_thread::yield();
+	}
+}
+
+RefPtr<Job> ThreadPool::Schedule(const std::string& name, std::function<void()> task, const std::vector<RefPtr<Job>>& dependencies)
+{
+	RefPtr<Job> job = MakeRefPtr<Job>();
+	job->m_Name = name;
+	job->m_Task = std::move(task);
+	job->m_Timing.Name = name;
+	job->m_Timing.ScheduledMs = GetElapsedMs();
+	job->m_Timing.CriticalDependency = -1;
+
+	for (auto& dependency : dependencies) {
+		std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+		if (dependency->IsDone()) {
+			if (!job->m_Critical || dependency->m_Timing.EndMs > job->m_Critical->m_Timing.EndMs)
+				job->m_Critical = dependency;
+		}
+		else {
+			job->m_Pending++;
+			dependency->m_Dependents.push_back(job);
+		}
+	}
+
+	//Drops the scheduling reference; whichever of this and the last dependency gets here second queues the job
+	if (job->m_Pending.fetch_sub(1) == 1)
+		Enqueue(job);
+	return job;
+}
+
+void ThreadPool::Wait(const RefPtr<Job>& job)
+{
+	if (t_Pool == this) {
+		while (!job->IsDone()) {
+			std::function<void()> next;
+			if (TakeTask(next, t_Index, false))
+				Execute(next);
+			else
+				std::this_thread::yield();
+		}
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(job->m_Mutex);
+	job->m_Finished.wait(lock, [&job] { return job->IsDone(); });
+}
+
+std::vector<JobTiming> ThreadPool::GetTimings()
+{
+	std::lock_guard<std::mutex> lock(m_TimingMutex);
+
+	std::unordered_map<const Job*, int32_t> indices;
+	std::vector<JobTiming> timings;
+	timings.reserve(m_Finished.size());
+	for (auto& job : m_Finished) {
+		indices.emplace(job.get(), static_cast<int32_t>(timings.size()));
+		timings.push_back(job->m_Timing);
+
+		auto critical = job->m_Critical ? indices.find(job->m_Critical.get()) : indices.end();
+		timings.back().CriticalDependency = critical != indices.end() ? critical->second : -1;
+	}
+	return timings;
+}
+
+void ThreadPool::LogTimings()
+{
+	std::vector<JobTiming> timings = GetTimings();
+	{
+		std::lock_guard<std::mutex> lock(m_TimingMutex);
+		m_Finished.clear();
+	}
+	if (timings.empty())
+		return;
+
+	RAYD_INFO("{0:<40} | {1:>6} | {2:>9} | {3:>9} | {4:>9} | {5:>9}", "job", "thread", "ready ms", "start ms", "end ms", "run ms");
+	size_t last = 0;
+	for (size_t i = 0; i < timings.size(); i++) {
+		auto& timing = timings[i];
+		RAYD_INFO("{0:<40} | {1:>6} | {2:>9.2f} | {3:>9.2f} | {4:>9.2f} | {5:>9.2f}", timing.Name, timing.Thread, timing.ReadyMs, timing.StartMs,
+			timing.EndMs, timing.EndMs - timing.StartMs);
+		if (timing.EndMs > timings[last].EndMs)
+			last = i;
+	}
+
+	//Walking back from the job that finished last along the dependency each job waited on gives the chain that set the total
+	std::string path = timings[last].Name;
+	int32_t first = static_cast<int32_t>(last);
+	while (timings[first].CriticalDependency >= 0) {
+		first = timings[first].CriticalDependency;
+		path = timings[first].Name + " -> " + path;
+	}
+	RAYD_INFO("Critical path, {0:.2f} ms: {1}", timings[last].EndMs - timings[first].ScheduledMs, path);
+}
+
+void ThreadPool::WorkerLoop(uint32_t index)
+{
+	t_Pool = this;
+	t_Index = index;
+	RAYD_PROFILE_THREAD("Worker " + std::to_string(index));
+
+	while (true) {
+		std::function<void()> task;
+		if (TakeTask(task, index, false)) {
+			Execute(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_TaskAvailable.wait(lock, [this] { return m_Stopping || m_Queued > 0; });
+		if (m_Stopping && m_Queued == 0)
+			return;
+	}
+}
+
+bool ThreadPool::TakeTask(std::function<void()>& task, uint32_t index, bool foregroundOnly)
+{
+	auto take = [this, &task](std::deque<std::function<void()>>& tasks, bool newest) {
+		if (tasks.empty())
+			return false;
+
+		task = std::move(newest ? tasks.back() : tasks.front());
+		if (newest)
+			tasks.pop_back();
+		else
+			tasks.pop_front();
+
+		//Counted active before it stops counting as queued, so Wait never sees the pool idle in between
+		m_Active++;
+		m_Queued--;
+		return true;
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (take(m_Foreground, false))
+			return true;
+	}
+	if (foregroundOnly)
+		return false;
+
+	//Newest of its own first, while its data is still in cache, then the oldest of everyone else's
+	uint32_t queueCount = static_cast<uint32_t>(m_Queues.size());
+	if (index < queueCount) {
+		std::lock_guard<std::mutex> lock(m_Queues[index]->Mutex);
+		if (take(m_Queues[index]->Tasks, true))
+			return true;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (take(m_Injected, false))
+			return true;
+	}
+	for (uint32_t i = 1; i <= queueCount; i++) {
+		uint32_t victim = (index + i) % queueCount;
+		if (victim == index)
+			continue;
+
+		std::lock_guard<std::mutex> lock(m_Queues[victim]->Mutex);
+		if (take(m_Queues[victim]->Tasks, false))
+			return true;
+	}
+	return false;
+}
+
+void ThreadPool::Execute(std::function<void()>& task)
+{
+	task();
+	task = nullptr;
+
+	if (m_Active.fetch_sub(1) == 1 && m_Queued == 0) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Idle.notify_all();
+	}
+}
+
+void ThreadPool::Push(std::function<void()> task, bool foreground)
+{
+	//Counted before it is visible, so a worker that finds the count raised may briefly find nothing, never the reverse
+	bool local = !foreground && t_Pool == this;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Queued++;
+		if (foreground)
+			m_Foreground.push_back(std::move(task));
+		else if (!local)
+			m_Injected.push_back(std::move(task));
+	}
+	if (local) {
+		std::lock_guard<std::mutex> lock(m_Queues[t_Index]->Mutex);
+		m_Queues[t_Index]->Tasks.push_back(std::move(task));
+	}
+	m_TaskAvailable.notify_one();
+}
+
+void ThreadPool::Enqueue(RefPtr<Job> job)
+{
+	job->m_Timing.ReadyMs = GetElapsedMs();
+	Push([this, job] { Run(job); }, false);
+}
+
+void ThreadPool::Run(const RefPtr<Job>& job)
+{
+	job->m_Timing.Thread = t_Pool == this ? t_Index : GetThreadCount();
+	job->m_Timing.StartMs = GetElapsedMs();
+	job->m_Task();
+	job->m_Task = nullptr;
+	job->m_Timing.EndMs = GetElapsedMs();
+
+	std::vector<RefPtr<Job>> dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->m_Mutex);
+		job->m_Done.store(true, std::memory_order_release);
+		dependents.swap(job->m_Dependents);
+	}
+	job->m_Finished.notify_all();
+
+	if (!job->m_Name.empty()) {
+		std::lock_guard<std::mutex> lock(m_TimingMutex);
+		m_Finished.push_back(job);
+		if (m_Finished.size() > JOB_TIMING_CAPACITY)
+			m_Finished.pop_front();
+	}
+
+	//Released onto this worker's own deque, where the data the job just produced is most likely still cached
+	for (auto& dependent : dependents) {
+		{
+			std::lock_guard<std::mutex> lock(dependent->m_Mutex);
+			if (!dependent->m_Critical || job->m_Timing.EndMs > dependent->m_Critical->m_Timing.EndMs)
+				dependent->m_Critical = job;
+		}
+		if (dependent->m_Pending.fetch_sub(1) == 1)
+			Enqueue(dependent);
+	}
+}
+
+double ThreadPool::GetElapsedMs() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_Start).count();
+}
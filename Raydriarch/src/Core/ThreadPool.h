@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Core.h"
+
+//Finished named jobs a pool remembers for timing, oldest dropped first
+#define JOB_TIMING_CAPACITY 4096
+
+//Where and when a job ran, in milliseconds since its pool was created
+struct JobTiming {
+	std::string Name;
+	//Worker index; the pool's thread count for a thread that helped while waiting
+	uint32_t Thread;
+	double ScheduledMs;
+	//Last dependency finished
+	double ReadyMs;
+	double StartMs;
+	double EndMs;
+	//Index of the dependency that finished last, the one the job actually waited on; -1 when it had none
+	int32_t CriticalDependency;
+};
+
+//Scheduled task that runs once every job it depends on has finished
+class Job {
+public:
+	inline bool IsDone() const { return m_Done.load(std::memory_order_acquire); }
+	inline const std::string& GetName() const { return m_Name; }
+private:
+	friend class ThreadPool;
+
+	std::string m_Name;
+	std::function<void()> m_Task;
+	//Unfinished dependencies, plus one while the job is still being scheduled
+	std::atomic<uint32_t> m_Pending{ 1 };
+	std::atomic<bool> m_Done{ false };
+	std::vector<RefPtr<Job>> m_Dependents;
+	std::mutex m_Mutex;
+	std::condition_variable m_Finished;
+
+	JobTiming m_Timing{};
+	RefPtr<Job> m_Critical;
+};
+
+//Result of a job, readable once the job is done
+template<typename T>
+class JobFuture {
+public:
+	JobFuture() = default;
+	JobFuture(RefPtr<Job> job, RefPtr<T> result) : m_Job(std::move(job)), m_Result(std::move(result)) {}
+
+	inline bool IsValid() const { return m_Job != nullptr; }
+	inline bool IsReady() const { return m_Job && m_Job->IsDone(); }
+	inline const RefPtr<Job>& GetJob() const { return m_Job; }
+	inline T& Get() const { RAYD_ASSERT(IsReady(), "Job result read before the job finished!"); return *m_Result; }
+private:
+	RefPtr<Job> m_Job;
+	RefPtr<T> m_Result;
+};
+
+//Fixed set of worker threads. Each worker keeps its own deque of jobs, taking the newest of its own and stealing the
+//oldest of the others' when it runs dry; jobs scheduled from outside the pool land in a shared queue. ParallelFor tasks
+//sit in a separate queue every worker checks first, so per-frame work never queues behind long background jobs.
+class ThreadPool {
+public:
+	ThreadPool(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency()));
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	//Background task with no handle
+	void Submit(std::function<void()> task);
+	//Blocks until every queue is drained and every worker is idle
+	void Wait();
+	//Runs task(0) .. task(count - 1) across the workers and returns once all of them have finished. The calling thread
+	//runs tasks of this kind while it waits, so a ParallelFor inside a job cannot deadlock the pool.
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+
+	//Queues task to run once every dependency has finished; named jobs record their timing
+	RefPtr<Job> Schedule(const std::string& name, std::function<void()> task, const std::vector<RefPtr<Job>>& dependencies = {});
+	template<typename F>
+	JobFuture<std::invoke_result_t<F>> Async(const std::string& name, F&& task, const std::vector<RefPtr<Job>>& dependencies = {});
+	//Blocks until the job has finished; a worker runs other jobs meanwhile instead of sleeping
+	void Wait(const RefPtr<Job>& job);
+
+	//Timings of the named jobs finished since the last log, in the order they finished
+	std::vector<JobTiming> GetTimings();
+	//Logs the timings and the chain of dependencies ending at the job that finished last, then forgets them
+	void LogTimings();
+
+	inline uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+private:
+	struct WorkQueue {
+		std::mutex Mutex;
+		std::deque<std::function<void()>> Tasks;
+	};
+
+	void WorkerLoop(uint32_t index);
+	bool TakeTask(std::function<void()>& task, uint32_t index, bool foregroundOnly);
+	void Execute(std::function<void()>& task);
+	void Push(std::function<void()> task, bool foreground);
+	void Enqueue(RefPtr<Job> job);
+	void Run(const RefPtr<Job>& job);
+	double GetElapsedMs() const;
+private:
+	std::vector<std::thread> m_Workers;
+	std::vector<ScopedPtr<WorkQueue>> m_Queues;
+	std::deque<std::function<void()>> m_Foreground;
+	std::deque<std::function<void()>> m_Injected;
+	std::atomic<uint32_t> m_Queued;
+	std::atomic<uint32_t> m_Active;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_TaskAvailable;
+	std::condition_variable m_Idle;
+	bool m_Stopping;
+
+	std::chrono::high_resolution_clock::time_point m_Start;
+	std::mutex m_TimingMutex;
+	std::deque<RefPtr<Job>> m_Finished;
+};
+
+template<typename F>
+JobFuture<std::invoke_result_t<F>> ThreadPool::Async(const std::string& name, F&& task, const std::vector<RefPtr<Job>>& dependencies)
+{
+	using Result = std::invoke_result_t<F>;
+	RefPtr<Result> result = MakeRefPtr<Result>();
+	RefPtr<Job> job = Schedule(name, [result, task = std::forward<F>(task)]() mutable { *result = task(); }, dependencies);
+	return JobFuture<Result>(std::move(job), std::move(result));
+}
@@ -8,6 +8,12 @@ static bool s_GLFWInitialized = false;
 Window::Window(const WindowProps& props)
 	:m_Props(props), m_Window(nullptr)
 {
+	if (m_Props.Headless) {
+		auto extensions = GetRequiredVulkanExtensions();
+		m_Context = MakeScopedPtr<GraphicsContext>(static_cast<uint32_t>(extensions.size()), extensions.data());
+		return;
+	}
+
 	if (!s_GLFWInitialized)
 	{
 		int success = glfwInit();
@@ -23,8 +29,8 @@ Window::Window(const WindowProps& props)
 	m_Window = glfwCreateWindow(props.Width, props.Height, m_Props.Title.c_str(), nullptr, nullptr);
 	glfwSetWindowUserPointer(m_Window, this);
 
-	auto& glfwExtensions = GetRequiredVulkanExtensions();
-	m_Context = MakeScopedPtr<GraphicsContext>(glfwExtensions.size(), glfwExtensions.data());
+	auto extensions = GetRequiredVulkanExtensions();
+	m_Context = MakeScopedPtr<GraphicsContext>(static_cast<uint32_t>(extensions.size()), extensions.data());
 
 	glfwSetWindowSizeCallback(m_Window, [](GLFWwindow* window, int width, int height)
 		{
@@ -43,33 +49,66 @@ Window::Window(const WindowProps& props)
 
 Window::~Window()
 {
+	if (!m_Window)
+		return;
+
 	glfwDestroyWindow(m_Window);
 	glfwTerminate();
+	s_GLFWInitialized = false;
 }
 
 std::pair<uint32_t, uint32_t> Window::GetFramebufferSize() const
 {
+	if (!m_Window)
+		return { m_Props.Width, m_Props.Height };
+
 	int width, height;
 	glfwGetFramebufferSize(m_Window, &width, &height);
 
 	return { width, height };
 }
 
-void Window::Update()
+void Window::SetSize(uint32_t width, uint32_t height)
 {
-	glfwPollEvents();
+	if (m_Window) {
+		glfwSetWindowSize(m_Window, width, height);
+		return;
+	}
+
+	//No callback will report it, so flag the resize here for the next present
+	m_Props.Width = width;
+	m_Props.Height = height;
+	m_Resized = true;
 }
 
-std::vector<const char*>& Window::GetRequiredVulkanExtensions()
+void Window::Update()
 {
-	uint32_t glfwExtensionCount;
-	const char** glfwExtensionNames;
-	glfwExtensionNames = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	if (m_Window)
+		glfwPollEvents();
+}
 
-	static std::vector<const char*> extensions(glfwExtensionNames, glfwExtensionNames + glfwExtensionCount);
+std::vector<const char*> Window::GetRequiredVulkanExtensions() const
+{
+	//Surface extensions are only needed to present
+	std::vector<const char*> extensions;
+	if (!m_Props.Headless) {
+		uint32_t glfwExtensionCount;
+		const char** glfwExtensionNames;
+		glfwExtensionNames = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		extensions.assign(glfwExtensionNames, glfwExtensionNames + glfwExtensionCount);
+	}
 
 #ifdef RAYD_DEBUG
 	extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#else
+	//Optional outside debug builds, only so capture tools see the GPU profiler's scopes as labels
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> available(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, available.data());
+	for (auto& extension : available)
+		if (strcmp(extension.extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0)
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
 
 	return extensions;
@@ -77,7 +116,7 @@ std::vector<const char*>& Window::GetRequiredVulkanExtensions()
 
 ScopedPtr<Surface>& Window::GetSurface()
 {
-	if (!m_Surface) {
+	if (!m_Surface && m_Window) {
 		auto& instance = m_Context->GetInstance();
 
 		VkSurfaceKHR surface;
@@ -11,6 +11,8 @@ struct WindowProps {
 	std::string Title;
 	uint32_t Width = 1280;
 	uint32_t Height = 720;
+	//No GLFW window, surface or display; Graphics renders into offscreen targets instead of presenting
+	bool Headless = false;
 };
 
 class Window {
@@ -21,21 +23,26 @@ public:
 
 	inline uint32_t GetWidth() const { return m_Props.Width; }
 	inline uint32_t GetHeight() const { return m_Props.Height; }
+	inline bool IsHeadless() const { return m_Props.Headless; }
 
 	std::pair<uint32_t, uint32_t> GetFramebufferSize() const;
 	inline uint32_t GetFramebufferWidth() const { return GetFramebufferSize().first; }
 	inline uint32_t GetFramebufferHeight() const { return GetFramebufferSize().second; }
 
+	//Resizes the window; the swap chain follows on the next present that notices
+	void SetSize(uint32_t width, uint32_t height);
 	void Update();
-	inline int IsClosed() const { return glfwWindowShouldClose(m_Window); }
+	//A headless window is never closed, so whoever drives it decides how many frames to render
+	inline int IsClosed() const { return m_Window ? glfwWindowShouldClose(m_Window) : false; }
 
 	inline GLFWwindow* GetHandle() const { return m_Window; }
 	inline GraphicsContext& GetGraphicsContext() const { return *m_Context; }
 
+	//Empty for a headless window
 	ScopedPtr<Surface>& GetSurface();
 
 private:
-	static std::vector<const char*>& GetRequiredVulkanExtensions();
+	std::vector<const char*> GetRequiredVulkanExtensions() const;
 private:
 	GLFWwindow* m_Window;
 	WindowProps m_Props;
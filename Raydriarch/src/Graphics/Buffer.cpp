@@ -1,55 +1,43 @@
 #include "raydpch.h"
 #include "Buffer.h"
 
-#include "Command.h"
+static const ResourceMetrics s_BufferMetrics = { Metrics::Register("buffer.live", MetricKind::Gauge), Metrics::Register("buffer.bytes", MetricKind::Gauge) };
 
 Buffer::~Buffer()
 {
-	vkFreeMemory(m_Device->GetDeviceHandle(), m_Memory, nullptr);
+	if (m_Metrics) {
+		Metrics::Add(m_Metrics->Live, -1);
+		Metrics::Add(m_Metrics->Bytes, -static_cast<int64_t>(m_TrackedBytes));
+	}
+	m_Device->GetAllocator().Free(m_Allocation);
 }
 
-void Buffer::Copy(VkDeviceSize size, VkBuffer& srcBuffer, VkBuffer& dstBuffer)
+void Buffer::Copy(VkDeviceSize size, VkBuffer& srcBuffer, VkDeviceSize srcOffset, VkBuffer& dstBuffer, VkDeviceSize dstOffset)
 {
-	VkCommandBuffer commandBuffer = Command::BeginSingleTimeCommands();
-
 	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
 	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+	vkCmdCopyBuffer(Upload::GetTransferCommands(), srcBuffer, dstBuffer, 1, &copyRegion);
 
-	Command::EndSingleTimeCommands(commandBuffer);
+	m_UploadToken = Upload::GetPendingToken();
 }
 
-void Buffer::Map(VkDeviceMemory& memory, VkDeviceSize size, const void* data)
+void Buffer::Allocate(Allocation& allocation, VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memFlags, AllocationKind kind)
 {
-	void* mappedData;
-	RAYD_VK_VALIDATE(vkMapMemory(m_Device->GetDeviceHandle(), memory, 0, size, 0, &mappedData), "Failed to map to memory!");
-	memcpy(mappedData, data, size);
-	vkUnmapMemory(m_Device->GetDeviceHandle(), memory);
+	allocation = m_Device->GetAllocator().Allocate(memReqs, memFlags, kind);
 }
 
-void Buffer::Allocate(VkDeviceMemory& memory, VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memFlags)
+void Buffer::Track(const ResourceMetrics& metrics)
 {
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memReqs.size;
-	VkPhysicalDeviceMemoryProperties memProps;
-	vkGetPhysicalDeviceMemoryProperties(m_Device->GetPhysicalDeviceHandle(), &memProps);
-
-	int32_t memTypeIndex = -1;
-	for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
-		if ((memReqs.memoryTypeBits & (1 << i)) && (memProps.memoryTypes[i].propertyFlags & memFlags) == memFlags) {
-			memTypeIndex = i;
-			break;
-		}
-	}
-
-	RAYD_ASSERT(memTypeIndex >= 0, "Failed to find suitable memory type!");
-	allocInfo.memoryTypeIndex = memTypeIndex;
-
-	RAYD_VK_VALIDATE(vkAllocateMemory(m_Device->GetDeviceHandle(), &allocInfo, nullptr, &memory), "Failed to allocate memory!");
+	RAYD_ASSERT(!m_Metrics, "Resource is already tracked!");
+	m_Metrics = &metrics;
+	m_TrackedBytes = m_Allocation.Size;
+	Metrics::Add(metrics.Live);
+	Metrics::Add(metrics.Bytes, static_cast<int64_t>(m_TrackedBytes));
 }
 
-void Buffer::Create(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memFlags)
+void Buffer::Create(VkBuffer& buffer, Allocation& allocation, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memFlags)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -57,13 +45,24 @@ void Buffer::Create(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize size,
 	bufferInfo.usage = usage;
  	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	RAYD_VK_VALIDATE(vkCreateBuffer(m_Device->GetDeviceHandle(), &bufferInfo, nullptr, &buffer), "Failed to create buffer!");
+	//Resources filled on the transfer queue are read on the graphics queue without ownership transfers
+	auto& queueFamilies = m_Device->GetQueueFamilies();
+	uint32_t queueFamilyIndices[] = { *queueFamilies.Graphics.Index, *queueFamilies.Transfer.Index };
+	if (m_Device->HasDedicatedTransferQueue()) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+
+	VkResult result = vkCreateBuffer(m_Device->GetDeviceHandle(), &bufferInfo, nullptr, &buffer);
+	RAYD_VK_VALIDATE(result, "Failed to create buffer!");
 
 	VkMemoryRequirements memReqs;
 	vkGetBufferMemoryRequirements(m_Device->GetDeviceHandle(), buffer, &memReqs);
 
-	Allocate(memory, memReqs, memFlags);
-	vkBindBufferMemory(m_Device->GetDeviceHandle(), buffer, memory, 0);
+	Allocate(allocation, memReqs, memFlags);
+	vkBindBufferMemory(m_Device->GetDeviceHandle(), buffer, allocation.Memory, allocation.Offset);
+	Track(s_BufferMetrics);
 }
 
 VertexBuffer::VertexBuffer(RefPtr<Device> device, uint32_t vertexCount, VkDeviceSize size, const void* data)
@@ -72,16 +71,10 @@ VertexBuffer::VertexBuffer(RefPtr<Device> device, uint32_t vertexCount, VkDevice
 	m_Device = device;
 	m_Size = size;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMem;
-	Create(stagingBuffer, stagingMem, m_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	Map(stagingMem, m_Size, data);
+	StagingRegion staging = Upload::Stage(data, m_Size);
 
-	Create(m_Buffer, m_Memory, m_Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	Copy(m_Size, stagingBuffer, m_Buffer);
-
-	vkDestroyBuffer(m_Device->GetDeviceHandle(), stagingBuffer, nullptr);
-	vkFreeMemory(m_Device->GetDeviceHandle(), stagingMem, nullptr);
+	Create(m_Buffer, m_Allocation, m_Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Copy(m_Size, staging.Buffer, staging.Offset, m_Buffer);
 }
 
 VertexBuffer::~VertexBuffer()
@@ -101,16 +94,10 @@ IndexBuffer::IndexBuffer(RefPtr<Device> device, uint32_t indexCount, VkDeviceSiz
 	m_Device = device;
 	m_Size = size;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMem;
-	Create(stagingBuffer, stagingMem, m_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	Map(stagingMem, m_Size, data);
-
-	Create(m_Buffer, m_Memory, m_Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	Copy(m_Size, stagingBuffer, m_Buffer);
+	StagingRegion staging = Upload::Stage(data, m_Size);
 
-	vkDestroyBuffer(m_Device->GetDeviceHandle(), stagingBuffer, nullptr);
-	vkFreeMemory(m_Device->GetDeviceHandle(), stagingMem, nullptr);
+	Create(m_Buffer, m_Allocation, m_Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Copy(m_Size, staging.Buffer, staging.Offset, m_Buffer);
 }
 
 IndexBuffer::~IndexBuffer()
@@ -123,12 +110,29 @@ void IndexBuffer::Bind(VkCommandBuffer& cmdBuffer)
 	vkCmdBindIndexBuffer(cmdBuffer, m_Buffer, 0, VK_INDEX_TYPE_UINT32);
 }
 
-UniformBuffer::UniformBuffer(RefPtr<Device> device, VkDeviceSize size)
+StagingBuffer::StagingBuffer(RefPtr<Device> device, VkDeviceSize size)
 {
 	m_Device = device;
 	m_Size = size;
 
-	Create(m_Buffer, m_Memory, m_Size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	Create(m_Buffer, m_Allocation, m_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+StagingBuffer::~StagingBuffer()
+{
+	vkDestroyBuffer(m_Device->GetDeviceHandle(), m_Buffer, nullptr);
+}
+
+UniformBuffer::UniformBuffer(RefPtr<Device> device, VkDeviceSize elementSize, uint32_t elementsPerFrame, uint32_t frameCount)
+	:m_ElementSize(elementSize), m_ElementsPerFrame(elementsPerFrame), m_FrameOffset(0), m_Count(0)
+{
+	m_Device = device;
+
+	VkDeviceSize alignment = m_Device->GetProperties().limits.minUniformBufferOffsetAlignment;
+	m_Stride = (elementSize + alignment - 1) / alignment * alignment;
+	m_Size = m_Stride * elementsPerFrame * frameCount;
+
+	Create(m_Buffer, m_Allocation, m_Size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 }
 
 UniformBuffer::~UniformBuffer()
@@ -136,29 +140,83 @@ UniformBuffer::~UniformBuffer()
 	vkDestroyBuffer(m_Device->GetDeviceHandle(), m_Buffer, nullptr);
 }
 
-void UniformBuffer::Update(VkDeviceSize size, const void* data)
+void UniformBuffer::BeginFrame(uint32_t frame)
 {
-	Map(m_Memory, size, data);
+	m_FrameOffset = m_Stride * m_ElementsPerFrame * frame;
+	m_Count = 0;
+}
+
+uint32_t UniformBuffer::Push(const void* data)
+{
+	//Checked in every build: a full region reuses its last element rather than writing into the next frame's
+	if (m_Count == m_ElementsPerFrame) {
+		RAYD_WARN("Uniform buffer frame region is full, its last element is overwritten");
+		m_Count--;
+	}
+
+	VkDeviceSize offset = m_FrameOffset + m_Stride * m_Count++;
+	memcpy(static_cast<char*>(m_Allocation.Mapped) + offset, data, m_ElementSize);
+	return static_cast<uint32_t>(offset);
+}
+
+//Byte size of one element of every format usable as a vertex attribute, 0 for anything else
+static uint32_t GetFormatSize(VkFormat format)
+{
+	switch (format) {
+	case VK_FORMAT_R8_UNORM: case VK_FORMAT_R8_SNORM: case VK_FORMAT_R8_USCALED: case VK_FORMAT_R8_SSCALED:
+	case VK_FORMAT_R8_UINT: case VK_FORMAT_R8_SINT:
+		return 1;
+	case VK_FORMAT_R8G8_UNORM: case VK_FORMAT_R8G8_SNORM: case VK_FORMAT_R8G8_USCALED: case VK_FORMAT_R8G8_SSCALED:
+	case VK_FORMAT_R8G8_UINT: case VK_FORMAT_R8G8_SINT:
+	case VK_FORMAT_R16_UNORM: case VK_FORMAT_R16_SNORM: case VK_FORMAT_R16_USCALED: case VK_FORMAT_R16_SSCALED:
+	case VK_FORMAT_R16_UINT: case VK_FORMAT_R16_SINT: case VK_FORMAT_R16_SFLOAT:
+		return 2;
+	case VK_FORMAT_R8G8B8_UNORM: case VK_FORMAT_R8G8B8_SNORM: case VK_FORMAT_R8G8B8_UINT: case VK_FORMAT_R8G8B8_SINT:
+		return 3;
+	case VK_FORMAT_R8G8B8A8_UNORM: case VK_FORMAT_R8G8B8A8_SNORM: case VK_FORMAT_R8G8B8A8_USCALED: case VK_FORMAT_R8G8B8A8_SSCALED:
+	case VK_FORMAT_R8G8B8A8_UINT: case VK_FORMAT_R8G8B8A8_SINT: case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32: case VK_FORMAT_A2B10G10R10_SNORM_PACK32: case VK_FORMAT_A2B10G10R10_UINT_PACK32:
+	case VK_FORMAT_A2R10G10B10_UNORM_PACK32: case VK_FORMAT_A2R10G10B10_SNORM_PACK32: case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+	case VK_FORMAT_R16G16_UNORM: case VK_FORMAT_R16G16_SNORM: case VK_FORMAT_R16G16_USCALED: case VK_FORMAT_R16G16_SSCALED:
+	case VK_FORMAT_R16G16_UINT: case VK_FORMAT_R16G16_SINT: case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_R32_UINT: case VK_FORMAT_R32_SINT: case VK_FORMAT_R32_SFLOAT:
+		return 4;
+	case VK_FORMAT_R16G16B16_UNORM: case VK_FORMAT_R16G16B16_SNORM: case VK_FORMAT_R16G16B16_UINT: case VK_FORMAT_R16G16B16_SINT:
+	case VK_FORMAT_R16G16B16_SFLOAT:
+		return 6;
+	case VK_FORMAT_R16G16B16A16_UNORM: case VK_FORMAT_R16G16B16A16_SNORM: case VK_FORMAT_R16G16B16A16_USCALED: case VK_FORMAT_R16G16B16A16_SSCALED:
+	case VK_FORMAT_R16G16B16A16_UINT: case VK_FORMAT_R16G16B16A16_SINT: case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32_SFLOAT:
+		return 8;
+	case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32_SFLOAT:
+		return 12;
+	case VK_FORMAT_R32G32B32A32_UINT: case VK_FORMAT_R32G32B32A32_SINT: case VK_FORMAT_R32G32B32A32_SFLOAT:
+	case VK_FORMAT_R64G64_SFLOAT:
+		return 16;
+	case VK_FORMAT_R64G64B64_SFLOAT:
+		return 24;
+	case VK_FORMAT_R64G64B64A64_SFLOAT:
+		return 32;
+	default:
+		return 0;
+	}
 }
 
 void VertexLayout::AddAttribute(uint32_t location, uint32_t binding, VkFormat format)
 {
+	if (binding >= m_Offsets.size())
+		m_Offsets.resize(binding + 1, 0);
+
 	VkVertexInputAttributeDescription desc;
 	desc.binding = binding;
 	desc.location = location;
 	desc.format = format;
-	desc.offset = m_Offset;
+	desc.offset = m_Offsets[binding];
 
-	switch (format) {
-	case VK_FORMAT_R32G32_SFLOAT:
-		m_Offset += 2 * 4;
-		break;
-	case VK_FORMAT_R32G32B32_SFLOAT:
-		m_Offset += 3 * 4;
-		break;
-	default:
+	uint32_t size = GetFormatSize(format);
+	if (size == 0)
 		RAYD_ERROR("Unsupported format!");
-	}
+	m_Offsets[binding] += size;
 
 	m_AttribDescriptions.push_back(desc);
 }
@@ -171,3 +229,77 @@ void VertexLayout::AddBinding(uint32_t binding, uint32_t stride, VkVertexInputRa
 	desc.inputRate = inputRate;
 	m_Bindings.push_back(desc);
 }
+
+InstanceBuffer::InstanceBuffer(RefPtr<Device> device, VkDeviceSize stride, uint32_t instancesPerFrame, uint32_t frameCount, VkBufferUsageFlags extraUsage)
+	:m_Stride(stride), m_InstancesPerFrame(instancesPerFrame), m_FrameBase(0), m_Count(0)
+{
+	m_Device = device;
+	m_Size = m_Stride * instancesPerFrame * frameCount;
+
+	Create(m_Buffer, m_Allocation, m_Size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraUsage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	vkDestroyBuffer(m_Device->GetDeviceHandle(), m_Buffer, nullptr);
+}
+
+void InstanceBuffer::BeginFrame(uint32_t frame)
+{
+	m_FrameBase = m_InstancesPerFrame * frame;
+	m_Count = 0;
+}
+
+uint32_t InstanceBuffer::Push(const void* data, uint32_t& count)
+{
+	//Checked in every build: past the frame region the copy would run into the next frame's, or off the mapping
+	if (count > m_InstancesPerFrame - m_Count) {
+		RAYD_WARN("Instance buffer frame region is full, {0} of {1} instances were dropped", count - (m_InstancesPerFrame - m_Count), count);
+		count = m_InstancesPerFrame - m_Count;
+	}
+
+	uint32_t first = m_FrameBase + m_Count;
+	memcpy(static_cast<char*>(m_Allocation.Mapped) + first * m_Stride, data, count * m_Stride);
+	m_Count += count;
+	return first;
+}
+
+void InstanceBuffer::Bind(VkCommandBuffer& cmdBuffer, uint32_t binding)
+{
+	const VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmdBuffer, binding, 1, &m_Buffer, &offset);
+}
+
+DeviceBuffer::DeviceBuffer(RefPtr<Device> device, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	m_Device = device;
+	m_Size = size;
+
+	Create(m_Buffer, m_Allocation, m_Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+DeviceBuffer::~DeviceBuffer()
+{
+	vkDestroyBuffer(m_Device->GetDeviceHandle(), m_Buffer, nullptr);
+}
+
+void DeviceBuffer::Write(VkDeviceSize offset, VkDeviceSize size, const void* data)
+{
+	RAYD_ASSERT(offset + size <= m_Size, "Write past the end of device buffer!");
+
+	StagingRegion staging = Upload::Stage(data, size);
+	Copy(size, staging.Buffer, staging.Offset, m_Buffer, offset);
+}
+
+ReadbackBuffer::ReadbackBuffer(RefPtr<Device> device, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	m_Device = device;
+	m_Size = size;
+
+	Create(m_Buffer, m_Allocation, m_Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+ReadbackBuffer::~ReadbackBuffer()
+{
+	vkDestroyBuffer(m_Device->GetDeviceHandle(), m_Buffer, nullptr);
+}
\ No newline at end of file
@@ -3,19 +3,34 @@
 #include "GraphicsCore.h"
 
 #include "Device.h"
+#include "Upload.h"
+#include "Core/Metrics.h"
+
+//Gauges a kind of resource reports its live count and bytes into
+struct ResourceMetrics {
+	MetricID Live;
+	MetricID Bytes;
+};
 
 class Buffer {
 public:
 	~Buffer();
+	inline UploadToken GetUploadToken() const { return m_UploadToken; }
+	inline bool IsResident() const { return Upload::IsComplete(m_UploadToken); }
 protected:
-	void Create(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memFlags);
-	void Copy(VkDeviceSize size, VkBuffer& srcBuffer, VkBuffer& dstBuffer);
-	void Map(VkDeviceMemory& memory, VkDeviceSize size, const void* data);
-	void Allocate(VkDeviceMemory& memory, VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memFlags);
+	void Create(VkBuffer& buffer, Allocation& allocation, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memFlags);
+	void Copy(VkDeviceSize size, VkBuffer& srcBuffer, VkDeviceSize srcOffset, VkBuffer& dstBuffer, VkDeviceSize dstOffset = 0);
+	void Allocate(Allocation& allocation, VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memFlags, AllocationKind kind = AllocationKind::Linear);
+	//Counts m_Allocation into the metrics until the resource is destroyed
+	void Track(const ResourceMetrics& metrics);
 
 protected:
 	RefPtr<Device> m_Device;
-	VkDeviceMemory m_Memory;
+	Allocation m_Allocation;
+	UploadToken m_UploadToken = 0;
+private:
+	const ResourceMetrics* m_Metrics = nullptr;
+	VkDeviceSize m_TrackedBytes = 0;
 };
 
 struct Attribute {
@@ -54,7 +69,7 @@ private:
 
 class VertexLayout {
 public:
-	VertexLayout() : m_Offset(0) {}
+	VertexLayout() {}
 	void AddAttribute(uint32_t location, uint32_t binding, VkFormat format);
 	void AddBinding(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate);
 
@@ -64,16 +79,87 @@ public:
 private:
 	std::vector<VkVertexInputAttributeDescription> m_AttribDescriptions;
 	std::vector<VkVertexInputBindingDescription> m_Bindings;
-	uint32_t m_Offset;
+	//Running attribute offset of each binding
+	std::vector<uint32_t> m_Offsets;
+};
+
+class StagingBuffer : public Buffer {
+public:
+	StagingBuffer(RefPtr<Device> device, VkDeviceSize size);
+	~StagingBuffer();
+	inline const VkBuffer& GetBufferHandle() const { return m_Buffer; }
+	inline char* GetMapped() const { return static_cast<char*>(m_Allocation.Mapped); }
+	inline VkDeviceSize GetSize() const { return m_Size; }
+private:
+	VkBuffer m_Buffer;
+	VkDeviceSize m_Size;
 };
 
+//Persistently mapped arena with one region per frame in flight, addressed through dynamic descriptor offsets
 class UniformBuffer : public Buffer {
 public:
-	UniformBuffer(RefPtr<Device> device, VkDeviceSize size);
+	UniformBuffer(RefPtr<Device> device, VkDeviceSize elementSize, uint32_t elementsPerFrame, uint32_t frameCount);
 	~UniformBuffer();
-	void Update(VkDeviceSize size, const void* data);
+	void BeginFrame(uint32_t frame);
+	//Returns the dynamic offset of the pushed element; once the frame's region is full the last element is overwritten
+	uint32_t Push(const void* data);
+	inline const VkBuffer& GetBufferHandle() const { return m_Buffer; }
+	inline VkDeviceSize GetElementSize() const { return m_ElementSize; }
+private:
+	VkBuffer m_Buffer;
+	VkDeviceSize m_Size;
+
+	VkDeviceSize m_ElementSize;
+	VkDeviceSize m_Stride;
+	uint32_t m_ElementsPerFrame;
+	VkDeviceSize m_FrameOffset;
+	uint32_t m_Count;
+};
+
+//Persistently mapped per-instance vertex stream with one region per frame in flight
+class InstanceBuffer : public Buffer {
+public:
+	InstanceBuffer(RefPtr<Device> device, VkDeviceSize stride, uint32_t instancesPerFrame, uint32_t frameCount, VkBufferUsageFlags extraUsage = 0);
+	~InstanceBuffer();
+	void BeginFrame(uint32_t frame);
+	//Returns the firstInstance the pushed range is drawn with; count is clamped to what is left of the frame's region
+	uint32_t Push(const void* data, uint32_t& count);
+	void Bind(VkCommandBuffer& cmdBuffer, uint32_t binding);
+	inline const VkBuffer& GetBufferHandle() const { return m_Buffer; }
+	inline uint32_t GetInstancesPerFrame() const { return m_InstancesPerFrame; }
+	inline VkDeviceSize GetSize() const { return m_Size; }
+private:
+	VkBuffer m_Buffer;
+	VkDeviceSize m_Size;
+
+	VkDeviceSize m_Stride;
+	uint32_t m_InstancesPerFrame;
+	uint32_t m_FrameBase;
+	uint32_t m_Count;
+};
+
+//Device-local buffer filled through the upload batch, for storage and indirect data
+class DeviceBuffer : public Buffer {
+public:
+	DeviceBuffer(RefPtr<Device> device, VkDeviceSize size, VkBufferUsageFlags usage);
+	~DeviceBuffer();
+	void Write(VkDeviceSize offset, VkDeviceSize size, const void* data);
 	inline const VkBuffer& GetBufferHandle() const { return m_Buffer; }
+	inline VkDeviceSize GetSize() const { return m_Size; }
 private:
 	VkBuffer m_Buffer;
 	VkDeviceSize m_Size;
 };
+
+//Host-visible buffer the GPU writes into and the CPU reads back once the frame that wrote it has signaled its fence
+class ReadbackBuffer : public Buffer {
+public:
+	ReadbackBuffer(RefPtr<Device> device, VkDeviceSize size, VkBufferUsageFlags usage);
+	~ReadbackBuffer();
+	inline const VkBuffer& GetBufferHandle() const { return m_Buffer; }
+	inline const char* GetMapped() const { return static_cast<const char*>(m_Allocation.Mapped); }
+	inline VkDeviceSize GetSize() const { return m_Size; }
+private:
+	VkBuffer m_Buffer;
+	VkDeviceSize m_Size;
+};
\ No newline at end of file
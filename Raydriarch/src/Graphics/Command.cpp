@@ -1,6 +1,13 @@
 #include "raydpch.h"
 #include "Command.h"
 
+#include "Core/Metrics.h"
+
+static const MetricID s_SubmitMetric = Metrics::Register("command.submits", MetricKind::Counter);
+static const MetricID s_SubmittedBuffersMetric = Metrics::Register("command.buffers_submitted", MetricKind::Counter);
+static const MetricID s_BarrierCallsMetric = Metrics::Register("command.pipeline_barriers", MetricKind::Counter);
+static const MetricID s_BarriersMetric = Metrics::Register("command.barriers", MetricKind::Counter);
+
 static struct CommandObjects {
 	RefPtr<Device> GPU;
 	VkCommandPool Pool;
@@ -18,6 +25,7 @@ void Command::Shutdown()
 }
 
 VkCommandBuffer Command::BeginSingleTimeCommands() {
+	RAYD_PROFILE_SCOPE("Command::BeginSingleTimeCommands");
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -37,6 +45,8 @@ VkCommandBuffer Command::BeginSingleTimeCommands() {
 }
 
 void Command::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
+	//Waits for the queue to go idle, so every call is a stall worth seeing
+	RAYD_PROFILE_SCOPE("Command::EndSingleTimeCommands");
 	vkEndCommandBuffer(commandBuffer);
 
 	VkSubmitInfo submitInfo{};
@@ -44,11 +54,30 @@ void Command::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	vkQueueSubmit(s_Objects->GPU->GetQueueFamilies().Graphics.Queue, 1, &submitInfo, VK_NULL_HANDLE);
+	Submit(s_Objects->GPU->GetQueueFamilies().Graphics.Queue, 1, &submitInfo, VK_NULL_HANDLE);
 	vkQueueWaitIdle(s_Objects->GPU->GetQueueFamilies().Graphics.Queue);
 
 	vkFreeCommandBuffers(s_Objects->GPU->GetDeviceHandle(), s_Objects->Pool, 1, &commandBuffer);
 }
 
+VkResult Command::Submit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* submits, VkFence fence)
+{
+	uint32_t commandBufferCount = 0;
+	for (uint32_t i = 0; i < submitCount; i++)
+		commandBufferCount += submits[i].commandBufferCount;
+	Metrics::Add(s_SubmitMetric);
+	Metrics::Add(s_SubmittedBuffersMetric, commandBufferCount);
 
+	return vkQueueSubmit(queue, submitCount, submits, fence);
+}
 
+void Command::PipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages, VkDependencyFlags dependencyFlags,
+	uint32_t memoryBarrierCount, const VkMemoryBarrier* memoryBarriers, uint32_t bufferBarrierCount, const VkBufferMemoryBarrier* bufferBarriers,
+	uint32_t imageBarrierCount, const VkImageMemoryBarrier* imageBarriers)
+{
+	Metrics::Add(s_BarrierCallsMetric);
+	Metrics::Add(s_BarriersMetric, memoryBarrierCount + bufferBarrierCount + imageBarrierCount);
+
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, dependencyFlags, memoryBarrierCount, memoryBarriers, bufferBarrierCount, bufferBarriers,
+		imageBarrierCount, imageBarriers);
+}
@@ -12,5 +12,10 @@ public:
 
 	static VkCommandBuffer BeginSingleTimeCommands();
 	static void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
-	
+
+	//vkQueueSubmit and vkCmdPipelineBarrier, counted into the command metrics
+	static VkResult Submit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* submits, VkFence fence);
+	static void PipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages, VkDependencyFlags dependencyFlags,
+		uint32_t memoryBarrierCount, const VkMemoryBarrier* memoryBarriers, uint32_t bufferBarrierCount, const VkBufferMemoryBarrier* bufferBarriers,
+		uint32_t imageBarrierCount, const VkImageMemoryBarrier* imageBarriers);
 };
\ No newline at end of file
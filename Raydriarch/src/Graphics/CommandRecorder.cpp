@@ -0,0 +1,107 @@
+#include "raydpch.h"
+#include "CommandRecorder.h"
+
+#include "GpuProfiler.h"
+
+//Below this many draws per buffer the dispatch costs more than the recording it spreads out
+#define MIN_DRAWS_PER_WORKER 64
+
+CommandRecorder::CommandRecorder(RefPtr<Device> device, RefPtr<ThreadPool> workers, uint32_t frameCount)
+	:m_Device(device), m_Workers(workers), m_Frame(0)
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = *m_Device->GetQueueFamilies().Graphics.Index;
+
+	m_Pools.resize(frameCount);
+	for (auto& framePools : m_Pools) {
+		framePools.resize(m_Workers->GetThreadCount());
+		for (auto& pool : framePools) {
+			VkResult result = vkCreateCommandPool(m_Device->GetDeviceHandle(), &poolInfo, nullptr, &pool.Pool);
+			RAYD_VK_VALIDATE(result, "Failed to create worker command pool!");
+			pool.Used = 0;
+		}
+	}
+}
+
+CommandRecorder::~CommandRecorder()
+{
+	//Destroying a pool frees every buffer allocated from it
+	for (auto& framePools : m_Pools)
+		for (auto& pool : framePools)
+			vkDestroyCommandPool(m_Device->GetDeviceHandle(), pool.Pool, nullptr);
+}
+
+void CommandRecorder::BeginFrame(uint32_t frame)
+{
+	m_Frame = frame;
+	for (auto& pool : m_Pools[m_Frame]) {
+		vkResetCommandPool(m_Device->GetDeviceHandle(), pool.Pool, 0);
+		pool.Used = 0;
+	}
+}
+
+std::vector<VkCommandBuffer> CommandRecorder::Record(VkRenderPass renderPass, VkFramebuffer framebuffer, uint32_t drawCount, const RecordFn& record)
+{
+	if (drawCount == 0)
+		return {};
+
+	auto& framePools = m_Pools[m_Frame];
+	uint32_t chunkCount = std::min(static_cast<uint32_t>(framePools.size()), (drawCount + MIN_DRAWS_PER_WORKER - 1) / MIN_DRAWS_PER_WORKER);
+	uint32_t chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+
+	std::vector<VkCommandBuffer> recorded(chunkCount);
+
+	//Each chunk owns one pool, so no two threads ever touch the same pool
+	auto recordChunk = [&](uint32_t chunk) {
+		uint32_t first = chunk * chunkSize;
+		uint32_t count = std::min(chunkSize, drawCount - first);
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = framebuffer;
+		//Executed while the frame's statistics query is active
+		inheritanceInfo.pipelineStatistics = GpuProfiler::GetStatisticsFlags();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		VkCommandBuffer cbuff = Acquire(framePools[chunk]);
+		VkResult result = vkBeginCommandBuffer(cbuff, &beginInfo);
+		RAYD_VK_VALIDATE(result, "Failed to begin recording secondary command buffer!");
+		record(cbuff, first, count);
+		result = vkEndCommandBuffer(cbuff);
+		RAYD_VK_VALIDATE(result, "Failed to record secondary command buffer!");
+
+		recorded[chunk] = cbuff;
+	};
+
+	//Waits only on these chunks, not on whatever asset jobs are still running in the background
+	m_Workers->ParallelFor(chunkCount, recordChunk);
+
+	return recorded;
+}
+
+VkCommandBuffer CommandRecorder::Acquire(WorkerPool& pool)
+{
+	//Buffers survive a pool reset, so they are reused instead of reallocated every frame
+	if (pool.Used == pool.Buffers.size()) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = pool.Pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer cbuff;
+		VkResult result = vkAllocateCommandBuffers(m_Device->GetDeviceHandle(), &allocInfo, &cbuff);
+		RAYD_VK_VALIDATE(result, "Failed to allocate secondary command buffer!");
+		pool.Buffers.push_back(cbuff);
+	}
+
+	return pool.Buffers[pool.Used++];
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Device.h"
+#include "Core/ThreadPool.h"
+
+//Splits a draw list across worker threads that each record a secondary command buffer from their own pool
+class CommandRecorder {
+public:
+	//Records draws [first, first + count) into a secondary buffer that inherits the current render pass
+	using RecordFn = std::function<void(VkCommandBuffer cbuff, uint32_t first, uint32_t count)>;
+
+	CommandRecorder(RefPtr<Device> device, RefPtr<ThreadPool> workers, uint32_t frameCount);
+	~CommandRecorder();
+
+	//Resets every pool owned by the frame in one call; its previous submission must have completed
+	void BeginFrame(uint32_t frame);
+	std::vector<VkCommandBuffer> Record(VkRenderPass renderPass, VkFramebuffer framebuffer, uint32_t drawCount, const RecordFn& record);
+private:
+	struct WorkerPool {
+		VkCommandPool Pool;
+		std::vector<VkCommandBuffer> Buffers;
+		uint32_t Used;
+	};
+
+	VkCommandBuffer Acquire(WorkerPool& pool);
+private:
+	RefPtr<Device> m_Device;
+	RefPtr<ThreadPool> m_Workers;
+
+	//Indexed [frame][worker]
+	std::vector<std::vector<WorkerPool>> m_Pools;
+	uint32_t m_Frame;
+};
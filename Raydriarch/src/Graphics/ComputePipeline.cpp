@@ -0,0 +1,42 @@
+#include "raydpch.h"
+#include "ComputePipeline.h"
+
+ComputePipeline::ComputePipeline(RefPtr<Device> device, RefPtr<DescriptorSetLayout> descSetLayout,
+    const std::string& compShaderPath, const std::vector<VkPushConstantRange>& pushConstants)
+	:m_Device(device)
+{
+    Shader shader(m_Device, compShaderPath);
+    VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+    compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    compShaderStageInfo.module = shader.GetComputeShaderModule();
+    compShaderStageInfo.pName = "main";
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descSetLayout->GetHandle();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+
+    VkResult result = vkCreatePipelineLayout(m_Device->GetDeviceHandle(), &pipelineLayoutInfo, nullptr, &m_Layout);
+    RAYD_VK_VALIDATE(result, "Failed to create compute pipeline layout!");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = compShaderStageInfo;
+    pipelineInfo.layout = m_Layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    PipelineCache& cache = m_Device->GetPipelineCache();
+    auto start = std::chrono::high_resolution_clock::now();
+    result = vkCreateComputePipelines(m_Device->GetDeviceHandle(), cache.GetHandle(), 1, &pipelineInfo, nullptr, &m_Pipeline);
+    RAYD_VK_VALIDATE(result, "Failed to create compute pipeline!");
+    cache.RecordCreation(std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+}
+
+ComputePipeline::~ComputePipeline()
+{
+    vkDestroyPipeline(m_Device->GetDeviceHandle(), m_Pipeline, nullptr);
+    vkDestroyPipelineLayout(m_Device->GetDeviceHandle(), m_Layout, nullptr);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Device.h"
+#include "Shader.h"
+#include "Descriptor.h"
+
+class ComputePipeline {
+public:
+	ComputePipeline(RefPtr<Device> device, RefPtr<DescriptorSetLayout> descSetLayout,
+		const std::string& compShaderPath, const std::vector<VkPushConstantRange>& pushConstants);
+	~ComputePipeline();
+
+	inline VkPipeline& GetPipelineHandle() { return m_Pipeline; }
+	inline VkPipelineLayout& GetLayoutHandle() { return m_Layout; }
+
+private:
+	RefPtr<Device> m_Device;
+
+	VkPipeline m_Pipeline;
+	VkPipelineLayout m_Layout;
+};
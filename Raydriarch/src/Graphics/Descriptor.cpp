@@ -1,6 +1,10 @@
 #include "raydpch.h"
 #include "Descriptor.h"
 
+#include "Core/Metrics.h"
+
+static const MetricID s_DescriptorSetsMetric = Metrics::Register("descriptor.sets_allocated", MetricKind::Counter);
+
 DescriptorPool::DescriptorPool(RefPtr<Device> device, uint32_t numSwapcbainImages, std::vector<VkDescriptorPoolSize>& sizes)
 	:m_Device(device)
 {
@@ -18,6 +22,22 @@ DescriptorPool::~DescriptorPool()
 	vkDestroyDescriptorPool(m_Device->GetDeviceHandle(), m_Pool, nullptr);
 }
 
+std::vector<VkDescriptorSet> DescriptorPool::Allocate(VkDescriptorSetLayout layout, uint32_t count)
+{
+	std::vector<VkDescriptorSetLayout> layouts(count, layout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_Pool;
+	allocInfo.descriptorSetCount = count;
+	allocInfo.pSetLayouts = layouts.data();
+
+	std::vector<VkDescriptorSet> sets(count);
+	VkResult result = vkAllocateDescriptorSets(m_Device->GetDeviceHandle(), &allocInfo, sets.data());
+	RAYD_VK_VALIDATE(result, "Failed to allocate descriptor sets!");
+	Metrics::Add(s_DescriptorSetsMetric, count);
+	return sets;
+}
+
 DescriptorSetLayout::DescriptorSetLayout(RefPtr<Device> device, std::vector<VkDescriptorSetLayoutBinding>& bindings)
 	:m_Device(device)
 {
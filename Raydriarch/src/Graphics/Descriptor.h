@@ -21,6 +21,8 @@ public:
 	DescriptorPool(RefPtr<Device> device, uint32_t numSwapcbainImages, std::vector<VkDescriptorPoolSize>& sizes);
 	~DescriptorPool();
 
+	std::vector<VkDescriptorSet> Allocate(VkDescriptorSetLayout layout, uint32_t count);
+
 	inline const VkDescriptorPool& GetPoolHandle() const { return m_Pool; }
 private:
 	RefPtr<Device> m_Device;
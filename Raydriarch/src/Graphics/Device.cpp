@@ -5,15 +5,26 @@
 
 Device::Device(VkInstance& instance, ScopedPtr<Surface>& surface, VkPhysicalDeviceFeatures& desiredFeatures)
 {
-	m_PhysicalDevice = FindPhysicalDevice(instance, surface->GetSurfaceHandle(), desiredFeatures);
+	VkSurfaceKHR surfaceHandle = surface ? surface->GetSurfaceHandle() : VK_NULL_HANDLE;
+	if (surfaceHandle)
+		m_Extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+	m_PhysicalDevice = FindPhysicalDevice(instance, surfaceHandle, desiredFeatures);
+	vkGetPhysicalDeviceProperties(m_PhysicalDevice, &m_Properties);
 	m_Device = FindDevice(instance, desiredFeatures);
 
 	vkGetDeviceQueue(m_Device, *m_QueueFamilies.Graphics.Index, 0, &m_QueueFamilies.Graphics.Queue);
 	vkGetDeviceQueue(m_Device, *m_QueueFamilies.Present.Index, 0, &m_QueueFamilies.Present.Queue);
+	vkGetDeviceQueue(m_Device, *m_QueueFamilies.Transfer.Index, 0, &m_QueueFamilies.Transfer.Queue);
+
+	m_Allocator = MakeScopedPtr<MemoryAllocator>(m_PhysicalDevice, m_Device);
+	m_PipelineCache = MakeScopedPtr<PipelineCache>(m_Device, m_Properties);
 }
 
 Device::~Device()
 {
+	m_PipelineCache.reset();
+	m_Allocator.reset();
 	vkDestroyDevice(m_Device, nullptr);
 }
 
@@ -47,19 +58,66 @@ VkPhysicalDevice Device::FindPhysicalDevice(VkInstance& instance, VkSurfaceKHR&
 	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
 	vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
 
+	VkPhysicalDevice bestDevice = VK_NULL_HANDLE;
+	uint32_t bestScore = 0;
 	for (auto& physicalDevice : physicalDevices) {
-		VkPhysicalDeviceProperties physicalDeviceProperties;
-		vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
-
-		if (physicalDeviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-			if (FeaturesSupported(physicalDevice, desiredFeatures) && ExtensionsSupported(physicalDevice) && SwapChainSupported(physicalDevice, surface)) {
-				m_QueueFamilies = FindQueueFamilies(physicalDevice, surface);
-				return physicalDevice;
-			}
-		}	
+		uint32_t score = ScorePhysicalDevice(physicalDevice, surface, desiredFeatures);
+		if (score > bestScore) {
+			bestDevice = physicalDevice;
+			bestScore = score;
+		}
 	}
 
-	RAYD_ERROR("Failed to find physical device with given features!");
+	RAYD_ASSERT(bestDevice, "Failed to find physical device with given features!");
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(bestDevice, &physicalDeviceProperties);
+	RAYD_INFO("Using {0}{1}", physicalDeviceProperties.deviceName, surface ? "" : " (headless)");
+
+	//Scoring fills the swap chain details for every candidate, so refresh them for the one picked
+	if (surface)
+		SwapChainSupported(bestDevice, surface);
+	m_QueueFamilies = FindQueueFamilies(bestDevice, surface);
+	return bestDevice;
+}
+
+uint32_t Device::ScorePhysicalDevice(VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkPhysicalDeviceFeatures& desiredFeatures)
+{
+	if (!FeaturesSupported(physicalDevice, desiredFeatures) || !ExtensionsSupported(physicalDevice))
+		return 0;
+	if (surface && !SwapChainSupported(physicalDevice, surface))
+		return 0;
+
+	//Every candidate needs a graphics family, and one that can present when there is a surface
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+	bool graphics = false, present = !surface;
+	for (uint32_t i = 0; i < queueFamilyCount; i++) {
+		graphics |= (queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		if (surface) {
+			VkBool32 presentSupported = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupported);
+			present |= presentSupported == VK_TRUE;
+		}
+	}
+	if (!graphics || !present)
+		return 0;
+
+	//CPU implementations such as lavapipe still qualify, they only lose to real hardware
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	switch (physicalDeviceProperties.deviceType) {
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return 4;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return 3;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return 2;
+	default:
+		return 1;
+	}
 }
 
 bool Device::FeaturesSupported(VkPhysicalDevice& physicalDevice, VkPhysicalDeviceFeatures& desiredFeatures)
@@ -130,25 +188,23 @@ bool Device::SwapChainSupported(VkPhysicalDevice& physicalDevice, VkSurfaceKHR&
 
 VkDevice Device::FindDevice(VkInstance& instance, VkPhysicalDeviceFeatures& desiredFeatures)
 {
-	const uint32_t numQueueFamilies = sizeof(QueueFamilies) / sizeof(QueueFamily);
-	std::array<VkDeviceQueueCreateInfo, numQueueFamilies> queueInfos;
-	uint32_t queueFamilyIndices[numQueueFamilies] = { *m_QueueFamilies.Graphics.Index, *m_QueueFamilies.Present.Index };
+	std::set<uint32_t> uniqueFamilies = { *m_QueueFamilies.Graphics.Index, *m_QueueFamilies.Present.Index, *m_QueueFamilies.Transfer.Index };
+	std::vector<VkDeviceQueueCreateInfo> queueInfos;
 
 	float queuePriority = 1.0f;
-	for (uint32_t i = 0; i < queueInfos.size(); i++) {
-		queueInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueInfos[i].queueFamilyIndex = queueFamilyIndices[i];
-		queueInfos[i].queueCount = 1;
-		queueInfos[i].pQueuePriorities = &queuePriority;
-
-		queueInfos[i].pNext = nullptr;
-		queueInfos[i].flags = NULL;
+	for (uint32_t family : uniqueFamilies) {
+		VkDeviceQueueCreateInfo queueInfo{};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = family;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &queuePriority;
+		queueInfos.push_back(queueInfo);
 	}
 	
 	VkDeviceCreateInfo deviceInfo{};
 	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceInfo.pQueueCreateInfos = queueInfos.data();
-	deviceInfo.queueCreateInfoCount = queueInfos.size();
+	deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
 	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(m_Extensions.size());
 	deviceInfo.ppEnabledExtensionNames = m_Extensions.data();
 
@@ -156,14 +212,45 @@ VkDevice Device::FindDevice(VkInstance& instance, VkPhysicalDeviceFeatures& desi
 	deviceInfo.enabledLayerCount = 0;
 	deviceInfo.ppEnabledLayerNames = nullptr;
 
-	deviceInfo.pEnabledFeatures = &desiredFeatures;
+	//Optional core features are enabled on top of the required ones when the device has them
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+	VkPhysicalDeviceFeatures enabledFeatures = desiredFeatures;
+	m_TextureCompressionBC = supportedFeatures.textureCompressionBC;
+	enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	m_MultiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	m_DrawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	m_PipelineStatistics = supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries;
+	enabledFeatures.pipelineStatisticsQuery = m_PipelineStatistics;
+	enabledFeatures.inheritedQueries = m_PipelineStatistics;
+	deviceInfo.pEnabledFeatures = &enabledFeatures;
+
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	if (m_Properties.apiVersion >= VK_API_VERSION_1_2) {
+		VkPhysicalDeviceFeatures2 supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &features12;
+		vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &supported);
+
+		//Only enable what the renderer uses out of everything the device reports
+		m_DrawIndirectCount = features12.drawIndirectCount;
+		m_HostQueryReset = features12.hostQueryReset;
+		features12 = {};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.drawIndirectCount = m_DrawIndirectCount;
+		features12.hostQueryReset = m_HostQueryReset;
+		deviceInfo.pNext = &features12;
+	}
 
 	VkDevice device;
 	RAYD_VK_VALIDATE(vkCreateDevice(m_PhysicalDevice, &deviceInfo, nullptr, &device), "Failed to create device!");
 	return device;
 }
 
-QueueFamilies& Device::FindQueueFamilies(VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface)
+QueueFamilies Device::FindQueueFamilies(VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface)
 {
 	uint32_t queueFamilyCount = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
@@ -172,28 +259,36 @@ QueueFamilies& Device::FindQueueFamilies(VkPhysicalDevice& physicalDevice, VkSur
 	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
 
 	QueueFamilies queueFamilies{};
-	bool complete = false;
 	for (uint32_t i = 0; i < queueFamilyProperties.size(); i++) {
+		VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
 
-		if (queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+		if ((flags & VK_QUEUE_GRAPHICS_BIT) && !queueFamilies.Graphics.Index) {
 			QueueFamily graphicsQueueFamily{ i, queueFamilyProperties[i] };
 			queueFamilies.Graphics = graphicsQueueFamily;
-			continue;
+		}
+
+		//A family with transfer but no graphics/compute support maps to the copy engine
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && !queueFamilies.Transfer.Index) {
+			QueueFamily transferQueueFamily{ i, queueFamilyProperties[i] };
+			queueFamilies.Transfer = transferQueueFamily;
 		}
 
 		VkBool32 presentSupported = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupported);
-		if (presentSupported) {
+		if (surface)
+			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupported);
+		if (presentSupported && (!queueFamilies.Present.Index || queueFamilies.Graphics.Index == i)) {
 			QueueFamily presentQueueFamily{ i, queueFamilyProperties[i] };
 			queueFamilies.Present = presentQueueFamily;
 		}
-
-		if (queueFamilies.IsComplete()) {
-			complete = true;
-			break;
-		}
 	}
 
+	if (!queueFamilies.Transfer.Index)
+		queueFamilies.Transfer = queueFamilies.Graphics;
+	//Nothing is presented without a surface, the family only has to exist
+	if (!surface)
+		queueFamilies.Present = queueFamilies.Graphics;
+
+	bool complete = queueFamilies.IsComplete();
 	RAYD_ASSERT(complete, "Failed to find necessary queue families!");
 
 	return queueFamilies;
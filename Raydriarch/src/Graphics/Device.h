@@ -1,6 +1,8 @@
 #pragma once
 
 #include "GraphicsCore.h"
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
 
 struct QueueFamily {
 	std::optional<uint32_t> Index;
@@ -11,6 +13,8 @@ struct QueueFamily {
 struct QueueFamilies {
 	QueueFamily Graphics;
 	QueueFamily Present;
+	//Falls back to the graphics family when the device has no dedicated transfer family
+	QueueFamily Transfer;
 
 	inline bool IsComplete() {
 		return Graphics.Index && Present.Index;
@@ -25,36 +29,65 @@ struct SwapChainSupportDetails {
 
 class Device {
 public:
+	//Without a surface the device is headless: no swap chain extension, and presents share the graphics queue
 	Device(VkInstance& instance, ScopedPtr<class Surface>& surface, VkPhysicalDeviceFeatures& desiredFeatures);
 	~Device();
 
 	inline const VkPhysicalDevice& GetPhysicalDeviceHandle() const { return m_PhysicalDevice; }
 	inline const VkDevice& GetDeviceHandle() const { return m_Device; }
+	inline const VkPhysicalDeviceProperties& GetProperties() const { return m_Properties; }
+	//Core in Vulkan 1.2 but still an optional feature, so indirect paths must check before using vkCmdDrawIndexedIndirectCount
+	inline bool SupportsDrawIndirectCount() const { return m_DrawIndirectCount; }
+	//Without it an indirect call can only draw one command, so the indirect paths issue one call per command instead
+	inline bool SupportsMultiDrawIndirect() const { return m_MultiDrawIndirect; }
+	//The GPU-driven paths pick each object's transform through the command's firstInstance, so they need this
+	inline bool SupportsDrawIndirectFirstInstance() const { return m_DrawIndirectFirstInstance; }
+	//Enabled whenever the device has it, so baked BC textures can be sampled; other devices fall back to RGBA8
+	inline bool SupportsTextureCompressionBC() const { return m_TextureCompressionBC; }
+	//Lets the GPU profiler reset its queries from the host, without recording a reset ahead of every use
+	inline bool SupportsHostQueryReset() const { return m_HostQueryReset; }
+	//Pipeline statistics queries, inherited by secondary command buffers so they can stay active across the frame
+	inline bool SupportsPipelineStatistics() const { return m_PipelineStatistics; }
 
 	void UpdateSwapChainSupportDetails(VkSurfaceKHR& surface);
 	inline const SwapChainSupportDetails& GetSwapChainSupportDetails() const { return m_SwapChainSupportDetails; }
 
 	inline const QueueFamilies& GetQueueFamilies() const { return m_QueueFamilies; }
+	inline bool HasDedicatedTransferQueue() const { return *m_QueueFamilies.Transfer.Index != *m_QueueFamilies.Graphics.Index; }
+	inline MemoryAllocator& GetAllocator() { return *m_Allocator; }
+	//Starts empty; Graphics loads the copy saved by the previous run before creating any pipeline
+	inline PipelineCache& GetPipelineCache() { return *m_PipelineCache; }
 
 	inline void Join() const { vkDeviceWaitIdle(m_Device); }
 private:
 	VkPhysicalDevice FindPhysicalDevice(VkInstance& instance, VkSurfaceKHR& surface, VkPhysicalDeviceFeatures& desiredFeatures);
+	//0 when the device cannot run the renderer at all, otherwise higher for the devices expected to be faster
+	uint32_t ScorePhysicalDevice(VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkPhysicalDeviceFeatures& desiredFeatures);
 	bool ExtensionsSupported(VkPhysicalDevice& physicalDevice);
 	bool FeaturesSupported(VkPhysicalDevice& physicalDevice, VkPhysicalDeviceFeatures& desiredFeatures);
 	bool SwapChainSupported(VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface);
 
 	VkDevice FindDevice(VkInstance& instance, VkPhysicalDeviceFeatures& desiredFeatures);
 
-	QueueFamilies& FindQueueFamilies(VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface);
+	QueueFamilies FindQueueFamilies(VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface);
 private:
 	VkPhysicalDevice m_PhysicalDevice;
+	VkPhysicalDeviceProperties m_Properties;
 	VkDevice m_Device;
+	bool m_DrawIndirectCount = false;
+	bool m_MultiDrawIndirect = false;
+	bool m_DrawIndirectFirstInstance = false;
+	bool m_TextureCompressionBC = false;
+	bool m_HostQueryReset = false;
+	bool m_PipelineStatistics = false;
 
-	const std::vector<const char*> m_Extensions = {
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+	//Swap chain extension only when there is a surface to present to
+	std::vector<const char*> m_Extensions;
 
 	SwapChainSupportDetails m_SwapChainSupportDetails;
 
 	QueueFamilies m_QueueFamilies;
+
+	ScopedPtr<MemoryAllocator> m_Allocator;
+	ScopedPtr<PipelineCache> m_PipelineCache;
 };
\ No newline at end of file
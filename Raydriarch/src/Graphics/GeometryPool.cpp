@@ -0,0 +1,82 @@
+#include "raydpch.h"
+#include "GeometryPool.h"
+
+GeometryPool::GeometryPool(RefPtr<Device> device, uint32_t vertexStride, uint32_t maxVertices, uint32_t maxIndices, uint32_t maxMeshes, uint32_t maxMeshlets)
+	:m_Device(device), m_VertexStride(vertexStride), m_MaxVertices(maxVertices), m_MaxIndices(maxIndices), m_MaxMeshes(maxMeshes), m_MaxMeshlets(maxMeshlets),
+	m_VertexCount(0), m_IndexCount(0), m_MeshletCount(0), m_LodCount(0)
+{
+	m_Vertices = MakeScopedPtr<DeviceBuffer>(m_Device, static_cast<VkDeviceSize>(vertexStride) * maxVertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	//Indices are also read as storage, by the meshlet pass that compacts the visible clusters
+	m_Indices = MakeScopedPtr<DeviceBuffer>(m_Device, static_cast<VkDeviceSize>(sizeof(uint32_t)) * maxIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_MeshBuffer = MakeScopedPtr<DeviceBuffer>(m_Device, static_cast<VkDeviceSize>(sizeof(MeshRecord)) * maxMeshes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_MeshletBuffer = MakeScopedPtr<DeviceBuffer>(m_Device, static_cast<VkDeviceSize>(sizeof(Meshlet)) * maxMeshlets, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_LodBuffer = MakeScopedPtr<DeviceBuffer>(m_Device, static_cast<VkDeviceSize>(sizeof(MeshLod)) * maxMeshes * MESH_LOD_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+}
+
+uint32_t GeometryPool::AddMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const MeshBounds& bounds,
+	const Meshlet* meshlets, uint32_t meshletCount, const MeshLod* lods, uint32_t lodCount)
+{
+	RAYD_ASSERT(CanFit(vertexCount, indexCount, meshletCount, lodCount), "Geometry pool is out of space!");
+
+	//Indices stay mesh-relative; VertexOffset rebases them at draw time
+	MeshRecord record{};
+	record.FirstIndex = m_IndexCount;
+	record.VertexOffset = static_cast<int32_t>(m_VertexCount);
+	record.Sphere = glm::vec4(bounds.Center, bounds.Radius);
+	record.FirstMeshlet = m_MeshletCount;
+
+	std::vector<MeshLod> rebasedLods(lods, lods + lodCount);
+	if (rebasedLods.empty())
+		rebasedLods.push_back({ 0, indexCount, 0, meshletCount, 0.0f });
+	for (auto& lod : rebasedLods) {
+		lod.FirstIndex += m_IndexCount;
+		lod.FirstMeshlet += m_MeshletCount;
+	}
+	record.IndexCount = rebasedLods[0].IndexCount;
+	record.MeshletCount = rebasedLods[0].MeshletCount;
+	record.FirstLod = m_LodCount;
+	record.LodCount = static_cast<uint32_t>(rebasedLods.size());
+	m_LodBuffer->Write(static_cast<VkDeviceSize>(m_LodCount) * sizeof(MeshLod), rebasedLods.size() * sizeof(MeshLod), rebasedLods.data());
+
+	m_Vertices->Write(static_cast<VkDeviceSize>(m_VertexCount) * m_VertexStride, static_cast<VkDeviceSize>(vertexCount) * m_VertexStride, vertices);
+	m_Indices->Write(static_cast<VkDeviceSize>(m_IndexCount) * sizeof(uint32_t), static_cast<VkDeviceSize>(indexCount) * sizeof(uint32_t), indices);
+
+	if (meshletCount > 0) {
+		std::vector<Meshlet> rebased(meshlets, meshlets + meshletCount);
+		for (auto& meshlet : rebased)
+			meshlet.FirstIndex += m_IndexCount;
+		m_MeshletBuffer->Write(static_cast<VkDeviceSize>(m_MeshletCount) * sizeof(Meshlet), static_cast<VkDeviceSize>(meshletCount) * sizeof(Meshlet), rebased.data());
+	}
+
+	uint32_t mesh = static_cast<uint32_t>(m_Meshes.size());
+	m_MeshBuffer->Write(mesh * sizeof(MeshRecord), sizeof(MeshRecord), &record);
+	m_Meshes.push_back(record);
+
+	m_VertexCount += vertexCount;
+	m_IndexCount += indexCount;
+	m_MeshletCount += meshletCount;
+	m_LodCount += record.LodCount;
+	return mesh;
+}
+
+bool GeometryPool::CanFit(uint32_t vertexCount, uint32_t indexCount, uint32_t meshletCount, uint32_t lodCount) const
+{
+	//A mesh without LODs still takes one level
+	uint32_t levels = std::max(lodCount, 1u);
+	return m_Meshes.size() < m_MaxMeshes && lodCount <= MESH_LOD_COUNT &&
+		vertexCount <= m_MaxVertices - m_VertexCount && indexCount <= m_MaxIndices - m_IndexCount &&
+		meshletCount <= m_MaxMeshlets - m_MeshletCount && levels <= m_MaxMeshes * MESH_LOD_COUNT - m_LodCount;
+}
+
+void GeometryPool::Bind(VkCommandBuffer& cmdBuffer)
+{
+	const VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &m_Vertices->GetBufferHandle(), &offset);
+	vkCmdBindIndexBuffer(cmdBuffer, m_Indices->GetBufferHandle(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryPool::BindVertices(VkCommandBuffer& cmdBuffer)
+{
+	const VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &m_Vertices->GetBufferHandle(), &offset);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Device.h"
+#include "Buffer.h"
+#include "Asset/MeshData.h"
+#include "Asset/MeshletBuilder.h"
+#include "Asset/MeshSimplifier.h"
+
+//Laid out to match MeshData in Cull.comp and Meshlet.comp; the index and meshlet ranges are those of the full-resolution LOD
+struct MeshRecord {
+	uint32_t IndexCount;
+	uint32_t FirstIndex;
+	int32_t VertexOffset;
+	uint32_t FirstMeshlet;
+	glm::vec4 Sphere;
+	uint32_t MeshletCount;
+	uint32_t FirstLod;
+	uint32_t LodCount;
+	uint32_t Padding;
+};
+
+//Vertex and index mega-buffers every model sub-allocates from, so one bind serves every draw
+class GeometryPool {
+public:
+	GeometryPool(RefPtr<Device> device, uint32_t vertexStride, uint32_t maxVertices, uint32_t maxIndices, uint32_t maxMeshes, uint32_t maxMeshlets);
+
+	//Bounds, meshlets and LOD errors are in the space of the stored vertices; meshlet and LOD ranges are relative to the mesh.
+	//Without LODs the whole index range is the only level
+	uint32_t AddMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const MeshBounds& bounds,
+		const Meshlet* meshlets = nullptr, uint32_t meshletCount = 0, const MeshLod* lods = nullptr, uint32_t lodCount = 0);
+	//Whether AddMesh has room for a mesh of these sizes; checked in every build, since AddMesh copies past the buffers otherwise
+	bool CanFit(uint32_t vertexCount, uint32_t indexCount, uint32_t meshletCount, uint32_t lodCount) const;
+	void Bind(VkCommandBuffer& cmdBuffer);
+	//Binds only the vertices, for draws that read a different index buffer
+	void BindVertices(VkCommandBuffer& cmdBuffer);
+
+	inline const MeshRecord& GetMesh(uint32_t mesh) const { return m_Meshes[mesh]; }
+	inline uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_Meshes.size()); }
+	//Table of every MeshRecord, read by the culling shader to build draw commands
+	inline const DeviceBuffer& GetMeshBuffer() const { return *m_MeshBuffer; }
+	//Every mesh's meshlets, ranges rebased onto the pooled index buffer
+	inline const DeviceBuffer& GetMeshletBuffer() const { return *m_MeshletBuffer; }
+	inline const DeviceBuffer& GetIndexBuffer() const { return *m_Indices; }
+	//Every mesh's LODs, ranges rebased like the meshlets
+	inline const DeviceBuffer& GetLodBuffer() const { return *m_LodBuffer; }
+	inline uint32_t GetMeshletCount() const { return m_MeshletCount; }
+private:
+	RefPtr<Device> m_Device;
+
+	ScopedPtr<DeviceBuffer> m_Vertices;
+	ScopedPtr<DeviceBuffer> m_Indices;
+	ScopedPtr<DeviceBuffer> m_MeshBuffer;
+	ScopedPtr<DeviceBuffer> m_MeshletBuffer;
+	ScopedPtr<DeviceBuffer> m_LodBuffer;
+
+	uint32_t m_VertexStride;
+	uint32_t m_MaxVertices;
+	uint32_t m_MaxIndices;
+	uint32_t m_MaxMeshes;
+	uint32_t m_MaxMeshlets;
+	uint32_t m_VertexCount;
+	uint32_t m_IndexCount;
+	uint32_t m_MeshletCount;
+	uint32_t m_LodCount;
+	std::vector<MeshRecord> m_Meshes;
+};
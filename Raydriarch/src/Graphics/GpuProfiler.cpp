@@ -0,0 +1,301 @@
+#include "raydpch.h"
+#include "GpuProfiler.h"
+
+#include "Core/Metrics.h"
+
+#define GPU_PROFILER_MAX_SCOPES 256
+//Handles pack the slot a scope was opened in above the index of its query pair
+#define GPU_SCOPE_INDEX_BITS 16
+#define GPU_SCOPE_UNTIMED UINT64_MAX
+//Ascending bit order, which is the order of GpuPipelineStatistics
+#define GPU_STATISTICS_FLAGS (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT)
+#define GPU_STATISTICS_COUNT 7
+
+struct ScopeRecord {
+	const char* Name;
+	//Frame the scope was opened in
+	uint64_t Frame;
+	bool Closed;
+};
+
+struct FrameQueries {
+	VkQueryPool Pool = VK_NULL_HANDLE;
+	//Frame the slot is recording or last recorded
+	uint64_t Frame = 0;
+	//Indexed by query pair
+	std::vector<ScopeRecord> Scopes;
+	//Pairs of scopes not collected yet, in the order they were opened. A scope submitted after its frame, such as an upload
+	//batch flushed frames later, can still be executing when the slot comes around again; its pair is neither reset nor
+	//handed out until its timestamps are available.
+	std::vector<uint32_t> Used;
+	std::vector<uint32_t> Free;
+
+	VkQueryPool StatisticsPool = VK_NULL_HANDLE;
+	bool StatisticsBegun = false;
+	bool StatisticsEnded = false;
+};
+
+static struct GpuProfilerObjects {
+	RefPtr<Device> GPU;
+	bool Timing = false;
+	uint64_t TimestampMask = 0;
+	bool Statistics = false;
+	std::array<MetricID, GPU_STATISTICS_COUNT> StatisticsMetrics;
+	PFN_vkCmdBeginDebugUtilsLabelEXT BeginLabel = nullptr;
+	PFN_vkCmdEndDebugUtilsLabelEXT EndLabel = nullptr;
+
+	std::vector<FrameQueries> Frames;
+	uint64_t NextFrame = 0;
+	//Slot being recorded, or nullptr between EndFrame and the next BeginFrame
+	FrameQueries* Recording = nullptr;
+	std::mutex Lock;
+
+	GpuFrameTimings LastFrame;
+	std::vector<uint64_t> Results;
+}*s_Objects = new GpuProfilerObjects;
+
+void GpuProfiler::Init(RefPtr<Device> device, VkInstance instance, uint32_t framesInFlight)
+{
+	s_Objects->GPU = device;
+
+	//Null unless the instance enabled VK_EXT_debug_utils
+	s_Objects->BeginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetInstanceProcAddr(instance, "vkCmdBeginDebugUtilsLabelEXT");
+	s_Objects->EndLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetInstanceProcAddr(instance, "vkCmdEndDebugUtilsLabelEXT");
+
+	uint32_t validBits = device->GetQueueFamilies().Graphics.Properties.timestampValidBits;
+	s_Objects->Timing = validBits > 0 && device->SupportsHostQueryReset();
+	s_Objects->TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	if (!s_Objects->Timing)
+		RAYD_WARN("GPU timestamps are not supported on this device, GPU scopes are labelled but not timed");
+
+	s_Objects->Frames.resize(framesInFlight);
+
+	s_Objects->Statistics = device->SupportsPipelineStatistics() && device->SupportsHostQueryReset();
+	if (s_Objects->Statistics) {
+		const char* names[GPU_STATISTICS_COUNT] = { "gpu.input_vertices", "gpu.input_primitives", "gpu.vertex_invocations", "gpu.clipping_invocations",
+			"gpu.clipping_primitives", "gpu.fragment_invocations", "gpu.compute_invocations" };
+		for (uint32_t i = 0; i < GPU_STATISTICS_COUNT; i++)
+			s_Objects->StatisticsMetrics[i] = Metrics::Register(names[i], MetricKind::Counter);
+
+		for (auto& frame : s_Objects->Frames) {
+			VkQueryPoolCreateInfo queryPoolInfo{};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			queryPoolInfo.queryCount = 1;
+			queryPoolInfo.pipelineStatistics = GPU_STATISTICS_FLAGS;
+			VkResult result = vkCreateQueryPool(device->GetDeviceHandle(), &queryPoolInfo, nullptr, &frame.StatisticsPool);
+			RAYD_VK_VALIDATE(result, "Failed to create pipeline statistics query pool!");
+			vkResetQueryPool(device->GetDeviceHandle(), frame.StatisticsPool, 0, 1);
+		}
+	}
+	else
+		RAYD_WARN("Pipeline statistics queries are not supported on this device");
+
+	if (!s_Objects->Timing)
+		return;
+
+	for (auto& frame : s_Objects->Frames) {
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2 * GPU_PROFILER_MAX_SCOPES;
+		VkResult result = vkCreateQueryPool(device->GetDeviceHandle(), &queryPoolInfo, nullptr, &frame.Pool);
+		RAYD_VK_VALIDATE(result, "Failed to create timestamp query pool!");
+		//Queries have to be reset before their first use
+		vkResetQueryPool(device->GetDeviceHandle(), frame.Pool, 0, 2 * GPU_PROFILER_MAX_SCOPES);
+
+		frame.Scopes.resize(GPU_PROFILER_MAX_SCOPES);
+		for (uint32_t i = GPU_PROFILER_MAX_SCOPES; i > 0; i--)
+			frame.Free.push_back(i - 1);
+	}
+	s_Objects->Results.resize(4 * GPU_PROFILER_MAX_SCOPES);
+}
+
+void GpuProfiler::Shutdown()
+{
+	for (auto& frame : s_Objects->Frames) {
+		if (frame.Pool)
+			vkDestroyQueryPool(s_Objects->GPU->GetDeviceHandle(), frame.Pool, nullptr);
+		if (frame.StatisticsPool)
+			vkDestroyQueryPool(s_Objects->GPU->GetDeviceHandle(), frame.StatisticsPool, nullptr);
+	}
+
+	delete s_Objects;
+}
+
+void GpuProfiler::BeginFrame(uint32_t slot)
+{
+	FrameQueries& frame = s_Objects->Frames[slot];
+	std::lock_guard<std::mutex> lock(s_Objects->Lock);
+
+	//Only a slot that recorded something replaces the results of the last one
+	bool recorded = frame.StatisticsEnded;
+	for (uint32_t index : frame.Used)
+		recorded |= frame.Scopes[index].Frame == frame.Frame;
+	if (recorded) {
+		s_Objects->LastFrame.Frame = frame.Frame;
+		s_Objects->LastFrame.Scopes.clear();
+		s_Objects->LastFrame.HasStatistics = false;
+	}
+
+	if (s_Objects->Timing && !frame.Used.empty()) {
+		//Availability is asked for alongside every value, so scopes still running are skipped instead of read as garbage
+		uint32_t queryCount = 2 * (*std::max_element(frame.Used.begin(), frame.Used.end()) + 1);
+		VkResult result = vkGetQueryPoolResults(s_Objects->GPU->GetDeviceHandle(), frame.Pool, 0, queryCount, queryCount * 2 * sizeof(uint64_t),
+			s_Objects->Results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		float period = s_Objects->GPU->GetProperties().limits.timestampPeriod;
+		size_t pending = 0;
+		for (uint32_t index : frame.Used) {
+			const ScopeRecord& scope = frame.Scopes[index];
+			const uint64_t* begin = &s_Objects->Results[4 * index];
+			const uint64_t* end = &s_Objects->Results[4 * index + 2];
+			if ((result != VK_SUCCESS && result != VK_NOT_READY) || !scope.Closed || !begin[1] || !end[1]) {
+				frame.Used[pending++] = index;
+				continue;
+			}
+
+			//Scopes that finished after their own frame was collected are recycled without being reported
+			if (scope.Frame == frame.Frame) {
+				uint64_t ticks = (end[0] - begin[0]) & s_Objects->TimestampMask;
+				s_Objects->LastFrame.Scopes.push_back({ scope.Name, static_cast<float>(ticks * period / 1e6) });
+			}
+			vkResetQueryPool(s_Objects->GPU->GetDeviceHandle(), frame.Pool, 2 * index, 2);
+			frame.Free.push_back(index);
+		}
+		frame.Used.resize(pending);
+	}
+
+	if (frame.StatisticsEnded) {
+		std::array<uint64_t, GPU_STATISTICS_COUNT + 1> values{};
+		VkResult result = vkGetQueryPoolResults(s_Objects->GPU->GetDeviceHandle(), frame.StatisticsPool, 0, 1, sizeof(values), values.data(), sizeof(values),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		s_Objects->LastFrame.HasStatistics = (result == VK_SUCCESS || result == VK_NOT_READY) && values[GPU_STATISTICS_COUNT];
+		if (s_Objects->LastFrame.HasStatistics) {
+			//Results come back in the bit order of GPU_STATISTICS_FLAGS
+			GpuPipelineStatistics& statistics = s_Objects->LastFrame.Statistics;
+			statistics.InputVertices = values[0];
+			statistics.InputPrimitives = values[1];
+			statistics.VertexInvocations = values[2];
+			statistics.ClippingInvocations = values[3];
+			statistics.ClippingPrimitives = values[4];
+			statistics.FragmentInvocations = values[5];
+			statistics.ComputeInvocations = values[6];
+			for (uint32_t i = 0; i < GPU_STATISTICS_COUNT; i++)
+				Metrics::Add(s_Objects->StatisticsMetrics[i], static_cast<int64_t>(values[i]));
+		}
+	}
+	if (frame.StatisticsBegun)
+		vkResetQueryPool(s_Objects->GPU->GetDeviceHandle(), frame.StatisticsPool, 0, 1);
+	frame.StatisticsBegun = false;
+	frame.StatisticsEnded = false;
+
+	frame.Frame = s_Objects->NextFrame++;
+	s_Objects->Recording = &frame;
+}
+
+void GpuProfiler::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(s_Objects->Lock);
+	s_Objects->Recording = nullptr;
+}
+
+uint64_t GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (s_Objects->BeginLabel) {
+		VkDebugUtilsLabelEXT label{};
+		label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+		label.pLabelName = name;
+		s_Objects->BeginLabel(commandBuffer, &label);
+	}
+
+	if (!s_Objects->Timing)
+		return GPU_SCOPE_UNTIMED;
+
+	uint32_t index;
+	FrameQueries* frame;
+	{
+		std::lock_guard<std::mutex> lock(s_Objects->Lock);
+		frame = s_Objects->Recording;
+		if (!frame || frame->Free.empty())
+			return GPU_SCOPE_UNTIMED;
+
+		index = frame->Free.back();
+		frame->Free.pop_back();
+		frame->Scopes[index] = { name, frame->Frame, false };
+		frame->Used.push_back(index);
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame->Pool, 2 * index);
+	uint64_t slot = static_cast<uint64_t>(frame - s_Objects->Frames.data());
+	return (slot << GPU_SCOPE_INDEX_BITS) | index;
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint64_t scope)
+{
+	if (s_Objects->EndLabel)
+		s_Objects->EndLabel(commandBuffer);
+
+	if (scope == GPU_SCOPE_UNTIMED)
+		return;
+
+	//The pair stays reserved until the scope is closed and has executed, however many frames that takes
+	FrameQueries& frame = s_Objects->Frames[scope >> GPU_SCOPE_INDEX_BITS];
+	uint32_t index = static_cast<uint32_t>(scope & ((1ull << GPU_SCOPE_INDEX_BITS) - 1));
+	{
+		std::lock_guard<std::mutex> lock(s_Objects->Lock);
+		frame.Scopes[index].Closed = true;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.Pool, 2 * index + 1);
+}
+
+void GpuProfiler::BeginStatistics(VkCommandBuffer commandBuffer)
+{
+	std::lock_guard<std::mutex> lock(s_Objects->Lock);
+	FrameQueries* frame = s_Objects->Recording;
+	if (!s_Objects->Statistics || !frame || frame->StatisticsBegun)
+		return;
+
+	vkCmdBeginQuery(commandBuffer, frame->StatisticsPool, 0, 0);
+	frame->StatisticsBegun = true;
+}
+
+void GpuProfiler::EndStatistics(VkCommandBuffer commandBuffer)
+{
+	std::lock_guard<std::mutex> lock(s_Objects->Lock);
+	FrameQueries* frame = s_Objects->Recording;
+	if (!frame || !frame->StatisticsBegun || frame->StatisticsEnded)
+		return;
+
+	vkCmdEndQuery(commandBuffer, frame->StatisticsPool, 0);
+	frame->StatisticsEnded = true;
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::GetStatisticsFlags()
+{
+	return s_Objects->Statistics ? GPU_STATISTICS_FLAGS : 0;
+}
+
+const GpuFrameTimings& GpuProfiler::GetLastFrame()
+{
+	return s_Objects->LastFrame;
+}
+
+float GpuProfiler::GetScopeMs(const char* name)
+{
+	float total = 0.0f;
+	for (auto& scope : s_Objects->LastFrame.Scopes)
+		if (strcmp(scope.Name, name) == 0)
+			total += scope.Ms;
+	return total;
+}
+
+bool GpuProfiler::IsTimingSupported()
+{
+	return s_Objects->Timing;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Device.h"
+
+struct GpuScopeTiming {
+	//Names are kept by pointer, so they have to be string literals
+	const char* Name;
+	float Ms;
+};
+
+//In the order Vulkan returns them for the flags the profiler queries
+struct GpuPipelineStatistics {
+	uint64_t InputVertices = 0;
+	uint64_t InputPrimitives = 0;
+	uint64_t VertexInvocations = 0;
+	uint64_t ClippingInvocations = 0;
+	uint64_t ClippingPrimitives = 0;
+	uint64_t FragmentInvocations = 0;
+	uint64_t ComputeInvocations = 0;
+};
+
+struct GpuFrameTimings {
+	//Index of the frame these scopes were recorded in, counted from the first BeginFrame
+	uint64_t Frame;
+	//In the order the scopes were opened; scopes whose timestamps were not available yet are left out
+	std::vector<GpuScopeTiming> Scopes;
+	//Set when the frame's statistics query was recorded and its results were available
+	bool HasStatistics = false;
+	GpuPipelineStatistics Statistics;
+};
+
+//Times scopes of command buffer recording with timestamp queries. Each frame in flight records into its own query pool,
+//which is read back when its slot comes around again, so collecting results never waits on the GPU; scopes still executing
+//by then, such as an upload batch submitted frames later, hold on to their queries until a later pass. Scopes are also
+//emitted as VK_EXT_debug_utils labels whenever the instance has the extension, so capture tools show the same names.
+//Pipeline statistics are collected the same way, once per frame, and added to the gpu.* counters of Metrics.
+class GpuProfiler {
+public:
+	GpuProfiler() = delete;
+	static void Init(RefPtr<Device> device, VkInstance instance, uint32_t framesInFlight);
+	static void Shutdown();
+
+	//Call once the fence of the frame that last used this slot has signaled; collects that frame's timings
+	static void BeginFrame(uint32_t slot);
+	//Call after the frame's last submission. Scopes opened outside BeginFrame and EndFrame are labelled but not timed.
+	static void EndFrame();
+
+	//Safe to call from several threads recording different command buffers. Only for command buffers submitted to the
+	//graphics queue, since other families may have no timestamps.
+	static uint64_t BeginScope(VkCommandBuffer commandBuffer, const char* name);
+	static void EndScope(VkCommandBuffer commandBuffer, uint64_t scope);
+
+	//Counts the work of everything recorded in between, secondaries included, into the frame's pipeline statistics. Once
+	//per frame, outside any render pass.
+	static void BeginStatistics(VkCommandBuffer commandBuffer);
+	static void EndStatistics(VkCommandBuffer commandBuffer);
+	//For the inheritance info of secondaries executed while the statistics query is active; 0 when it never is
+	static VkQueryPipelineStatisticFlags GetStatisticsFlags();
+
+	//Timings of the most recently collected frame
+	static const GpuFrameTimings& GetLastFrame();
+	//Sum of every scope with the given name in the most recently collected frame
+	static float GetScopeMs(const char* name);
+	//Devices without timestamps on the graphics queue or without host query reset only get labels
+	static bool IsTimingSupported();
+};
+
+//Opens a scope for as long as it lives
+class GpuScope {
+public:
+	GpuScope(VkCommandBuffer commandBuffer, const char* name)
+		:m_CommandBuffer(commandBuffer), m_Scope(GpuProfiler::BeginScope(commandBuffer, name))
+	{
+	}
+
+	~GpuScope() {
+		GpuProfiler::EndScope(m_CommandBuffer, m_Scope);
+	}
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+private:
+	VkCommandBuffer m_CommandBuffer;
+	uint64_t m_Scope;
+};
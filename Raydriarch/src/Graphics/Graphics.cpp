@@ -1,12 +1,27 @@
 #include "raydpch.h"
 #include "Graphics.h"
 
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "Asset/MeshCache.h"
+#include "Core/Metrics.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #define MAX_FRAMES_IN_FLIGHT 2
+#define MAX_OBJECTS_PER_FRAME 4096
+#define MAX_INSTANCES_PER_FRAME 131072
+#define INSTANCE_BINDING 1
+
+#define GEOMETRY_POOL_VERTICES (1024 * 1024)
+#define GEOMETRY_POOL_INDICES (4 * 1024 * 1024)
+#define GEOMETRY_POOL_MESHES 4096
+#define GEOMETRY_POOL_MESHLETS 65536
+#define MESHLET_INDICES_PER_FRAME (8 * 1024 * 1024)
+//Largest on-screen deviation, in pixels, a coarser LOD may introduce
+#define LOD_PIXEL_ERROR 1.0f
+//Device memory streamed textures may hold beyond their mip tails
+#define TEXTURE_BUDGET (256ull * 1024 * 1024)
+#define PIPELINE_CACHE_PATH "pipeline.cache"
 
 static SceneData* s_Data = new SceneData;
 static GraphicsObjects* s_Objects = new GraphicsObjects;
@@ -21,19 +36,61 @@ struct PushConstantData {
 	glm::vec3 color;
 };
 
+//Cube spanning [-1, 1], four vertices per face so each face keeps its own normal and UVs
+static MeshData CreateCube()
+{
+	MeshData cube;
+	for (uint32_t axis = 0; axis < 3; axis++)
+		for (float sign : { -1.0f, 1.0f }) {
+			glm::vec3 normal(0.0f);
+			normal[axis] = sign;
+			glm::vec3 u(0.0f), v(0.0f);
+			u[(axis + 1) % 3] = 1.0f;
+			v[(axis + 2) % 3] = 1.0f;
+
+			uint32_t first = static_cast<uint32_t>(cube.Vertices.size());
+			for (glm::vec2 corner : { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) })
+				cube.Vertices.push_back({ normal + (corner.x * 2.0f - 1.0f) * u + (corner.y * 2.0f - 1.0f) * v, normal, corner });
+
+			//Winding flips with the side of the axis, so every face stays counter-clockwise seen from outside
+			uint32_t quad[6] = { 0, 1, 2, 2, 3, 0 };
+			if (sign < 0.0f) {
+				std::swap(quad[1], quad[2]);
+				std::swap(quad[4], quad[5]);
+			}
+			for (uint32_t index : quad)
+				cube.Indices.push_back(first + index);
+		}
+
+	cube.Bounds = ComputeBounds(cube.Vertices.data(), cube.Vertices.size());
+	return cube;
+}
+
 void Graphics::Init(ScopedPtr<Window>& window)
 {
+	RAYD_PROFILE_SCOPE("Graphics::Init");
+	auto initStart = std::chrono::high_resolution_clock::now();
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.geometryShader = 1;
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	s_Objects->GPU = MakeRefPtr<Device>(window->GetGraphicsContext().GetInstance(), window->GetSurface(), deviceFeatures);
+	//Before any pipeline is created, so every one of them can hit it
+	if (!s_Objects->GPU->GetPipelineCache().Load(PIPELINE_CACHE_PATH))
+		RAYD_INFO("No usable pipeline cache, pipelines are compiled from scratch");
+	s_Objects->Pipelines = MakeScopedPtr<PipelineRegistry>(s_Objects->GPU);
 
 	VkCommandPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 	poolInfo.queueFamilyIndex = *s_Objects->GPU->GetQueueFamilies().Graphics.Index;
 
-	RAYD_VK_VALIDATE(vkCreateCommandPool(s_Objects->GPU->GetDeviceHandle(), &poolInfo, nullptr, &s_Objects->CommandPool), "Failed to create graphics command pool!");
+	VkResult result = vkCreateCommandPool(s_Objects->GPU->GetDeviceHandle(), &poolInfo, nullptr, &s_Objects->CommandPool);
+	RAYD_VK_VALIDATE(result, "Failed to create graphics command pool!");
 	Command::Init(s_Objects->GPU, s_Objects->CommandPool);
+	Upload::Init(s_Objects->GPU);
+	GpuProfiler::Init(s_Objects->GPU, window->GetGraphicsContext().GetInstance(), MAX_FRAMES_IN_FLIGHT);
+	s_Objects->Workers = MakeRefPtr<ThreadPool>();
+	s_Objects->Recorder = MakeScopedPtr<CommandRecorder>(s_Objects->GPU, s_Objects->Workers, MAX_FRAMES_IN_FLIGHT);
 
 	auto [width, height] = window->GetFramebufferSize();
 	s_Objects->SC = MakeScopedPtr<SwapChain>(s_Objects->GPU, window->GetSurface(), width, height);
@@ -41,7 +98,7 @@ void Graphics::Init(ScopedPtr<Window>& window)
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
 	uboLayoutBinding.binding = 0;
 	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.pImmutableSamplers = nullptr;
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -58,113 +115,85 @@ void Graphics::Init(ScopedPtr<Window>& window)
 
 	s_Data->DescSetLayout = MakeRefPtr<DescriptorSetLayout>(s_Objects->GPU, descLayoutBindings);
 
-	s_Data->Room = MakeScopedPtr<Model>(s_Objects->GPU, "res/models/viking_room/viking_room.obj");
+	s_Data->Geometry = MakeScopedPtr<GeometryPool>(s_Objects->GPU, s_Data->Format.GetStride(), GEOMETRY_POOL_VERTICES, GEOMETRY_POOL_INDICES, GEOMETRY_POOL_MESHES,
+		GEOMETRY_POOL_MESHLETS);
+	s_Data->Indirect = MakeScopedPtr<IndirectRenderer>(s_Objects->GPU, *s_Data->Geometry, MAX_INSTANCES_PER_FRAME, MAX_FRAMES_IN_FLIGHT);
+	s_Data->Meshlets = MakeScopedPtr<MeshletRenderer>(s_Objects->GPU, *s_Data->Geometry, MAX_INSTANCES_PER_FRAME, MESHLET_INDICES_PER_FRAME, MAX_FRAMES_IN_FLIGHT);
+
+	//Drawn in place of every spawned model until its own geometry is resident
+	MeshData cube = CreateCube();
+	PackedMesh packedCube;
+	MeshCache::Process(cube, "placeholder cube", s_Data->Format, packedCube);
+	s_Data->Placeholder = MakeRefPtr<Model>(s_Objects->GPU, packedCube, s_Data->Format, s_Data->Geometry.get());
+
+	//The room decodes on the workers while the rest of the renderer starts up
+	s_Data->World = MakeScopedPtr<Scene>();
+	SpawnModel("res/models/viking_room/viking_room.obj");
+
+	//Per-instance model matrix, one vec4 column per location
+	s_Data->Layout = s_Data->Placeholder->GetVertexLayout();
+	for (uint32_t column = 0; column < 4; column++)
+		s_Data->Layout.AddAttribute(3 + column, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT);
+	s_Data->Layout.AddBinding(INSTANCE_BINDING, sizeof(glm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE);
+
+	//Same shaders, but the transform is read out of the culling pass's object records
+	s_Data->IndirectLayout = s_Data->Placeholder->GetVertexLayout();
+	IndirectRenderer::AddInstanceAttributes(s_Data->IndirectLayout, INSTANCE_BINDING, 3);
 	VkPushConstantRange pcr;
 	pcr.offset = 0;
 	pcr.size = sizeof(PushConstantData);
 	pcr.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	s_Data->PushConstants.push_back(pcr);
-	s_Data->Pipeline = MakeRefPtr<GraphicsPipeline>(s_Objects->GPU, s_Objects->SC, s_Data->DescSetLayout, 
-		"res/shaders/vert.spv", "res/shaders/frag.spv", s_Data->PushConstants, s_Data->Room->GetVertexLayout());
-
-	s_Data->Texture = MakeRefPtr<Image>(s_Objects->GPU, "res/models/viking_room/viking_room.png");
-	s_Data->Sampler = MakeRefPtr<Sampler>(s_Objects->GPU, s_Data->Texture->MipLevelSize());
-	s_Data->UBuffers.resize(s_Objects->SC->GetImages().size());
-	for (auto& ubuff : s_Data->UBuffers)
-		ubuff = MakeScopedPtr<UniformBuffer>(s_Objects->GPU, sizeof(UniformBufferObject));
-	std::vector<VkDescriptorPoolSize> poolSizes;
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<uint32_t>(s_Objects->SC->GetImages().size()) });
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(s_Objects->SC->GetImages().size()) });
-	s_Data->DescPool = MakeRefPtr<DescriptorPool>(s_Objects->GPU, s_Objects->SC->GetImages().size(), poolSizes);
-	std::vector<VkDescriptorSetLayout> layouts(s_Objects->SC->GetImages().size(), s_Data->DescSetLayout->GetHandle());
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = s_Data->DescPool->GetPoolHandle();
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(s_Objects->SC->GetImages().size());
-	allocInfo.pSetLayouts = layouts.data();
-
-	s_Data->DescSets.resize(s_Objects->SC->GetImages().size());
-	RAYD_VK_VALIDATE(vkAllocateDescriptorSets(s_Objects->GPU->GetDeviceHandle(), &allocInfo, s_Data->DescSets.data()), "Failed to allocate descriptor sets!");
-
-	for (size_t i = 0; i < s_Objects->SC->GetImages().size(); i++) {
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = s_Data->UBuffers[i]->GetBufferHandle();
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
+	CreatePipelines();
 
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = s_Data->Texture->GetViewHandle();
-		imageInfo.sampler = s_Data->Sampler->GetHandle();
-
-		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = s_Data->DescSets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = s_Data->DescSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pImageInfo = &imageInfo;
-
-		vkUpdateDescriptorSets(s_Objects->GPU->GetDeviceHandle(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	//Only mip tails are uploaded before the first frame; finer levels stream in as draws ask for them
+	s_Data->Streamer = MakeScopedPtr<TextureStreamer>(s_Objects->GPU, TEXTURE_BUDGET, s_Objects->Workers);
+	s_Data->Texture = s_Data->Streamer->Load("res/models/viking_room/viking_room.png", TextureFormat::BC7, true);
+	//The image only ever holds the resident levels, so clamping to the longest possible chain never limits it
+	s_Data->TextureSampler = MakeRefPtr<Sampler>(s_Objects->GPU, TEXTURE_CACHE_MAX_LEVELS);
+	Upload::Wait(Upload::Flush());
+
+	s_Data->UBuffer = MakeScopedPtr<UniformBuffer>(s_Objects->GPU, sizeof(UniformBufferObject), MAX_OBJECTS_PER_FRAME, MAX_FRAMES_IN_FLIGHT);
+	s_Data->Instances = MakeScopedPtr<InstanceBuffer>(s_Objects->GPU, sizeof(glm::mat4), MAX_INSTANCES_PER_FRAME, MAX_FRAMES_IN_FLIGHT);
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT });
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAMES_IN_FLIGHT });
+	s_Data->DescPool = MakeRefPtr<DescriptorPool>(s_Objects->GPU, MAX_FRAMES_IN_FLIGHT, poolSizes);
+	s_Data->FrameDescSets = s_Data->DescPool->Allocate(s_Data->DescSetLayout->GetHandle(), MAX_FRAMES_IN_FLIGHT);
+	s_Data->FrameViews.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	s_Data->DescSet = s_Data->FrameDescSets[0];
+
+	//The texture binding is written at the start of each frame, once the view that frame samples is known
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = s_Data->UBuffer->GetBufferHandle();
+	bufferInfo.offset = 0;
+	bufferInfo.range = sizeof(UniformBufferObject);
+
+	for (VkDescriptorSet set : s_Data->FrameDescSets) {
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(s_Objects->GPU->GetDeviceHandle(), 1, &descriptorWrite, 0, nullptr);
 	}
 
-	s_Objects->CBuffers.resize(s_Objects->SC->GetFramebuffers().size());
+	s_Objects->CBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
 	{
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.commandPool = s_Objects->CommandPool;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = s_Objects->CBuffers.size();
+		allocInfo.commandBufferCount = static_cast<uint32_t>(s_Objects->CBuffers.size());
 
-		RAYD_VK_VALIDATE(vkAllocateCommandBuffers(s_Objects->GPU->GetDeviceHandle(), &allocInfo, s_Objects->CBuffers.data()), "Failed to allocate command buffers!");
-	}
-
-	for (size_t i = 0; i < s_Objects->CBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-		RAYD_VK_VALIDATE(vkBeginCommandBuffer(s_Objects->CBuffers[i], &beginInfo), "Failed to begin recording command buffer!");
-
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = s_Objects->SC->GetRenderPass();
-		renderPassInfo.framebuffer = s_Objects->SC->GetFramebuffers()[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = s_Objects->SC->GetExtent();
-
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
-
-		vkCmdBeginRenderPass(s_Objects->CBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		vkCmdBindPipeline(s_Objects->CBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->Pipeline->GetPipelineHandle());
-
-		vkCmdBindDescriptorSets(s_Objects->CBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->Pipeline->GetLayoutHandle(), 0, 1, &s_Data->DescSets[i], 0, nullptr);
-
-		PushConstantData pushData;
-		pushData.color = { .3, .5, .7 };
-		vkCmdPushConstants(s_Objects->CBuffers[i], s_Data->Pipeline->GetLayoutHandle(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushData), &pushData);
-
-		s_Data->Room->Render(s_Objects->CBuffers[i]);
-
-		vkCmdEndRenderPass(s_Objects->CBuffers[i]);
-
-		RAYD_VK_VALIDATE(vkEndCommandBuffer(s_Objects->CBuffers[i]), "Failed to record command buffer!");
+		result = vkAllocateCommandBuffers(s_Objects->GPU->GetDeviceHandle(), &allocInfo, s_Objects->CBuffers.data());
+		RAYD_VK_VALIDATE(result, "Failed to allocate command buffers!");
 	}
 
 	s_Objects->ImageAvailSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -180,19 +209,48 @@ void Graphics::Init(ScopedPtr<Window>& window)
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		RAYD_VK_VALIDATE(vkCreateSemaphore(s_Objects->GPU->GetDeviceHandle(), &semaphoreInfo, nullptr, &s_Objects->ImageAvailSemaphores[i]) ||
-			vkCreateSemaphore(s_Objects->GPU->GetDeviceHandle(), &semaphoreInfo, nullptr, &s_Objects->RenderFinishSemaphores[i]) != VK_SUCCESS ||
-			vkCreateFence(s_Objects->GPU->GetDeviceHandle(), &fenceInfo, nullptr, &s_Objects->InFlightFences[i]), "Failed to create synchronization objects for a frame!");
+		result = vkCreateSemaphore(s_Objects->GPU->GetDeviceHandle(), &semaphoreInfo, nullptr, &s_Objects->ImageAvailSemaphores[i]);
+		RAYD_VK_VALIDATE(result, "Failed to create image available semaphore!");
+		result = vkCreateSemaphore(s_Objects->GPU->GetDeviceHandle(), &semaphoreInfo, nullptr, &s_Objects->RenderFinishSemaphores[i]);
+		RAYD_VK_VALIDATE(result, "Failed to create render finished semaphore!");
+		result = vkCreateFence(s_Objects->GPU->GetDeviceHandle(), &fenceInfo, nullptr, &s_Objects->InFlightFences[i]);
+		RAYD_VK_VALIDATE(result, "Failed to create in-flight fence!");
 	}
+
+	s_Objects->GPU->GetAllocator().LogStats();
+
+	//Compare across launches, with and without the cache file, for cold against warm startup
+	s_Objects->Timing.StartupMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - initStart).count();
+	const PipelineCacheStats& cacheStats = s_Objects->GPU->GetPipelineCache().GetStats();
+	RAYD_INFO("Renderer ready in {0:.1f} ms; {1} pipelines took {2:.1f} ms with a {3} pipeline cache", s_Objects->Timing.StartupMs,
+		cacheStats.PipelinesCreated, cacheStats.CreateMs, cacheStats.Warm ? "warm" : "cold");
 }
 
 void Graphics::Present(ScopedPtr<class Window>& window, float deltaTime)
 {
+	RAYD_PROFILE_SCOPE("Graphics::Present");
 	static uint8_t currentFrame = 0;
-	vkWaitForFences(s_Objects->GPU->GetDeviceHandle(), 1, &s_Objects->InFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	auto frameStart = std::chrono::high_resolution_clock::now();
+	{
+		RAYD_PROFILE_SCOPE("Wait for frame fence");
+		vkWaitForFences(s_Objects->GPU->GetDeviceHandle(), 1, &s_Objects->InFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	}
+
+	//The fence just waited on belongs to the frame MAX_FRAMES_IN_FLIGHT back, and every frame before it has completed too
+	if (s_Objects->FrameCount >= MAX_FRAMES_IN_FLIGHT)
+		s_Objects->SC->ReleaseRetired(s_Objects->FrameCount - MAX_FRAMES_IN_FLIGHT);
+
+	auto waitEnd = std::chrono::high_resolution_clock::now();
+	float waitMs = std::chrono::duration<float, std::chrono::milliseconds::period>(waitEnd - frameStart).count();
 
 	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(s_Objects->GPU->GetDeviceHandle(), s_Objects->SC->GetSwapChainHandle(), UINT64_MAX, s_Objects->ImageAvailSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	VkResult result;
+	{
+		RAYD_PROFILE_SCOPE("Acquire image");
+		result = s_Objects->SC->AcquireNextImage(s_Objects->ImageAvailSemaphores[currentFrame], imageIndex);
+	}
+	auto acquireEnd = std::chrono::high_resolution_clock::now();
+	waitMs += std::chrono::duration<float, std::chrono::milliseconds::period>(acquireEnd - waitEnd).count();
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		Graphics::RecreateSwapChain(window);
@@ -201,206 +259,509 @@ void Graphics::Present(ScopedPtr<class Window>& window, float deltaTime)
 	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
 		RAYD_ERROR("failed to acquire swap chain image!");
 
+	//The fence covers the scopes this slot timed last time around, so they are ready to collect
+	GpuProfiler::BeginFrame(currentFrame);
+	s_Data->Stats.GpuTimeMs = GpuProfiler::GetScopeMs("frame");
+
+	//The frame's fence has signaled, so its uniform and instance regions are no longer read by the GPU
+	s_Data->UBuffer->BeginFrame(currentFrame);
+	s_Data->Instances->BeginFrame(currentFrame);
+
 	UniformBufferObject ubo{};
 	auto [width, height] = s_Objects->SC->GetExtent();
 	ubo.model = glm::rotate(glm::mat4(1.0f), deltaTime * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	ubo.view = glm::lookAt(s_Data->CameraEye, s_Data->CameraTarget, glm::vec3(0.0f, 0.0f, 1.0f));
 	ubo.proj = glm::perspective(glm::radians(45.0f), width / (float)height, 0.1f, 10.0f);
 	ubo.proj[1][1] *= -1;
 
-	s_Data->UBuffers[imageIndex]->Update(sizeof(ubo), &ubo);
-
-	if (s_Objects->ImagesInFlightFenches[imageIndex] != VK_NULL_HANDLE) 
+	uint32_t uniformOffset = s_Data->UBuffer->Push(&ubo);
+
+	//Culling and LOD selection work in the space the object transforms map into, before the global model matrix; an error
+	//of e at distance d covers e / d * proj[1][1] * height / 2 pixels
+	float pixelScale = std::abs(ubo.proj[1][1]) * height * 0.5f;
+	CullView view;
+	view.WorldToClip = ubo.proj * ubo.view * ubo.model;
+	view.Eye = glm::vec3(glm::inverse(ubo.view * ubo.model)[3]);
+	view.LodScale = pixelScale / LOD_PIXEL_ERROR;
+
+	//Every model samples the one texture, so it needs the detail of the largest instance on screen
+	float textureExtent = 0.0f;
+	for (auto& batch : s_Data->World->GetBatches())
+		for (auto& transform : batch.Transforms)
+			textureExtent = std::max(textureExtent, batch.Mesh->GetScreenExtent(transform, view.Eye, pixelScale));
+	if (textureExtent > 0.0f)
+		s_Data->Streamer->Request(*s_Data->Texture, textureExtent);
+
+	if (s_Objects->ImagesInFlightFenches[imageIndex] != VK_NULL_HANDLE) {
+		RAYD_PROFILE_SCOPE("Wait for image fence");
 		vkWaitForFences(s_Objects->GPU->GetDeviceHandle(), 1, &s_Objects->ImagesInFlightFenches[imageIndex], VK_TRUE, UINT64_MAX);
+	}
 	s_Objects->ImagesInFlightFenches[imageIndex] = s_Objects->InFlightFences[currentFrame];
 
+	//Resources created since the last frame are submitted ahead of the draws that read them, streamed levels and decoded
+	//models included
+	{
+		RAYD_PROFILE_SCOPE("Uploads");
+		UpdatePendingModels();
+		s_Data->Streamer->Update();
+		Upload::Flush();
+	}
+
+	//The frame's fence has signaled, so its set is free to point at whatever the streamer swapped in
+	s_Data->DescSet = s_Data->FrameDescSets[currentFrame];
+	if (s_Data->FrameViews[currentFrame] != s_Data->Texture->GetView()) {
+		s_Data->FrameViews[currentFrame] = s_Data->Texture->GetView();
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = s_Data->FrameViews[currentFrame];
+		imageInfo.sampler = s_Data->TextureSampler->GetHandle();
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = s_Data->DescSet;
+		descriptorWrite.dstBinding = 1;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(s_Objects->GPU->GetDeviceHandle(), 1, &descriptorWrite, 0, nullptr);
+	}
+
+	bool indirect = s_Data->Path == RenderPath::Indirect || s_Data->Path == RenderPath::Meshlet;
+	VkFramebuffer framebuffer = s_Objects->SC->GetFramebuffers()[imageIndex];
+	std::vector<VkCommandBuffer> secondaries;
+	if (!indirect) {
+		RAYD_PROFILE_SCOPE("Record draws");
+		s_Data->DrawList.clear();
+		s_Data->Stats.Instances = 0;
+		for (auto& batch : s_Data->World->GetBatches()) {
+			uint32_t count = static_cast<uint32_t>(batch.Transforms.size());
+			if (count == 0)
+				continue;
+
+			//Instances are regrouped by LOD so each level still draws with one instanced call
+			for (auto& transforms : s_Data->LodTransforms)
+				transforms.clear();
+			for (auto& transform : batch.Transforms)
+				s_Data->LodTransforms[batch.Mesh->SelectLod(transform, view.Eye, view.LodScale)].push_back(transform);
+
+			for (uint32_t lod = 0; lod < batch.Mesh->GetLodCount(); lod++) {
+				auto& transforms = s_Data->LodTransforms[lod];
+				uint32_t lodCount = static_cast<uint32_t>(transforms.size());
+				if (lodCount == 0)
+					continue;
+
+				//Clamped when the frame's instance region is full
+				uint32_t firstInstance = s_Data->Instances->Push(transforms.data(), lodCount);
+				if (lodCount == 0)
+					continue;
+
+				s_Data->Stats.Instances += lodCount;
+				if (s_Data->Path == RenderPath::Instanced)
+					s_Data->DrawList.push_back({ batch.Mesh.get(), uniformOffset, firstInstance, lodCount, lod });
+				else
+					for (uint32_t i = 0; i < lodCount; i++)
+						s_Data->DrawList.push_back({ batch.Mesh.get(), uniformOffset, firstInstance + i, 1, lod });
+			}
+		}
+		s_Data->Stats.DrawCalls = static_cast<uint32_t>(s_Data->DrawList.size());
+
+		//The frame's fence has signaled, so every pool it recorded into can be reset at once
+		s_Objects->Recorder->BeginFrame(currentFrame);
+		secondaries = s_Objects->Recorder->Record(s_Objects->SC->GetRenderPass(), framebuffer, static_cast<uint32_t>(s_Data->DrawList.size()),
+			[](VkCommandBuffer cbuff, uint32_t first, uint32_t count) {
+				GpuScope scope(cbuff, "draws");
+				vkCmdBindPipeline(cbuff, VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->Pipeline->GetPipelineHandle());
+				//Secondaries inherit no dynamic state from the primary
+				GraphicsPipeline::SetViewport(cbuff, s_Objects->SC->GetExtent());
+
+				PushConstantData pushData;
+				pushData.color = { .3, .5, .7 };
+				vkCmdPushConstants(cbuff, s_Data->Pipeline->GetLayoutHandle(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushData), &pushData);
+				s_Data->Instances->Bind(cbuff, INSTANCE_BINDING);
+
+				for (uint32_t i = first; i < first + count; i++) {
+					DrawItem& item = s_Data->DrawList[i];
+					vkCmdBindDescriptorSets(cbuff, VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->Pipeline->GetLayoutHandle(), 0, 1, &s_Data->DescSet, 1, &item.UniformOffset);
+					item.Mesh->Render(cbuff, item.InstanceCount, item.FirstInstance, item.Lod);
+				}
+			});
+	}
+
+	VkCommandBuffer cbuff = s_Objects->CBuffers[currentFrame];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	result = vkBeginCommandBuffer(cbuff, &beginInfo);
+	RAYD_VK_VALIDATE(result, "Failed to begin recording command buffer!");
+	uint64_t frameScope = GpuProfiler::BeginScope(cbuff, "frame");
+	GpuProfiler::BeginStatistics(cbuff);
+
+	s_Data->Stats.ClustersTested = 0;
+	s_Data->Stats.ClustersVisible = 0;
+	if (s_Data->Path == RenderPath::Indirect) {
+		GpuScope scope(cbuff, "cull");
+		s_Data->Indirect->Cull(cbuff, currentFrame, *s_Data->World, view);
+		s_Data->Stats.Instances = s_Data->Indirect->GetObjectCount();
+		s_Data->Stats.DrawCalls = s_Data->Stats.Instances > 0 ? 1 : 0;
+	}
+	else if (s_Data->Path == RenderPath::Meshlet) {
+		GpuScope scope(cbuff, "cull");
+		s_Data->Meshlets->Cull(cbuff, currentFrame, *s_Data->World, view);
+		s_Data->Stats.Instances = s_Data->Meshlets->GetObjectCount();
+		s_Data->Stats.DrawCalls = s_Data->Stats.Instances > 0 ? 1 : 0;
+		s_Data->Stats.ClustersTested = s_Data->Meshlets->GetCounters().ClustersTested;
+		s_Data->Stats.ClustersVisible = s_Data->Meshlets->GetCounters().ClustersVisible;
+	}
+	//One call per object when the device can neither count nor batch indirect draws
+	if (indirect && !s_Objects->GPU->SupportsDrawIndirectCount() && !s_Objects->GPU->SupportsMultiDrawIndirect())
+		s_Data->Stats.DrawCalls = s_Data->Stats.Instances;
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = s_Objects->SC->GetRenderPass();
+	renderPassInfo.framebuffer = framebuffer;
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = s_Objects->SC->GetExtent();
+
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	uint64_t renderPassScope = GpuProfiler::BeginScope(cbuff, "render pass");
+	if (indirect) {
+		vkCmdBeginRenderPass(cbuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(cbuff, VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->IndirectPipeline->GetPipelineHandle());
+		GraphicsPipeline::SetViewport(cbuff, s_Objects->SC->GetExtent());
+		vkCmdBindDescriptorSets(cbuff, VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->IndirectPipeline->GetLayoutHandle(), 0, 1, &s_Data->DescSet, 1, &uniformOffset);
+
+		PushConstantData pushData;
+		pushData.color = { .3, .5, .7 };
+		vkCmdPushConstants(cbuff, s_Data->IndirectPipeline->GetLayoutHandle(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushData), &pushData);
+
+		if (s_Data->Path == RenderPath::Meshlet)
+			s_Data->Meshlets->Draw(cbuff, currentFrame, INSTANCE_BINDING);
+		else
+			s_Data->Indirect->Draw(cbuff, currentFrame, INSTANCE_BINDING);
+	}
+	else {
+		vkCmdBeginRenderPass(cbuff, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		if (!secondaries.empty())
+			vkCmdExecuteCommands(cbuff, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+	}
+	vkCmdEndRenderPass(cbuff);
+	GpuProfiler::EndScope(cbuff, renderPassScope);
+
+	GpuProfiler::EndStatistics(cbuff);
+	GpuProfiler::EndScope(cbuff, frameScope);
+	result = vkEndCommandBuffer(cbuff);
+	RAYD_VK_VALIDATE(result, "Failed to record command buffer!");
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+	//Headless images are ready as soon as they are handed out and nothing waits to present them
+	uint32_t semaphoreCount = s_Objects->SC->IsHeadless() ? 0 : 1;
 	VkSemaphore waitSemaphores[] = { s_Objects->ImageAvailSemaphores[currentFrame] };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = semaphoreCount;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &s_Objects->CBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &cbuff;
 
 	VkSemaphore signalSemaphores[] = { s_Objects->RenderFinishSemaphores[currentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = semaphoreCount;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	vkResetFences(s_Objects->GPU->GetDeviceHandle(), 1, &s_Objects->InFlightFences[currentFrame]);
 
-	RAYD_VK_VALIDATE(vkQueueSubmit(s_Objects->GPU->GetQueueFamilies().Graphics.Queue, 1, &submitInfo, s_Objects->InFlightFences[currentFrame]), "Failed to submit draw command buffer!");
-
-	VkPresentInfoKHR presentInfo{};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
-
-	VkSwapchainKHR swapChains[] = { s_Objects->SC->GetSwapChainHandle() };
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
-
-	presentInfo.pImageIndices = &imageIndex;
+	auto submitStart = std::chrono::high_resolution_clock::now();
+	{
+		RAYD_PROFILE_SCOPE("Submit");
+		result = Command::Submit(s_Objects->GPU->GetQueueFamilies().Graphics.Queue, 1, &submitInfo, s_Objects->InFlightFences[currentFrame]);
+		RAYD_VK_VALIDATE(result, "Failed to submit draw command buffer!");
+	}
+	auto submitEnd = std::chrono::high_resolution_clock::now();
+	s_Data->Stats.SubmitMs = std::chrono::duration<float, std::chrono::milliseconds::period>(submitEnd - submitStart).count();
+	s_Objects->FrameCount++;
+	GpuProfiler::EndFrame();
 
-	result = vkQueuePresentKHR(s_Objects->GPU->GetQueueFamilies().Present.Queue, &presentInfo);
+	{
+		RAYD_PROFILE_SCOPE("Present image");
+		result = s_Objects->SC->Present(s_Objects->GPU->GetQueueFamilies().Present.Queue, signalSemaphores[0], imageIndex);
+	}
+	waitMs += std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - submitEnd).count();
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window->m_Resized) {
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window->m_Resized || s_Objects->SwapChainInvalid) {
 		window->m_Resized = false;
+		s_Objects->SwapChainInvalid = false;
 		Graphics::RecreateSwapChain(window);
 	}
 	else
 		RAYD_VK_VALIDATE(result, "Failed to present swap chain image!");
 
+	s_Data->Stats.PresentWaitMs = waitMs;
+	s_Data->Stats.CpuTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - frameStart).count() - waitMs;
+
 	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	Metrics::EndFrame();
 }
 
 void Graphics::RecreateSwapChain(ScopedPtr<class Window>& window)
 {
+	RAYD_PROFILE_SCOPE("Graphics::RecreateSwapChain");
+	//A minimized window has no framebuffer to render into, so wait until it is restored
 	auto [width, height] = window->GetFramebufferSize();
 	while (width == 0 || height == 0) {
-		auto [width, height] = window->GetFramebufferSize();
 		glfwWaitEvents();
+		std::tie(width, height) = window->GetFramebufferSize();
 	}
 
-	CleanupSwapChain();
-	s_Objects->SC.reset();
-	s_Objects->SC = MakeScopedPtr<SwapChain>(s_Objects->GPU, window->GetSurface(), width, height);
+	//Pipelines, uniforms, descriptors and command buffers do not depend on the window size and are left alone. Frames
+	//already submitted keep rendering into and presenting the old swap chain, which is released once the next frame,
+	//the first into the new one, has completed
+	auto recreateStart = std::chrono::high_resolution_clock::now();
+	s_Objects->SC->Resize(width, height, s_Objects->FrameCount);
 
+	//Fences from the old images say nothing about the new ones
+	s_Objects->ImagesInFlightFenches.assign(s_Objects->SC->GetImages().size(), VK_NULL_HANDLE);
+	s_Objects->Timing.LastRecreateMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - recreateStart).count();
+	s_Objects->Timing.RecreateCount++;
+}
+
+void Graphics::CreatePipelines()
+{
+	RAYD_PROFILE_SCOPE("Graphics::CreatePipelines");
+	s_Data->Pipeline = s_Objects->Pipelines->GetGraphicsPipeline(s_Objects->SC, s_Data->DescSetLayout,
+		"res/shaders/vert.spv", "res/shaders/frag.spv", s_Data->PushConstants, s_Data->Layout);
+	s_Data->IndirectPipeline = s_Objects->Pipelines->GetGraphicsPipeline(s_Objects->SC, s_Data->DescSetLayout,
+		"res/shaders/vert.spv", "res/shaders/frag.spv", s_Data->PushConstants, s_Data->IndirectLayout);
+}
+
+void Graphics::CleanupSwapChain()
+{
+	s_Objects->GPU->Join();
+	s_Objects->SC.reset();
 	s_Data->Pipeline.reset();
-	s_Data->Pipeline = MakeRefPtr<GraphicsPipeline>(s_Objects->GPU, s_Objects->SC, s_Data->DescSetLayout,
-		"res/shaders/vert.spv", "res/shaders/frag.spv", s_Data->PushConstants, s_Data->Room->GetVertexLayout());
-	for (auto& ubuff : s_Data->UBuffers) {
-		ubuff.reset();
-		ubuff = MakeScopedPtr<UniformBuffer>(s_Objects->GPU, sizeof(UniformBufferObject));
-	}
+	s_Data->IndirectPipeline.reset();
+	//Their render pass is gone, so they could never be handed out again
+	s_Objects->Pipelines->ReleaseUnused();
+}
 
-	std::vector<VkDescriptorPoolSize> poolSizes{};
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<uint32_t>(s_Objects->SC->GetImages().size()) });
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(s_Objects->SC->GetImages().size()) });
-	s_Data->DescPool = MakeRefPtr<DescriptorPool>(s_Objects->GPU, s_Objects->SC->GetImages().size(), poolSizes);
-	std::vector<VkDescriptorSetLayout> layouts(s_Objects->SC->GetImages().size(), s_Data->DescSetLayout->GetHandle());
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = s_Data->DescPool->GetPoolHandle();
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(s_Objects->SC->GetImages().size());
-	allocInfo.pSetLayouts = layouts.data();
-
-	RAYD_VK_VALIDATE(vkAllocateDescriptorSets(s_Objects->GPU->GetDeviceHandle(), &allocInfo, s_Data->DescSets.data()), "Failed to allocate descriptor sets!");
-
-	for (size_t i = 0; i < s_Objects->SC->GetImages().size(); i++) {
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = s_Data->UBuffers[i]->GetBufferHandle();
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
+void Graphics::Shutdown()
+{
+	//Decodes still running write into the pending records
+	for (auto& pending : s_Data->PendingModels)
+		s_Objects->Workers->Wait(pending.Decode.GetJob());
+	s_Data->PendingModels.clear();
+	CleanupSwapChain();
 
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = s_Data->Texture->GetViewHandle();
-		imageInfo.sampler = s_Data->Sampler->GetHandle();
-
-		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = s_Data->DescSets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = s_Data->DescSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pImageInfo = &imageInfo;
-
-		vkUpdateDescriptorSets(s_Objects->GPU->GetDeviceHandle(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	vkFreeCommandBuffers(s_Objects->GPU->GetDeviceHandle(), s_Objects->CommandPool, static_cast<uint32_t>(s_Objects->CBuffers.size()), s_Objects->CBuffers.data());
+	s_Objects->Recorder.reset();
+	s_Objects->Workers.reset();
+	s_Objects->Pipelines.reset();
+	if (!s_Objects->GPU->GetPipelineCache().Save(PIPELINE_CACHE_PATH))
+		RAYD_WARN("Could not save the pipeline cache, the next launch starts cold");
+	s_Data->UBuffer.reset();
+	s_Data->Instances.reset();
+	s_Data->DescPool.reset();
+
+	auto textureStats = s_Data->Streamer->GetStats();
+	RAYD_INFO("Texture streaming: {0:.1f} MB resident of {1:.1f} MB budget, {2} promotions, {3} evictions",
+		textureStats.ResidentBytes / (1024.0 * 1024.0), textureStats.Budget / (1024.0 * 1024.0), textureStats.Promotions, textureStats.Evictions);
+	s_Data->Texture.reset();
+	s_Data->Streamer.reset();
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		vkDestroySemaphore(s_Objects->GPU->GetDeviceHandle(), s_Objects->RenderFinishSemaphores[i], nullptr);
+		vkDestroySemaphore(s_Objects->GPU->GetDeviceHandle(), s_Objects->ImageAvailSemaphores[i], nullptr);
+		vkDestroyFence(s_Objects->GPU->GetDeviceHandle(), s_Objects->InFlightFences[i], nullptr);
 	}
 
-	s_Objects->CBuffers.resize(s_Objects->SC->GetFramebuffers().size());
+	Upload::Shutdown();
+	Command::Shutdown();
+	GpuProfiler::Shutdown();
+	vkDestroyCommandPool(s_Objects->GPU->GetDeviceHandle(), s_Objects->CommandPool, nullptr);
 
-	{
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = s_Objects->CommandPool;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = s_Objects->CBuffers.size();
+	delete s_Data;
+	delete s_Objects;
+}
+
+Scene& Graphics::GetScene()
+{
+	return *s_Data->World;
+}
 
-		RAYD_VK_VALIDATE(vkAllocateCommandBuffers(s_Objects->GPU->GetDeviceHandle(), &allocInfo, s_Objects->CBuffers.data()), "Failed to allocate command buffers!");
+RefPtr<Model> Graphics::LoadModel(const std::string& path)
+{
+	auto it = s_Data->Models.find(path);
+	if (it != s_Data->Models.end())
+		return it->second;
+
+	//Finishing a decode already under way is cheaper than starting over; its entities still switch once it is resident
+	auto pending = std::find_if(s_Data->PendingModels.begin(), s_Data->PendingModels.end(), [&path](const PendingModel& model) { return model.Path == path; });
+	if (pending != s_Data->PendingModels.end()) {
+		s_Objects->Workers->Wait(pending->Decode.GetJob());
+		if (!pending->Mesh)
+			UploadPendingModel(*pending);
+		return pending->Mesh;
 	}
 
-	for (size_t i = 0; i < s_Objects->CBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	RefPtr<Model> model = MakeRefPtr<Model>(s_Objects->GPU, path, s_Data->Format, s_Data->Geometry.get(), s_Objects->Workers.get());
+	s_Data->Models.emplace(path, model);
+	return model;
+}
 
-		RAYD_VK_VALIDATE(vkBeginCommandBuffer(s_Objects->CBuffers[i], &beginInfo), "Failed to begin recording command buffer!");
+EntityID Graphics::SpawnModel(const std::string& path, const glm::mat4& transform)
+{
+	auto pending = std::find_if(s_Data->PendingModels.begin(), s_Data->PendingModels.end(), [&path](const PendingModel& model) { return model.Path == path; });
+	if (pending == s_Data->PendingModels.end()) {
+		auto it = s_Data->Models.find(path);
+		if (it != s_Data->Models.end())
+			return s_Data->World->CreateEntity(it->second, transform);
+
+		if (s_Data->PendingModels.empty())
+			s_Data->LoadStart = std::chrono::high_resolution_clock::now();
+
+		//Only CPU work runs on the workers; the upload is recorded on this thread once the decode is done
+		ThreadPool* workers = s_Objects->Workers.get();
+		VertexFormat format = s_Data->Format;
+		std::string name = "decode " + std::filesystem::path(path).filename().string();
+		JobFuture<DecodedMesh> decode = workers->Async(name, [workers, path, format]() {
+			DecodedMesh decoded;
+			decoded.Loaded = MeshCache::Load(path, format, decoded.Mesh, workers);
+			return decoded;
+		});
+		s_Data->PendingModels.push_back({ path, decode });
+		pending = std::prev(s_Data->PendingModels.end());
+	}
 
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = s_Objects->SC->GetRenderPass();
-		renderPassInfo.framebuffer = s_Objects->SC->GetFramebuffers()[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = s_Objects->SC->GetExtent();
+	EntityID entity = s_Data->World->CreateEntity(s_Data->Placeholder, transform);
+	pending->Entities.push_back(entity);
+	return entity;
+}
 
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-		clearValues[1].depthStencil = { 1.0f, 0 };
+void Graphics::UpdatePendingModels()
+{
+	auto& pending = s_Data->PendingModels;
+	if (pending.empty())
+		return;
 
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
+	for (auto& model : pending)
+		if (!model.Mesh && model.Decode.IsReady())
+			UploadPendingModel(model);
+
+	//Entities only switch once the batch holding the geometry has finished, so none ever draws a partial upload
+	auto finished = std::remove_if(pending.begin(), pending.end(), [](const PendingModel& model) {
+		if (!model.Mesh || !model.Mesh->IsResident())
+			return false;
+
+		//Entities destroyed meanwhile no longer draw the placeholder and are left alone
+		for (EntityID entity : model.Entities)
+			if (s_Data->World->GetModel(entity) == s_Data->Placeholder.get())
+				s_Data->World->SetModel(entity, model.Mesh);
+		return true;
+	});
+	pending.erase(finished, pending.end());
+
+	if (pending.empty()) {
+		float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - s_Data->LoadStart).count();
+		RAYD_INFO("Models resident {0:.1f} ms after loading began", elapsedMs);
+		s_Objects->Workers->LogTimings();
+	}
+}
 
-		vkCmdBeginRenderPass(s_Objects->CBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+void Graphics::UploadPendingModel(PendingModel& pending)
+{
+	DecodedMesh& decoded = pending.Decode.Get();
+	if (!decoded.Loaded) {
+		RAYD_ERROR("Failed to load model {0}, its entities keep the placeholder", pending.Path);
+		pending.Mesh = s_Data->Placeholder;
+		return;
+	}
 
-		vkCmdBindPipeline(s_Objects->CBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->Pipeline->GetPipelineHandle());
+	pending.Mesh = MakeRefPtr<Model>(s_Objects->GPU, decoded.Mesh, s_Data->Format, s_Data->Geometry.get());
+	s_Data->Models.emplace(pending.Path, pending.Mesh);
+	//Staging holds its own copy now
+	decoded.Mesh = PackedMesh();
+}
 
-		vkCmdBindDescriptorSets(s_Objects->CBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data->Pipeline->GetLayoutHandle(), 0, 1, &s_Data->DescSets[i], 0, nullptr);
-		
-		PushConstantData pushData;
-		pushData.color = { .3, .5, .7 };
-		vkCmdPushConstants(s_Objects->CBuffers[i], s_Data->Pipeline->GetLayoutHandle(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushData), &pushData);
-		
-		s_Data->Room->Render(s_Objects->CBuffers[i]);
+void Graphics::SetRenderPath(RenderPath path)
+{
+	bool indirect = path == RenderPath::Indirect || path == RenderPath::Meshlet;
+	if (indirect && !s_Objects->GPU->SupportsDrawIndirectFirstInstance()) {
+		RAYD_WARN("drawIndirectFirstInstance is not supported on this device, drawing with the instanced path instead");
+		path = RenderPath::Instanced;
+	}
+	s_Data->Path = path;
+}
 
-		vkCmdEndRenderPass(s_Objects->CBuffers[i]);
+RenderPath Graphics::GetRenderPath()
+{
+	return s_Data->Path;
+}
 
-		RAYD_VK_VALIDATE(vkEndCommandBuffer(s_Objects->CBuffers[i]), "Failed to record command buffer!");
-	}
+void Graphics::SetCamera(const glm::vec3& eye, const glm::vec3& target)
+{
+	s_Data->CameraEye = eye;
+	s_Data->CameraTarget = target;
+}
 
-	s_Objects->ImagesInFlightFenches.resize(s_Objects->SC->GetImages().size(), VK_NULL_HANDLE);
+void Graphics::SetTextureBudget(VkDeviceSize bytes)
+{
+	s_Data->Streamer->SetBudget(bytes);
 }
 
-void Graphics::CleanupSwapChain()
+bool Graphics::IsSceneResident()
 {
-	s_Objects->GPU->Join();
-	s_Objects->SC.reset();
-	vkFreeCommandBuffers(s_Objects->GPU->GetDeviceHandle(), s_Objects->CommandPool, static_cast<uint32_t>(s_Objects->CBuffers.size()), s_Objects->CBuffers.data());
-	s_Data->Pipeline.reset();
+	return s_Data->PendingModels.empty() && s_Data->Streamer->IsSettled() && Upload::IsIdle();
+}
 
-	for (auto& buff : s_Data->UBuffers)																																				
-		buff.reset();
+const FrameStats& Graphics::GetFrameStats()
+{
+	return s_Data->Stats;
+}
 
-	s_Data->DescPool.reset();
+const VkPhysicalDeviceProperties& Graphics::GetDeviceProperties()
+{
+	return s_Objects->GPU->GetProperties();
 }
 
-void Graphics::Shutdown()
+PipelineStats Graphics::GetPipelineStats()
 {
-	CleanupSwapChain();
+	PipelineStats stats = s_Objects->Timing;
+	stats.RetiredSwapChains = s_Objects->SC->GetRetiredCount();
+	stats.Cache = s_Objects->GPU->GetPipelineCache().GetStats();
+	stats.Registry = s_Objects->Pipelines->GetStats();
+	return stats;
+}
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vkDestroySemaphore(s_Objects->GPU->GetDeviceHandle(), s_Objects->RenderFinishSemaphores[i], nullptr);
-		vkDestroySemaphore(s_Objects->GPU->GetDeviceHandle(), s_Objects->ImageAvailSemaphores[i], nullptr);
-		vkDestroyFence(s_Objects->GPU->GetDeviceHandle(), s_Objects->InFlightFences[i], nullptr);
-	}
+void Graphics::InvalidateSwapChain()
+{
+	s_Objects->SwapChainInvalid = true;
+}
 
-	Command::Shutdown();
-	vkDestroyCommandPool(s_Objects->GPU->GetDeviceHandle(), s_Objects->CommandPool, nullptr);
+void Graphics::RebuildPipelines()
+{
+	auto rebuildStart = std::chrono::high_resolution_clock::now();
+	s_Objects->GPU->Join();
+	s_Data->Pipeline.reset();
+	s_Data->IndirectPipeline.reset();
+	s_Objects->Pipelines->ReleaseUnused();
+	CreatePipelines();
+	s_Objects->Timing.LastRebuildMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - rebuildStart).count();
+}
 
-	delete s_Data;
-	delete s_Objects;
+void Graphics::ResetPipelineCache()
+{
+	s_Objects->GPU->GetPipelineCache().Reset();
 }
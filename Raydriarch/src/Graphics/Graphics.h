@@ -1,26 +1,126 @@
 #pragma once
 
 #include "Core/Window.h"
+#include "Core/ThreadPool.h"
 
 #include "Device.h"
 #include "SwapChain.h"
 #include "GraphicsPipeline.h"
+#include "PipelineRegistry.h"
 #include "Command.h"
+#include "CommandRecorder.h"
+#include "Upload.h"
+#include "GpuProfiler.h"
 #include "Buffer.h"
 #include "Image.h"
+#include "TextureStreamer.h"
 #include "Model.h"
+#include "Scene.h"
+#include "GeometryPool.h"
+#include "IndirectRenderer.h"
+#include "MeshletRenderer.h"
 #include "Descriptor.h"
 
+struct DrawItem {
+	Model* Mesh;
+	uint32_t UniformOffset;
+	uint32_t FirstInstance;
+	uint32_t InstanceCount;
+	uint32_t Lod;
+};
+
+enum class RenderPath {
+	//One instanced draw per model
+	Instanced,
+	//One draw per entity, kept for comparison
+	PerEntity,
+	//Compute culling writes the draws, submitted with one indirect call
+	Indirect,
+	//Like Indirect, but culls each object's meshlets too and draws only the surviving index ranges
+	Meshlet
+};
+
+struct FrameStats {
+	uint32_t DrawCalls;
+	uint32_t Instances;
+	//Time Present spent working, leaving out PresentWaitMs
+	float CpuTimeMs;
+	//The "frame" GPU profiler scope around the frame's command buffer, so MAX_FRAMES_IN_FLIGHT frames late; 0 where the
+	//device cannot time it
+	float GpuTimeMs;
+	//Inside vkQueueSubmit
+	float SubmitMs;
+	//Blocked on the frame's fence, on acquiring the image and on presenting it
+	float PresentWaitMs;
+	//Meshlet path only, read back from the GPU a few frames late
+	uint32_t ClustersTested;
+	uint32_t ClustersVisible;
+};
+
+struct PipelineStats {
+	//Graphics::Init from start to the first frame being ready
+	float StartupMs;
+	//Duration of the latest swap chain resize, not counting any wait for the window to be restored; the GPU is not drained,
+	//so this is CPU time only
+	float LastRecreateMs;
+	uint32_t RecreateCount;
+	//Swap chains set aside by resizes whose frames have not completed yet; stays small unless they are never released
+	uint32_t RetiredSwapChains;
+	//Duration of the latest RebuildPipelines
+	float LastRebuildMs;
+	PipelineCacheStats Cache;
+	PipelineRegistryStats Registry;
+};
+
+struct DecodedMesh {
+	bool Loaded = false;
+	PackedMesh Mesh;
+};
+
+//Model still decoding on a worker or uploading; its entities draw the placeholder until the geometry is resident
+struct PendingModel {
+	std::string Path;
+	JobFuture<DecodedMesh> Decode;
+	//Set once the decoded mesh has been recorded into an upload batch
+	RefPtr<Model> Mesh;
+	std::vector<EntityID> Entities;
+};
+
 struct SceneData {
 	std::vector<VkPushConstantRange> PushConstants;
 	RefPtr<class GraphicsPipeline> Pipeline;
-	RefPtr<Image> Texture;
-	RefPtr<Sampler> Sampler;
-	std::vector<ScopedPtr<UniformBuffer>> UBuffers;
+	ScopedPtr<TextureStreamer> Streamer;
+	RefPtr<StreamedTexture> Texture;
+	RefPtr<Sampler> TextureSampler;
+	ScopedPtr<UniformBuffer> UBuffer;
 	RefPtr<DescriptorSetLayout> DescSetLayout;
 	RefPtr<class DescriptorPool> DescPool;
-	std::vector<VkDescriptorSet> DescSets;
-	ScopedPtr<Model> Room;
+	//One set per frame in flight, so a streamed texture's view can change without touching a set the GPU still reads
+	std::vector<VkDescriptorSet> FrameDescSets;
+	std::vector<VkImageView> FrameViews;
+	//The current frame's set
+	VkDescriptorSet DescSet;
+	std::unordered_map<std::string, RefPtr<Model>> Models;
+	RefPtr<Model> Placeholder;
+	std::vector<PendingModel> PendingModels;
+	std::chrono::high_resolution_clock::time_point LoadStart;
+	//Every model shares the pipelines and the geometry pool, so they all pack to this one format
+	VertexFormat Format;
+	VertexLayout Layout;
+	ScopedPtr<Scene> World;
+	ScopedPtr<InstanceBuffer> Instances;
+	ScopedPtr<GeometryPool> Geometry;
+	ScopedPtr<IndirectRenderer> Indirect;
+	ScopedPtr<MeshletRenderer> Meshlets;
+	VertexLayout IndirectLayout;
+	RefPtr<class GraphicsPipeline> IndirectPipeline;
+	RenderPath Path = RenderPath::Instanced;
+	std::vector<DrawItem> DrawList;
+	//Scratch for regrouping a batch's transforms by the LOD each instance selects
+	std::array<std::vector<glm::mat4>, MESH_LOD_COUNT> LodTransforms;
+	FrameStats Stats;
+	glm::vec3 CameraEye = glm::vec3(2.0f, 2.0f, 2.0f);
+	glm::vec3 CameraTarget = glm::vec3(0.0f);
 };
 
 struct GraphicsObjects {
@@ -28,10 +128,18 @@ struct GraphicsObjects {
 	ScopedPtr<SwapChain> SC;
 	VkCommandPool CommandPool;
 	std::vector<VkCommandBuffer> CBuffers;
+	RefPtr<ThreadPool> Workers;
+	ScopedPtr<CommandRecorder> Recorder;
+	ScopedPtr<PipelineRegistry> Pipelines;
+	//Recreate the swap chain after the next present even though the window did not change
+	bool SwapChainInvalid = false;
+	PipelineStats Timing{};
 	std::vector<VkSemaphore> ImageAvailSemaphores;
 	std::vector<VkSemaphore> RenderFinishSemaphores;
 	std::vector<VkFence> InFlightFences;
 	std::vector<VkFence> ImagesInFlightFenches;
+	//Frames submitted so far; frame n is fenced by InFlightFences[n % MAX_FRAMES_IN_FLIGHT]
+	uint64_t FrameCount = 0;
 };
 
 class Graphics {
@@ -40,7 +148,34 @@ public:
 	static void Present(ScopedPtr<class Window>& window, float deltaTime);
 	static void Shutdown();
 
+	static Scene& GetScene();
+	//Loads a model once and shares it between every entity that draws it
+	static RefPtr<Model> LoadModel(const std::string& path);
+	//Creates an entity right away that draws a placeholder while the model decodes on the workers, then switches over
+	//once its geometry is resident; the entity keeps its ID throughout
+	static EntityID SpawnModel(const std::string& path, const glm::mat4& transform = glm::mat4(1.0f));
+	//The GPU-driven paths fall back to Instanced on devices that cannot run them
+	static void SetRenderPath(RenderPath path);
+	static RenderPath GetRenderPath();
+	//Z is up; the default looks at the origin from (2, 2, 2)
+	static void SetCamera(const glm::vec3& eye, const glm::vec3& target);
+	static void SetTextureBudget(VkDeviceSize bytes);
+	//True once every spawned model has switched from the placeholder, the streamer has no loads left and no upload is in flight
+	static bool IsSceneResident();
+	static const FrameStats& GetFrameStats();
+	static PipelineStats GetPipelineStats();
+	static const VkPhysicalDeviceProperties& GetDeviceProperties();
+	//Forces a swap chain recreation after the next present, to measure how long one takes
+	static void InvalidateSwapChain();
+	//Destroys and recreates the scene's graphics pipelines, as a shader reload would
+	static void RebuildPipelines();
+	//Drops every compiled pipeline from the pipeline cache, so the next ones are built cold
+	static void ResetPipelineCache();
+
 private:
 	static void RecreateSwapChain(ScopedPtr<class Window>& window);
 	static void CleanupSwapChain();
+	static void CreatePipelines();
+	static void UpdatePendingModels();
+	static void UploadPendingModel(PendingModel& pending);
 };
\ No newline at end of file
@@ -1,4 +1,8 @@
 #pragma once
 
-#include <Vulkan/vulkan.h>
+#include <vulkan/vulkan.h>
+
+//glm is configured once here so every translation unit agrees on radians and Vulkan's zero-to-one depth range
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define RAYD_VK_VALIDATE(result, errMsg) RAYD_ASSERT(result == VK_SUCCESS, errMsg)
\ No newline at end of file
@@ -9,9 +9,14 @@
 
 GraphicsPipeline::GraphicsPipeline(RefPtr<Device> device, ScopedPtr<SwapChain>& swapChain, RefPtr<DescriptorSetLayout> descSetLayout,
     const std::string& vertShaderPath, const std::string& fragShaderPath, const std::vector<VkPushConstantRange>& pushConstants, VertexLayout& vlayout)
-	:m_Device(device)
+    :GraphicsPipeline(device, swapChain, descSetLayout, Shader(device, vertShaderPath, fragShaderPath), pushConstants, vlayout)
+{
+}
+
+GraphicsPipeline::GraphicsPipeline(RefPtr<Device> device, ScopedPtr<SwapChain>& swapChain, RefPtr<DescriptorSetLayout> descSetLayout,
+    const Shader& shader, const std::vector<VkPushConstantRange>& pushConstants, VertexLayout& vlayout)
+    :m_Device(device)
 {
-	Shader shader(m_Device, vertShaderPath, fragShaderPath);
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -32,7 +37,7 @@ GraphicsPipeline::GraphicsPipeline(RefPtr<Device> device, ScopedPtr<SwapChain>&
     auto& bindingDescriptions = vlayout.GetBindings();
     auto& attributeDescriptions = vlayout.GetAttributes();
 
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
@@ -42,24 +47,17 @@ GraphicsPipeline::GraphicsPipeline(RefPtr<Device> device, ScopedPtr<SwapChain>&
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)swapChain->GetExtent().width;
-    viewport.height = (float)swapChain->GetExtent().height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapChain->GetExtent();
-
+    //Viewport and scissor are set while recording, so a resize never invalidates the pipeline
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -119,12 +117,17 @@ GraphicsPipeline::GraphicsPipeline(RefPtr<Device> device, ScopedPtr<SwapChain>&
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = m_Layout;
     pipelineInfo.renderPass = swapChain->GetRenderPass();
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    RAYD_VK_VALIDATE(vkCreateGraphicsPipelines(m_Device->GetDeviceHandle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline), "Failed to create graphics pipeline!");
+    PipelineCache& cache = m_Device->GetPipelineCache();
+    auto start = std::chrono::high_resolution_clock::now();
+    VkResult result = vkCreateGraphicsPipelines(m_Device->GetDeviceHandle(), cache.GetHandle(), 1, &pipelineInfo, nullptr, &m_Pipeline);
+    RAYD_VK_VALIDATE(result, "Failed to create graphics pipeline!");
+    cache.RecordCreation(std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
 }
 
 GraphicsPipeline::~GraphicsPipeline()
@@ -133,3 +136,19 @@ GraphicsPipeline::~GraphicsPipeline()
     vkDestroyPipelineLayout(m_Device->GetDeviceHandle(), m_Layout, nullptr);
 }
 
+void GraphicsPipeline::SetViewport(VkCommandBuffer cbuff, VkExtent2D extent)
+{
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)extent.width;
+    viewport.height = (float)extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cbuff, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+    vkCmdSetScissor(cbuff, 0, 1, &scissor);
+}
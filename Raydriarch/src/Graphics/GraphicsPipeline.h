@@ -1,19 +1,26 @@
 #pragma once
 
-#include "Core/Window.h"
+#include "SwapChain.h"
 #include "Device.h"
 #include "Shader.h"
 #include "Descriptor.h"
 
+//Viewport and scissor are dynamic state; every command buffer drawing with the pipeline sets them with SetViewport
 class GraphicsPipeline {
 public:
 	GraphicsPipeline(RefPtr<Device> device, ScopedPtr<SwapChain>& swapChain, RefPtr<DescriptorSetLayout> descSetLayout, 
 		const std::string& vertShaderPath, const std::string& fragShaderPath, const std::vector<VkPushConstantRange>& pushConstants, VertexLayout& vlayout);
+	//Builds from modules already loaded, so pipelines sharing shaders read their SPIR-V once
+	GraphicsPipeline(RefPtr<Device> device, ScopedPtr<SwapChain>& swapChain, RefPtr<DescriptorSetLayout> descSetLayout,
+		const Shader& shader, const std::vector<VkPushConstantRange>& pushConstants, VertexLayout& vlayout);
 	~GraphicsPipeline();
 
 	inline VkPipeline& GetPipelineHandle() { return m_Pipeline; }
 	inline VkPipelineLayout& GetLayoutHandle() { return m_Layout; }
 
+	//Covers the whole extent, the state the pipelines used to bake in
+	static void SetViewport(VkCommandBuffer cbuff, VkExtent2D extent);
+
 
 private:
 	RefPtr<Device> m_Device;
@@ -1,37 +1,46 @@
 #include "raydpch.h"
 #include "Image.h"
+
+#include "GpuProfiler.h"
 #include "Command.h"
 
-#include <stb_image.h>
+static const ResourceMetrics s_ImageMetrics = { Metrics::Register("image.live", MetricKind::Gauge), Metrics::Register("image.bytes", MetricKind::Gauge) };
 
-Image::Image(RefPtr<Device> device, const std::string& filepath)
+VkFormat Image::GetTextureFormat(TextureFormat format, bool srgb)
 {
-	m_Device = device;
-
-    int32_t numChannels = 0;
-	stbi_uc* data = stbi_load(filepath.c_str(), reinterpret_cast<int32_t*>(&m_Width), reinterpret_cast<int32_t*>(&m_Height), 
-        &numChannels, STBI_rgb_alpha);
-    RAYD_ASSERT(data, "Failed to load file " + filepath);
-    m_MipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(m_Width, m_Height)))) + 1;
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	VkDeviceSize size = m_Width * m_Height * 4;
-	Buffer::Create(stagingBuffer, stagingBufferMemory, size, 
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	Map(stagingBufferMemory, size, data);
-	stbi_image_free(data);
+    switch (format) {
+    case TextureFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case TextureFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case TextureFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case TextureFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    case TextureFormat::RGBA8: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
 
-    Create(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_SAMPLE_COUNT_1_BIT);
-    Transition(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    CopyFromBuffer(stagingBuffer);
+Image::Image(RefPtr<Device> device, const std::string& filepath, TextureFormat format, bool srgb, ThreadPool* workers)
+{
+	RAYD_PROFILE_SCOPE("Image::Image");
+	m_Device = device;
 
-    vkDestroyBuffer(m_Device->GetDeviceHandle(), stagingBuffer, nullptr);
-    vkFreeMemory(m_Device->GetDeviceHandle(), stagingBufferMemory, nullptr);
+    //Two-channel data is never colour; devices without BC sampling get the same precomputed chain uncompressed
+    srgb = srgb && format != TextureFormat::BC5;
+    if (!m_Device->SupportsTextureCompressionBC())
+        format = TextureFormat::RGBA8;
+
+    //The cache is mapped and copied straight into staging memory; the source is only decoded when it is missing or stale
+    TextureCache cache(TextureCache::GetCachePath(filepath), filepath, format, srgb);
+    if (cache.IsValid()) {
+        auto& header = cache.GetHeader();
+        CreateFromLevels(GetTextureFormat(format, srgb), cache.GetData(), header.DataSize, header.Levels, header.LevelCount);
+        return;
+    }
 
-    m_View = CreateImageView(m_Device, m_Image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, m_MipLevels);
-    GenerateMipmaps(VK_FORMAT_R8G8B8A8_SRGB);
+    BakedTexture texture;
+    if (!TextureCache::Bake(filepath, format, srgb, texture, workers))
+        throw std::runtime_error("Failed to load file " + filepath);
+    CreateFromLevels(GetTextureFormat(format, srgb), texture.Data.data(), texture.Data.size(), texture.Levels.data(),
+        static_cast<uint32_t>(texture.Levels.size()));
 }
 
 Image::Image(RefPtr<Device> device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, 
@@ -48,6 +57,19 @@ Image::Image(RefPtr<Device> device, uint32_t width, uint32_t height, VkFormat fo
     if(m_MipLevels > 1) GenerateMipmaps(format);
 }
 
+Image::Image(RefPtr<Device> device, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels)
+{
+    m_Device = device;
+    m_Width = width;
+    m_Height = height;
+    m_MipLevels = mipLevels;
+
+    //Transfer source too, so a replacement with more or fewer levels can copy the ones they share on the GPU
+    Create(format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_SAMPLE_COUNT_1_BIT);
+    m_View = CreateImageView(m_Device, m_Image, format, VK_IMAGE_ASPECT_COLOR_BIT, m_MipLevels);
+}
+
 Image::~Image()
 {
     vkDestroyImageView(m_Device->GetDeviceHandle(), m_View, nullptr);
@@ -89,13 +111,23 @@ void Image::Create(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usag
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.samples = sampleCount;
 
+    auto& queueFamilies = m_Device->GetQueueFamilies();
+    uint32_t queueFamilyIndices[] = { *queueFamilies.Graphics.Index, *queueFamilies.Transfer.Index };
+    if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && m_Device->HasDedicatedTransferQueue()) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = 2;
+        imageInfo.pQueueFamilyIndices = queueFamilyIndices;
+    }
+
     RAYD_VK_VALIDATE(vkCreateImage(m_Device->GetDeviceHandle(), &imageInfo, nullptr, &m_Image), "Failed to create image!");
 
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_Device->GetDeviceHandle(), m_Image, &memRequirements);
 
-    Allocate(m_Memory, memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    vkBindImageMemory(m_Device->GetDeviceHandle(), m_Image, m_Memory, 0);
+    Allocate(m_Allocation, memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::Optimal : AllocationKind::Linear);
+    vkBindImageMemory(m_Device->GetDeviceHandle(), m_Image, m_Allocation.Memory, m_Allocation.Offset);
+    Track(s_ImageMetrics);
 }
 
 void Image::GenerateMipmaps(VkFormat format)
@@ -105,7 +137,8 @@ void Image::GenerateMipmaps(VkFormat format)
 
     RAYD_ASSERT(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT, "Texture image format does not support linear blitting!");
 
-    VkCommandBuffer commandBuffer = Command::BeginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = Upload::GetGraphicsCommands();
+    GpuScope scope(commandBuffer, "mip generation");
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -126,7 +159,7 @@ void Image::GenerateMipmaps(VkFormat format)
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-        vkCmdPipelineBarrier(commandBuffer,
+        Command::PipelineBarrier(commandBuffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
             0, nullptr,
             0, nullptr,
@@ -157,7 +190,7 @@ void Image::GenerateMipmaps(VkFormat format)
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        vkCmdPipelineBarrier(commandBuffer,
+        Command::PipelineBarrier(commandBuffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
             0, nullptr,
             0, nullptr,
@@ -173,13 +206,13 @@ void Image::GenerateMipmaps(VkFormat format)
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    vkCmdPipelineBarrier(commandBuffer,
+    Command::PipelineBarrier(commandBuffer,
         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
         0, nullptr,
         0, nullptr,
         1, &barrier);
 
-    Command::EndSingleTimeCommands(commandBuffer);
+    m_UploadToken = Upload::GetPendingToken();
 }
 
 VkFormat Image::GetSupportedFormat(RefPtr<Device> device, const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -196,12 +229,12 @@ VkFormat Image::GetSupportedFormat(RefPtr<Device> device, const std::vector<VkFo
     RAYD_ERROR("Failed to find supported image format!");
 }
 
-void Image::CopyFromBuffer(VkBuffer buffer)
+void Image::CopyFromBuffer(VkBuffer buffer, VkDeviceSize offset)
 {
-    VkCommandBuffer commandBuffer = Command::BeginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = Upload::GetTransferCommands();
 
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = offset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -217,12 +250,67 @@ void Image::CopyFromBuffer(VkBuffer buffer)
 
     vkCmdCopyBufferToImage(commandBuffer, buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-    Command::EndSingleTimeCommands(commandBuffer);
+    m_UploadToken = Upload::GetPendingToken();
+}
+
+void Image::CreateFromLevels(VkFormat format, const uint8_t* data, VkDeviceSize size, const TextureCacheLevel* levels, uint32_t levelCount)
+{
+    RAYD_PROFILE_SCOPE("Image::CreateFromLevels");
+    m_Width = levels[0].Width;
+    m_Height = levels[0].Height;
+    m_MipLevels = levelCount;
+
+    //Level offsets keep the cache's alignment, so the staged blob can be addressed exactly like the file
+    StagingRegion staging = Upload::Stage(data, size, TEXTURE_CACHE_ALIGNMENT);
+
+    Create(format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_SAMPLE_COUNT_1_BIT);
+    Transition(format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    CopyLevels(staging, levels, 0, levelCount);
+    Transition(format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    m_View = CreateImageView(m_Device, m_Image, format, VK_IMAGE_ASPECT_COLOR_BIT, m_MipLevels);
+}
+
+void Image::CopyLevels(const StagingRegion& staging, const TextureCacheLevel* levels, uint32_t baseMip, uint32_t levelCount)
+{
+    std::vector<VkBufferImageCopy> regions(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        regions[i].bufferOffset = staging.Offset + levels[i].Offset - levels[0].Offset;
+        regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        regions[i].imageSubresource.mipLevel = baseMip + i;
+        regions[i].imageSubresource.baseArrayLayer = 0;
+        regions[i].imageSubresource.layerCount = 1;
+        //Extents are in texels; the copy covers partial edge blocks because each level reaches the image border
+        regions[i].imageExtent = { levels[i].Width, levels[i].Height, 1 };
+    }
+    vkCmdCopyBufferToImage(Upload::GetTransferCommands(), staging.Buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data());
+
+    m_UploadToken = Upload::GetPendingToken();
 }
 
-void Image::Transition(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+void Image::CopyLevels(Image& source, uint32_t sourceMip, uint32_t baseMip, uint32_t levelCount)
 {
-    VkCommandBuffer commandBuffer = Command::BeginSingleTimeCommands();
+    //The source is sampled by earlier frames, so the copy is ordered after them on the graphics queue
+    std::vector<VkImageCopy> regions(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        regions[i].srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        regions[i].srcSubresource.mipLevel = sourceMip + i;
+        regions[i].srcSubresource.baseArrayLayer = 0;
+        regions[i].srcSubresource.layerCount = 1;
+        regions[i].dstSubresource = regions[i].srcSubresource;
+        regions[i].dstSubresource.mipLevel = baseMip + i;
+        regions[i].extent = { std::max(m_Width >> (baseMip + i), 1u), std::max(m_Height >> (baseMip + i), 1u), 1 };
+    }
+    vkCmdCopyImage(Upload::GetGraphicsCommands(), source.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        levelCount, regions.data());
+
+    m_UploadToken = Upload::GetPendingToken();
+}
+
+void Image::Transition(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMip, uint32_t levelCount)
+{
+    //Only transitions into or out of shader-readable layouts touch graphics stages
+    VkCommandBuffer commandBuffer = newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL || oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ?
+        Upload::GetGraphicsCommands() : Upload::GetTransferCommands();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -232,8 +320,8 @@ void Image::Transition(VkFormat format, VkImageLayout oldLayout, VkImageLayout n
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = m_Image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = m_MipLevels;
+    barrier.subresourceRange.baseMipLevel = baseMip;
+    barrier.subresourceRange.levelCount = levelCount;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -254,11 +342,18 @@ void Image::Transition(VkFormat format, VkImageLayout oldLayout, VkImageLayout n
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     }
+    else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
     else {
         throw std::invalid_argument("unsupported layout transition!");
     }
 
-    vkCmdPipelineBarrier(
+    Command::PipelineBarrier(
         commandBuffer,
         sourceStage, destinationStage,
         0,
@@ -267,7 +362,7 @@ void Image::Transition(VkFormat format, VkImageLayout oldLayout, VkImageLayout n
         1, &barrier
     );
 
-    Command::EndSingleTimeCommands(commandBuffer);
+    m_UploadToken = Upload::GetPendingToken();
 }
 
 Sampler::Sampler(RefPtr<Device> device, uint32_t mipLevels)
@@ -2,6 +2,8 @@
 
 #include "GraphicsCore.h"
 #include "Buffer.h"
+#include "Core/ThreadPool.h"
+#include "Asset/TextureCache.h"
 
 class Sampler {
 public:
@@ -15,10 +17,15 @@ private:
 
 class Image : public Buffer {
 public:
-	Image(RefPtr<Device> device, const std::string& filepath);
+	//Uploads the baked mip chain, baking it on first use with the workers when given; devices without BC support get the
+	//chain as RGBA8. BC5 ignores srgb.
+	Image(RefPtr<Device> device, const std::string& filepath, TextureFormat format = TextureFormat::BC7, bool srgb = true, ThreadPool* workers = nullptr);
 	Image(RefPtr<Device> device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, 
 		VkImageUsageFlags usage, VkImageAspectFlags aspect, VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT, uint32_t mipLevels = 1);
+	//Empty sampled texture with exactly mipLevels levels, left undefined for the caller to fill level by level
+	Image(RefPtr<Device> device, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels);
 	~Image();
+	static VkFormat GetTextureFormat(TextureFormat format, bool srgb);
 	static VkImageView CreateImageView(RefPtr<Device> device, VkImage& img, VkFormat fmt, VkImageAspectFlags aspect, uint32_t mipLevels);
 	static VkFormat GetSupportedFormat(RefPtr<Device> device, const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags features);
 	static VkFormat GetDepthFormat(RefPtr<Device> device) {
@@ -28,11 +35,19 @@ public:
 	inline const VkImage& GetImageHandle() { return m_Image; }
 	inline const VkImageView& GetViewHandle() { return m_View; }
 	inline uint32_t MipLevelSize() const { return m_MipLevels; }
+
+	//Barrier over levels [baseMip, baseMip + levelCount) only, so levels can change layout independently
+	void Transition(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMip = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
+	//Copies staged levels into [baseMip, baseMip + levelCount); level offsets are taken relative to the first one
+	void CopyLevels(const StagingRegion& staging, const TextureCacheLevel* levels, uint32_t baseMip, uint32_t levelCount);
+	//Copies levels of an image holding the same chain, starting at sourceMip there, without going through staging
+	void CopyLevels(Image& source, uint32_t sourceMip, uint32_t baseMip, uint32_t levelCount);
 protected:
 	void Create(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkSampleCountFlagBits sampleCount);
 	void GenerateMipmaps(VkFormat format);
-	void CopyFromBuffer(VkBuffer buffer);
-	void Transition(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+	void CopyFromBuffer(VkBuffer buffer, VkDeviceSize offset);
+	//Stages every level at once and copies them with a single command, one region per level
+	void CreateFromLevels(VkFormat format, const uint8_t* data, VkDeviceSize size, const TextureCacheLevel* levels, uint32_t levelCount);
 protected:
 	VkImage m_Image;
 	VkImageView m_View;
@@ -0,0 +1,168 @@
+#include "raydpch.h"
+#include "IndirectRenderer.h"
+
+#include "Command.h"
+
+#define CULL_GROUP_SIZE 64
+#define CULL_BINDING_COUNT 5
+
+struct CullConstants {
+	glm::vec4 Planes[6];
+	//The w component carries the LOD scale
+	glm::vec4 Eye;
+	uint32_t ObjectBase;
+	uint32_t ObjectCount;
+	uint32_t Compact;
+};
+
+static inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+IndirectRenderer::IndirectRenderer(RefPtr<Device> device, GeometryPool& geometry, uint32_t maxObjects, uint32_t frameCount)
+	:m_Device(device), m_Geometry(geometry), m_MaxObjects(maxObjects), m_ObjectCount(0)
+{
+	RAYD_ASSERT(m_Device->GetQueueFamilies().Graphics.Properties.queueFlags & VK_QUEUE_COMPUTE_BIT, "Graphics queue cannot run the culling pass!");
+
+	//Each frame in flight gets its own command and count region, bound at an aligned descriptor offset
+	VkDeviceSize alignment = m_Device->GetProperties().limits.minStorageBufferOffsetAlignment;
+	m_DrawStride = AlignUp(sizeof(VkDrawIndexedIndirectCommand) * maxObjects, alignment);
+	m_CountStride = AlignUp(sizeof(uint32_t), alignment);
+
+	m_Objects = MakeScopedPtr<InstanceBuffer>(m_Device, sizeof(GpuObject), maxObjects, frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_Draws = MakeScopedPtr<DeviceBuffer>(m_Device, m_DrawStride * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+	m_Counts = MakeScopedPtr<DeviceBuffer>(m_Device, m_CountStride * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings(CULL_BINDING_COUNT);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].pImmutableSamplers = nullptr;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	m_SetLayout = MakeRefPtr<DescriptorSetLayout>(m_Device, bindings);
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CULL_BINDING_COUNT * frameCount });
+	m_DescPool = MakeScopedPtr<DescriptorPool>(m_Device, frameCount, poolSizes);
+
+	m_DescSets = m_DescPool->Allocate(m_SetLayout->GetHandle(), frameCount);
+
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		std::array<VkDescriptorBufferInfo, CULL_BINDING_COUNT> bufferInfos{};
+		bufferInfos[0] = { m_Objects->GetBufferHandle(), 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { m_Geometry.GetMeshBuffer().GetBufferHandle(), 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { m_Draws->GetBufferHandle(), m_DrawStride * frame, m_DrawStride };
+		bufferInfos[3] = { m_Counts->GetBufferHandle(), m_CountStride * frame, sizeof(uint32_t) };
+		bufferInfos[4] = { m_Geometry.GetLodBuffer().GetBufferHandle(), 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, CULL_BINDING_COUNT> descriptorWrites{};
+		for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = m_DescSets[frame];
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(m_Device->GetDeviceHandle(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+	std::vector<VkPushConstantRange> pushConstants(1);
+	pushConstants[0].offset = 0;
+	pushConstants[0].size = sizeof(CullConstants);
+	pushConstants[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	m_Pipeline = MakeScopedPtr<ComputePipeline>(m_Device, m_SetLayout, "res/shaders/cull.spv", pushConstants);
+
+	m_FrameObjects.reserve(maxObjects);
+}
+
+void IndirectRenderer::AddInstanceAttributes(VertexLayout& layout, uint32_t binding, uint32_t firstLocation)
+{
+	for (uint32_t column = 0; column < 4; column++)
+		layout.AddAttribute(firstLocation + column, binding, VK_FORMAT_R32G32B32A32_SFLOAT);
+	layout.AddBinding(binding, sizeof(GpuObject), VK_VERTEX_INPUT_RATE_INSTANCE);
+}
+
+void IndirectRenderer::ExtractFrustumPlanes(const glm::mat4& worldToClip, glm::vec4 planes[6])
+{
+	glm::mat4 rows = glm::transpose(worldToClip);
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[2];
+	planes[5] = rows[3] - rows[2];
+	for (uint32_t i = 0; i < 6; i++)
+		planes[i] = planes[i] / glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+}
+
+void IndirectRenderer::Cull(VkCommandBuffer cbuff, uint32_t frame, const Scene& scene, const CullView& view)
+{
+	m_FrameObjects.clear();
+	for (auto& batch : scene.GetBatches()) {
+		if (!batch.Mesh->IsPooled())
+			continue;
+
+		GpuObject object{};
+		object.Mesh = batch.Mesh->GetPoolMesh();
+		for (auto& transform : batch.Transforms) {
+			object.Transform = transform;
+			m_FrameObjects.push_back(object);
+		}
+	}
+	m_ObjectCount = static_cast<uint32_t>(m_FrameObjects.size());
+
+	m_Objects->BeginFrame(frame);
+	uint32_t objectBase = m_Objects->Push(m_FrameObjects.data(), m_ObjectCount);
+
+	CullConstants constants{};
+	ExtractFrustumPlanes(view.WorldToClip, constants.Planes);
+	constants.Eye = glm::vec4(view.Eye, view.LodScale);
+	constants.ObjectBase = objectBase;
+	constants.ObjectCount = m_ObjectCount;
+	constants.Compact = m_Device->SupportsDrawIndirectCount();
+
+	vkCmdFillBuffer(cbuff, m_Counts->GetBufferHandle(), m_CountStride * frame, sizeof(uint32_t), 0);
+
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	Command::PipelineBarrier(cbuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	if (m_ObjectCount > 0) {
+		vkCmdBindPipeline(cbuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline->GetPipelineHandle());
+		vkCmdBindDescriptorSets(cbuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline->GetLayoutHandle(), 0, 1, &m_DescSets[frame], 0, nullptr);
+		vkCmdPushConstants(cbuff, m_Pipeline->GetLayoutHandle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(cbuff, (m_ObjectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	}
+
+	VkMemoryBarrier drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	Command::PipelineBarrier(cbuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void IndirectRenderer::Draw(VkCommandBuffer cbuff, uint32_t frame, uint32_t instanceBinding)
+{
+	if (m_ObjectCount == 0)
+		return;
+
+	m_Geometry.Bind(cbuff);
+	m_Objects->Bind(cbuff, instanceBinding);
+
+	if (m_Device->SupportsDrawIndirectCount())
+		vkCmdDrawIndexedIndirectCount(cbuff, m_Draws->GetBufferHandle(), m_DrawStride * frame, m_Counts->GetBufferHandle(), m_CountStride * frame,
+			m_ObjectCount, sizeof(VkDrawIndexedIndirectCommand));
+	else if (m_Device->SupportsMultiDrawIndirect())
+		vkCmdDrawIndexedIndirect(cbuff, m_Draws->GetBufferHandle(), m_DrawStride * frame, m_ObjectCount, sizeof(VkDrawIndexedIndirectCommand));
+	else
+		for (uint32_t i = 0; i < m_ObjectCount; i++)
+			vkCmdDrawIndexedIndirect(cbuff, m_Draws->GetBufferHandle(), m_DrawStride * frame + i * sizeof(VkDrawIndexedIndirectCommand), 1, 0);
+}
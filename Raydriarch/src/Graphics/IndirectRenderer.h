@@ -0,0 +1,61 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Device.h"
+#include "Buffer.h"
+#include "Descriptor.h"
+#include "ComputePipeline.h"
+#include "GeometryPool.h"
+#include "Scene.h"
+
+//Laid out to match ObjectData in Cull.comp; the transform doubles as the per-instance vertex stream
+struct GpuObject {
+	glm::mat4 Transform;
+	uint32_t Mesh;
+	uint32_t Padding[3];
+};
+
+//What the culling passes need of the camera. The eye is in the same space as worldToClip's input, where the object
+//transforms land; LodScale turns an LOD's error at unit distance into pixels over the pixel budget, so a level is
+//coarse enough once error * LodScale stays under its distance
+struct CullView {
+	glm::mat4 WorldToClip;
+	glm::vec3 Eye;
+	float LodScale;
+};
+
+//GPU-driven path: a compute pass frustum culls every pooled object, picks its LOD and writes the indirect draws
+class IndirectRenderer {
+public:
+	IndirectRenderer(RefPtr<Device> device, GeometryPool& geometry, uint32_t maxObjects, uint32_t frameCount);
+
+	//Adds the instance stream the indirect draws read their transform from
+	static void AddInstanceAttributes(VertexLayout& layout, uint32_t binding, uint32_t firstLocation);
+	//Normalized frustum planes of a zero-to-one depth projection, taken from the rows of the combined matrix
+	static void ExtractFrustumPlanes(const glm::mat4& worldToClip, glm::vec4 planes[6]);
+
+	//Uploads the frame's objects and records the culling dispatch; must be recorded outside a render pass
+	void Cull(VkCommandBuffer cbuff, uint32_t frame, const Scene& scene, const CullView& view);
+	//Records the draws inside the render pass, with the graphics pipeline and its descriptors already bound
+	void Draw(VkCommandBuffer cbuff, uint32_t frame, uint32_t instanceBinding);
+
+	inline uint32_t GetObjectCount() const { return m_ObjectCount; }
+private:
+	RefPtr<Device> m_Device;
+	GeometryPool& m_Geometry;
+
+	uint32_t m_MaxObjects;
+	uint32_t m_ObjectCount;
+	std::vector<GpuObject> m_FrameObjects;
+
+	ScopedPtr<InstanceBuffer> m_Objects;
+	ScopedPtr<DeviceBuffer> m_Draws;
+	ScopedPtr<DeviceBuffer> m_Counts;
+	VkDeviceSize m_DrawStride;
+	VkDeviceSize m_CountStride;
+
+	RefPtr<DescriptorSetLayout> m_SetLayout;
+	ScopedPtr<DescriptorPool> m_DescPool;
+	std::vector<VkDescriptorSet> m_DescSets;
+	ScopedPtr<ComputePipeline> m_Pipeline;
+};
@@ -0,0 +1,264 @@
+#include "raydpch.h"
+#include "MemoryAllocator.h"
+
+static const MetricID s_AllocateMetric = Metrics::Register("memory.allocations", MetricKind::Counter);
+static const MetricID s_FreeMetric = Metrics::Register("memory.frees", MetricKind::Counter);
+
+static inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+MemoryBlock::MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped)
+	:m_Memory(memory), m_Size(size), m_Used(0), m_Mapped(mapped)
+{
+	m_FreeRanges.push_back({ 0, size });
+}
+
+bool MemoryBlock::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	for (size_t i = 0; i < m_FreeRanges.size(); i++) {
+		Range range = m_FreeRanges[i];
+		VkDeviceSize alignedOffset = AlignUp(range.Offset, alignment);
+		VkDeviceSize padding = alignedOffset - range.Offset;
+		if (padding + size > range.Size)
+			continue;
+
+		VkDeviceSize tailOffset = alignedOffset + size;
+		VkDeviceSize tailSize = range.Offset + range.Size - tailOffset;
+
+		m_FreeRanges.erase(m_FreeRanges.begin() + i);
+		if (tailSize > 0)
+			m_FreeRanges.insert(m_FreeRanges.begin() + i, { tailOffset, tailSize });
+		if (padding > 0)
+			m_FreeRanges.insert(m_FreeRanges.begin() + i, { range.Offset, padding });
+
+		m_Used += size;
+		offset = alignedOffset;
+		return true;
+	}
+
+	return false;
+}
+
+void MemoryBlock::Free(VkDeviceSize offset, VkDeviceSize size)
+{
+	auto next = std::lower_bound(m_FreeRanges.begin(), m_FreeRanges.end(), offset,
+		[](const Range& range, VkDeviceSize value) { return range.Offset < value; });
+	auto it = m_FreeRanges.insert(next, { offset, size });
+
+	auto after = it + 1;
+	if (after != m_FreeRanges.end() && it->Offset + it->Size == after->Offset) {
+		it->Size += after->Size;
+		it = m_FreeRanges.erase(after) - 1;
+	}
+
+	if (it != m_FreeRanges.begin()) {
+		auto before = it - 1;
+		if (before->Offset + before->Size == it->Offset) {
+			before->Size += it->Size;
+			m_FreeRanges.erase(it);
+		}
+	}
+
+	m_Used -= size;
+}
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+	:m_Device(device), m_BlockSize(blockSize), m_AllocationCount(0)
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemProps);
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	m_Granularity = props.limits.bufferImageGranularity;
+	m_MaxAllocations = props.limits.maxMemoryAllocationCount;
+
+	m_Pools.resize(m_MemProps.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < m_Pools.size(); i++) {
+		uint32_t memType = i / 2;
+		VkDeviceSize heapSize = m_MemProps.memoryHeaps[m_MemProps.memoryTypes[memType].heapIndex].size;
+
+		m_Pools[i].MemoryType = memType;
+		//Small heaps (e.g. the 256MB host-visible device-local window) get proportionally smaller blocks
+		m_Pools[i].BlockSize = std::min(m_BlockSize, AlignUp(heapSize / 8, 1024 * 1024));
+	}
+
+	m_HeapStats.resize(m_MemProps.memoryHeapCount);
+	for (uint32_t i = 0; i < m_MemProps.memoryHeapCount; i++) {
+		std::string heap = "memory.heap" + std::to_string(i);
+		m_HeapMetrics.emplace_back(Metrics::Register(heap + ".live_bytes", MetricKind::Gauge), Metrics::Register(heap + ".reserved_bytes", MetricKind::Gauge));
+	}
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (auto& pool : m_Pools) {
+		for (auto& block : pool.Blocks) {
+			if (!block->IsEmpty())
+				RAYD_WARN("Destroying memory block with live allocations!");
+			FreeMemory(pool.MemoryType, block->GetMemoryHandle(), block->GetSize());
+		}
+	}
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags memFlags) const
+{
+	for (uint32_t i = 0; i < m_MemProps.memoryTypeCount; i++) {
+		if ((typeBits & (1 << i)) && (m_MemProps.memoryTypes[i].propertyFlags & memFlags) == memFlags)
+			return i;
+	}
+
+	return UINT32_MAX;
+}
+
+Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memFlags, AllocationKind kind)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Allocation allocation;
+	allocation.MemoryType = FindMemoryType(memReqs.memoryTypeBits, memFlags);
+	allocation.Size = memReqs.size;
+	//Checked in every build, since the type indexes the pools and the device's memory properties below
+	if (allocation.MemoryType == UINT32_MAX) {
+		RAYD_ERROR("No memory type matches type bits {0:#x} with property flags {1:#x}!", memReqs.memoryTypeBits, memFlags);
+		throw std::runtime_error("Failed to find suitable memory type!");
+	}
+
+	uint32_t poolIndex = PoolIndex(allocation.MemoryType, kind);
+	Pool& pool = m_Pools[poolIndex];
+	auto& stats = m_HeapStats[m_MemProps.memoryTypes[allocation.MemoryType].heapIndex];
+
+	//Large resources get their own allocation instead of fragmenting a shared block
+	if (memReqs.size > pool.BlockSize / 2) {
+		allocation.Memory = AllocateMemory(allocation.MemoryType, memReqs.size, &allocation.Mapped);
+		stats.UsedBytes += allocation.Size;
+		stats.AllocationCount++;
+		ReportHeap(allocation.MemoryType);
+		return allocation;
+	}
+
+	allocation.Pool = poolIndex;
+	for (auto& block : pool.Blocks) {
+		if (block->Allocate(memReqs.size, memReqs.alignment, allocation.Offset)) {
+			allocation.Block = block.get();
+			break;
+		}
+	}
+
+	if (!allocation.Block) {
+		void* mapped = nullptr;
+		VkDeviceMemory memory = AllocateMemory(allocation.MemoryType, pool.BlockSize, &mapped);
+		pool.Blocks.push_back(MakeScopedPtr<MemoryBlock>(memory, pool.BlockSize, mapped));
+		stats.BlockCount++;
+
+		allocation.Block = pool.Blocks.back().get();
+		bool success = allocation.Block->Allocate(memReqs.size, memReqs.alignment, allocation.Offset);
+		RAYD_ASSERT(success, "Failed to sub-allocate from a fresh memory block!");
+	}
+
+	allocation.Memory = allocation.Block->GetMemoryHandle();
+	if (allocation.Block->GetMapped())
+		allocation.Mapped = static_cast<char*>(allocation.Block->GetMapped()) + allocation.Offset;
+
+	stats.UsedBytes += allocation.Size;
+	stats.AllocationCount++;
+	ReportHeap(allocation.MemoryType);
+	return allocation;
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+	if (allocation.Memory == VK_NULL_HANDLE)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto& stats = m_HeapStats[m_MemProps.memoryTypes[allocation.MemoryType].heapIndex];
+	stats.UsedBytes -= allocation.Size;
+	stats.AllocationCount--;
+
+	if (!allocation.Block) {
+		FreeMemory(allocation.MemoryType, allocation.Memory, allocation.Size);
+		ReportHeap(allocation.MemoryType);
+		allocation = Allocation();
+		return;
+	}
+
+	Pool& pool = m_Pools[allocation.Pool];
+	allocation.Block->Free(allocation.Offset, allocation.Size);
+
+	//Keep a single empty block around per pool so load/unload cycles don't thrash vkAllocateMemory
+	if (allocation.Block->IsEmpty()) {
+		uint32_t emptyBlocks = 0;
+		for (auto& block : pool.Blocks)
+			emptyBlocks += block->IsEmpty();
+
+		if (emptyBlocks > 1) {
+			auto it = std::find_if(pool.Blocks.begin(), pool.Blocks.end(),
+				[&](const ScopedPtr<MemoryBlock>& block) { return block.get() == allocation.Block; });
+			FreeMemory(pool.MemoryType, (*it)->GetMemoryHandle(), (*it)->GetSize());
+			pool.Blocks.erase(it);
+			stats.BlockCount--;
+		}
+	}
+
+	ReportHeap(allocation.MemoryType);
+	allocation = Allocation();
+}
+
+VkDeviceMemory MemoryAllocator::AllocateMemory(uint32_t memType, VkDeviceSize size, void** mapped)
+{
+	RAYD_ASSERT(m_AllocationCount < m_MaxAllocations, "Exceeded maxMemoryAllocationCount!");
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memType;
+
+	VkDeviceMemory memory;
+	VkResult result = vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory);
+	RAYD_VK_VALIDATE(result, "Failed to allocate memory!");
+	m_AllocationCount++;
+	Metrics::Add(s_AllocateMetric);
+	m_HeapStats[m_MemProps.memoryTypes[memType].heapIndex].BlockBytes += size;
+
+	//Host-visible memory stays mapped for its whole lifetime so sub-allocations never map/unmap
+	*mapped = nullptr;
+	if (m_MemProps.memoryTypes[memType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		result = vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+		RAYD_VK_VALIDATE(result, "Failed to map memory!");
+	}
+
+	return memory;
+}
+
+void MemoryAllocator::FreeMemory(uint32_t memType, VkDeviceMemory memory, VkDeviceSize size)
+{
+	vkFreeMemory(m_Device, memory, nullptr);
+	m_AllocationCount--;
+	Metrics::Add(s_FreeMetric);
+	m_HeapStats[m_MemProps.memoryTypes[memType].heapIndex].BlockBytes -= size;
+}
+
+void MemoryAllocator::ReportHeap(uint32_t memType)
+{
+	uint32_t heap = m_MemProps.memoryTypes[memType].heapIndex;
+	Metrics::Set(m_HeapMetrics[heap].first, static_cast<int64_t>(m_HeapStats[heap].UsedBytes));
+	Metrics::Set(m_HeapMetrics[heap].second, static_cast<int64_t>(m_HeapStats[heap].BlockBytes));
+}
+
+std::vector<HeapStats> MemoryAllocator::GetHeapStats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_HeapStats;
+}
+
+void MemoryAllocator::LogStats()
+{
+	auto stats = GetHeapStats();
+	for (uint32_t i = 0; i < stats.size(); i++) {
+		RAYD_INFO("Heap {0}: {1} blocks, {2} allocations, {3:.2f}/{4:.2f} MB used/reserved", i, stats[i].BlockCount, stats[i].AllocationCount,
+			stats[i].UsedBytes / (1024.0 * 1024.0), stats[i].BlockBytes / (1024.0 * 1024.0));
+	}
+}
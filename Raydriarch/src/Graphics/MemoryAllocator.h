@@ -0,0 +1,97 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Core/Metrics.h"
+
+//Buffers and linear images never share a block with optimal images, which keeps bufferImageGranularity satisfied
+enum class AllocationKind : uint8_t {
+	Linear = 0,
+	Optimal = 1
+};
+
+struct Allocation {
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	void* Mapped = nullptr;
+
+	uint32_t MemoryType = 0;
+	uint32_t Pool = UINT32_MAX;
+	class MemoryBlock* Block = nullptr;
+};
+
+struct HeapStats {
+	VkDeviceSize BlockBytes = 0;
+	VkDeviceSize UsedBytes = 0;
+	uint32_t BlockCount = 0;
+	uint32_t AllocationCount = 0;
+};
+
+class MemoryBlock {
+public:
+	MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+
+	bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void Free(VkDeviceSize offset, VkDeviceSize size);
+
+	inline bool IsEmpty() const { return m_Used == 0; }
+	inline VkDeviceMemory GetMemoryHandle() const { return m_Memory; }
+	inline VkDeviceSize GetSize() const { return m_Size; }
+	inline void* GetMapped() const { return m_Mapped; }
+private:
+	struct Range {
+		VkDeviceSize Offset;
+		VkDeviceSize Size;
+	};
+	VkDeviceMemory m_Memory;
+	VkDeviceSize m_Size;
+	VkDeviceSize m_Used;
+	void* m_Mapped;
+
+	//Sorted by offset so neighbours can be coalesced on free
+	std::vector<Range> m_FreeRanges;
+};
+
+class MemoryAllocator {
+public:
+	MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = 64 * 1024 * 1024);
+	~MemoryAllocator();
+	MemoryAllocator(const MemoryAllocator&) = delete;
+
+	//Throws std::runtime_error when no memory type satisfies both the requirements and the flags
+	Allocation Allocate(const VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memFlags, AllocationKind kind);
+	void Free(Allocation& allocation);
+
+	//UINT32_MAX when no type matches
+	uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags memFlags) const;
+	inline const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return m_MemProps; }
+
+	std::vector<HeapStats> GetHeapStats();
+	void LogStats();
+private:
+	struct Pool {
+		uint32_t MemoryType;
+		VkDeviceSize BlockSize;
+		std::vector<ScopedPtr<MemoryBlock>> Blocks;
+	};
+
+	VkDeviceMemory AllocateMemory(uint32_t memType, VkDeviceSize size, void** mapped);
+	void FreeMemory(uint32_t memType, VkDeviceMemory memory, VkDeviceSize size);
+	void ReportHeap(uint32_t memType);
+	inline uint32_t PoolIndex(uint32_t memType, AllocationKind kind) const {
+		return m_Granularity > 1 ? memType * 2 + static_cast<uint32_t>(kind) : memType * 2;
+	}
+private:
+	VkDevice m_Device;
+	VkPhysicalDeviceMemoryProperties m_MemProps;
+	VkDeviceSize m_Granularity;
+	VkDeviceSize m_BlockSize;
+	uint32_t m_MaxAllocations;
+	uint32_t m_AllocationCount;
+
+	std::vector<Pool> m_Pools;
+	std::vector<HeapStats> m_HeapStats;
+	//Live and reserved bytes of each heap
+	std::vector<std::pair<MetricID, MetricID>> m_HeapMetrics;
+	std::mutex m_Mutex;
+};
@@ -0,0 +1,172 @@
+#include "raydpch.h"
+#include "MeshletRenderer.h"
+
+#include "Command.h"
+
+#define MESHLET_BINDING_COUNT 8
+
+struct MeshletConstants {
+	glm::vec4 Planes[6];
+	//The w component carries the LOD scale
+	glm::vec4 Eye;
+	uint32_t ObjectBase;
+	uint32_t ObjectCount;
+	uint32_t Compact;
+	uint32_t IndexCapacity;
+};
+
+static inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+MeshletRenderer::MeshletRenderer(RefPtr<Device> device, GeometryPool& geometry, uint32_t maxObjects, uint32_t maxIndicesPerFrame, uint32_t frameCount)
+	:m_Device(device), m_Geometry(geometry), m_MaxObjects(maxObjects), m_MaxIndices(maxIndicesPerFrame), m_ObjectCount(0),
+	m_FrameRecorded(frameCount, false), m_Counters{}
+{
+	RAYD_ASSERT(m_Device->GetQueueFamilies().Graphics.Properties.queueFlags & VK_QUEUE_COMPUTE_BIT, "Graphics queue cannot run the meshlet pass!");
+
+	//Each frame in flight gets its own draw, index and counter region, bound at an aligned descriptor offset
+	VkDeviceSize alignment = m_Device->GetProperties().limits.minStorageBufferOffsetAlignment;
+	m_DrawStride = AlignUp(sizeof(VkDrawIndexedIndirectCommand) * maxObjects, alignment);
+	m_IndexStride = AlignUp(sizeof(uint32_t) * static_cast<VkDeviceSize>(maxIndicesPerFrame), alignment);
+	m_CounterStride = AlignUp(sizeof(MeshletCounters), alignment);
+
+	m_Objects = MakeScopedPtr<InstanceBuffer>(m_Device, sizeof(GpuObject), maxObjects, frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_Draws = MakeScopedPtr<DeviceBuffer>(m_Device, m_DrawStride * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+	m_Indices = MakeScopedPtr<DeviceBuffer>(m_Device, m_IndexStride * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	//The draw count doubles as the first counter, so the same host-visible buffer feeds the indirect count and the stats
+	m_CounterBuffer = MakeScopedPtr<ReadbackBuffer>(m_Device, m_CounterStride * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings(MESHLET_BINDING_COUNT);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].pImmutableSamplers = nullptr;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	m_SetLayout = MakeRefPtr<DescriptorSetLayout>(m_Device, bindings);
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MESHLET_BINDING_COUNT * frameCount });
+	m_DescPool = MakeScopedPtr<DescriptorPool>(m_Device, frameCount, poolSizes);
+
+	m_DescSets = m_DescPool->Allocate(m_SetLayout->GetHandle(), frameCount);
+
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		std::array<VkDescriptorBufferInfo, MESHLET_BINDING_COUNT> bufferInfos{};
+		bufferInfos[0] = { m_Objects->GetBufferHandle(), 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { m_Geometry.GetMeshBuffer().GetBufferHandle(), 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { m_Geometry.GetMeshletBuffer().GetBufferHandle(), 0, VK_WHOLE_SIZE };
+		bufferInfos[3] = { m_Geometry.GetIndexBuffer().GetBufferHandle(), 0, VK_WHOLE_SIZE };
+		bufferInfos[4] = { m_Draws->GetBufferHandle(), m_DrawStride * frame, m_DrawStride };
+		bufferInfos[5] = { m_Indices->GetBufferHandle(), m_IndexStride * frame, m_IndexStride };
+		bufferInfos[6] = { m_CounterBuffer->GetBufferHandle(), m_CounterStride * frame, sizeof(MeshletCounters) };
+		bufferInfos[7] = { m_Geometry.GetLodBuffer().GetBufferHandle(), 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, MESHLET_BINDING_COUNT> descriptorWrites{};
+		for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = m_DescSets[frame];
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(m_Device->GetDeviceHandle(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+	std::vector<VkPushConstantRange> pushConstants(1);
+	pushConstants[0].offset = 0;
+	pushConstants[0].size = sizeof(MeshletConstants);
+	pushConstants[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	m_Pipeline = MakeScopedPtr<ComputePipeline>(m_Device, m_SetLayout, "res/shaders/meshlet.spv", pushConstants);
+
+	m_FrameObjects.reserve(maxObjects);
+}
+
+void MeshletRenderer::Cull(VkCommandBuffer cbuff, uint32_t frame, const Scene& scene, const CullView& view)
+{
+	//The frame's fence has signaled, so the counters its last submission wrote are final
+	if (m_FrameRecorded[frame]) {
+		memcpy(&m_Counters, m_CounterBuffer->GetMapped() + m_CounterStride * frame, sizeof(MeshletCounters));
+		if (m_Counters.Overflowed > 0)
+			RAYD_WARN("Meshlet index region overflowed, {0} objects were skipped", m_Counters.Overflowed);
+	}
+	m_FrameRecorded[frame] = true;
+
+	m_FrameObjects.clear();
+	for (auto& batch : scene.GetBatches()) {
+		if (!batch.Mesh->IsPooled())
+			continue;
+
+		GpuObject object{};
+		object.Mesh = batch.Mesh->GetPoolMesh();
+		for (auto& transform : batch.Transforms) {
+			object.Transform = transform;
+			m_FrameObjects.push_back(object);
+		}
+	}
+	m_ObjectCount = static_cast<uint32_t>(m_FrameObjects.size());
+
+	m_Objects->BeginFrame(frame);
+	uint32_t objectBase = m_Objects->Push(m_FrameObjects.data(), m_ObjectCount);
+
+	MeshletConstants constants{};
+	IndirectRenderer::ExtractFrustumPlanes(view.WorldToClip, constants.Planes);
+	constants.Eye = glm::vec4(view.Eye, view.LodScale);
+	constants.ObjectBase = objectBase;
+	constants.ObjectCount = m_ObjectCount;
+	constants.Compact = m_Device->SupportsDrawIndirectCount();
+	constants.IndexCapacity = m_MaxIndices;
+
+	vkCmdFillBuffer(cbuff, m_CounterBuffer->GetBufferHandle(), m_CounterStride * frame, sizeof(MeshletCounters), 0);
+
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	Command::PipelineBarrier(cbuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	if (m_ObjectCount > 0) {
+		//One workgroup per object, folded into a second dimension past the guaranteed dispatch width
+		uint32_t maxGroups = m_Device->GetProperties().limits.maxComputeWorkGroupCount[0];
+		uint32_t groupsX = std::min(m_ObjectCount, maxGroups);
+		uint32_t groupsY = (m_ObjectCount + groupsX - 1) / groupsX;
+
+		vkCmdBindPipeline(cbuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline->GetPipelineHandle());
+		vkCmdBindDescriptorSets(cbuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline->GetLayoutHandle(), 0, 1, &m_DescSets[frame], 0, nullptr);
+		vkCmdPushConstants(cbuff, m_Pipeline->GetLayoutHandle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(cbuff, groupsX, groupsY, 1);
+	}
+
+	VkMemoryBarrier drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	Command::PipelineBarrier(cbuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void MeshletRenderer::Draw(VkCommandBuffer cbuff, uint32_t frame, uint32_t instanceBinding)
+{
+	if (m_ObjectCount == 0)
+		return;
+
+	//Draws keep the pooled vertex offsets but read the frame's compacted indices
+	m_Geometry.BindVertices(cbuff);
+	m_Objects->Bind(cbuff, instanceBinding);
+	vkCmdBindIndexBuffer(cbuff, m_Indices->GetBufferHandle(), m_IndexStride * frame, VK_INDEX_TYPE_UINT32);
+
+	if (m_Device->SupportsDrawIndirectCount())
+		vkCmdDrawIndexedIndirectCount(cbuff, m_Draws->GetBufferHandle(), m_DrawStride * frame, m_CounterBuffer->GetBufferHandle(), m_CounterStride * frame,
+			m_ObjectCount, sizeof(VkDrawIndexedIndirectCommand));
+	else if (m_Device->SupportsMultiDrawIndirect())
+		vkCmdDrawIndexedIndirect(cbuff, m_Draws->GetBufferHandle(), m_DrawStride * frame, m_ObjectCount, sizeof(VkDrawIndexedIndirectCommand));
+	else
+		for (uint32_t i = 0; i < m_ObjectCount; i++)
+			vkCmdDrawIndexedIndirect(cbuff, m_Draws->GetBufferHandle(), m_DrawStride * frame + i * sizeof(VkDrawIndexedIndirectCommand), 1, 0);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Device.h"
+#include "Buffer.h"
+#include "Descriptor.h"
+#include "ComputePipeline.h"
+#include "GeometryPool.h"
+#include "IndirectRenderer.h"
+#include "Scene.h"
+
+//Laid out to match Counters in Meshlet.comp; one set per frame in flight
+struct MeshletCounters {
+	uint32_t DrawCount;
+	uint32_t IndexCount;
+	uint32_t ClustersTested;
+	uint32_t ClustersVisible;
+	//Objects dropped because the frame's compacted index region was full
+	uint32_t Overflowed;
+};
+
+//Cluster-culled path: a compute pass tests every meshlet of every pooled object against the frustum and its normal cone,
+//copies the surviving index ranges into a per-frame compacted index buffer and writes one indirect draw per object
+class MeshletRenderer {
+public:
+	MeshletRenderer(RefPtr<Device> device, GeometryPool& geometry, uint32_t maxObjects, uint32_t maxIndicesPerFrame, uint32_t frameCount);
+
+	//Uploads the frame's objects and records the culling dispatch; must be recorded outside a render pass. Each object's
+	//meshlets come from the LOD the view selects for it
+	void Cull(VkCommandBuffer cbuff, uint32_t frame, const Scene& scene, const CullView& view);
+	//Records the draws inside the render pass, with the graphics pipeline and its descriptors already bound
+	void Draw(VkCommandBuffer cbuff, uint32_t frame, uint32_t instanceBinding);
+
+	inline uint32_t GetObjectCount() const { return m_ObjectCount; }
+	//Counters of the last frame the GPU finished in the slot Cull was most recently called with
+	inline const MeshletCounters& GetCounters() const { return m_Counters; }
+private:
+	RefPtr<Device> m_Device;
+	GeometryPool& m_Geometry;
+
+	uint32_t m_MaxObjects;
+	uint32_t m_MaxIndices;
+	uint32_t m_ObjectCount;
+	std::vector<GpuObject> m_FrameObjects;
+	std::vector<bool> m_FrameRecorded;
+	MeshletCounters m_Counters;
+
+	ScopedPtr<InstanceBuffer> m_Objects;
+	ScopedPtr<DeviceBuffer> m_Draws;
+	ScopedPtr<DeviceBuffer> m_Indices;
+	ScopedPtr<ReadbackBuffer> m_CounterBuffer;
+	VkDeviceSize m_DrawStride;
+	VkDeviceSize m_IndexStride;
+	VkDeviceSize m_CounterStride;
+
+	RefPtr<DescriptorSetLayout> m_SetLayout;
+	ScopedPtr<DescriptorPool> m_DescPool;
+	std::vector<VkDescriptorSet> m_DescSets;
+	ScopedPtr<ComputePipeline> m_Pipeline;
+};
@@ -1,84 +1,154 @@
 #include "raydpch.h"
 #include "Model.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#include "Asset/MeshCache.h"
 
-#include <glm/glm.hpp>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+static VkFormat GetPositionFormat(PositionEncoding encoding)
+{
+    switch (encoding) {
+    case PositionEncoding::Float32: return VK_FORMAT_R32G32B32_SFLOAT;
+    case PositionEncoding::Half: return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case PositionEncoding::SNorm16: return VK_FORMAT_R16G16B16A16_SNORM;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
+static VkFormat GetTexCoordFormat(TexCoordEncoding encoding)
+{
+    switch (encoding) {
+    case TexCoordEncoding::Float32: return VK_FORMAT_R32G32_SFLOAT;
+    case TexCoordEncoding::Half: return VK_FORMAT_R16G16_SFLOAT;
+    case TexCoordEncoding::UNorm16: return VK_FORMAT_R16G16_UNORM;
+    default: return VK_FORMAT_UNDEFINED;
+    }
+}
 
-    bool operator==(const Vertex& other) const {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord;
+Model::Model(RefPtr<Device> device, const std::string& modelPath, const VertexFormat& format, GeometryPool* pool, ThreadPool* workers)
+    :m_Device(device), m_Format(format), m_Pool(pool), m_PoolMesh(0)
+{
+    RAYD_PROFILE_SCOPE("Model::Model");
+    CreateLayout();
+
+    //The cache is mapped and copied straight into staging memory; the OBJ is only parsed when it is missing or stale
+    MeshCache cache(MeshCache::GetCachePath(modelPath), modelPath, format);
+    if (cache.IsValid()) {
+        auto& header = cache.GetHeader();
+        m_Bounds = header.Bounds;
+        m_Decode = header.Decode;
+        CreateBuffers(cache.GetVertices(), header.VertexCount, cache.GetIndices(), header.IndexCount, cache.GetMeshlets(), header.MeshletCount,
+            cache.GetLods(), header.LodCount);
+        return;
     }
-};
-
-namespace std {
-    template<> struct hash<Vertex> {
-        size_t operator()(Vertex const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.pos) ^
-                (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
+
+    PackedMesh mesh;
+    //The importer has already logged why; nothing below can work without the geometry, release builds included
+    if (!MeshCache::Bake(modelPath, format, mesh, workers))
+        throw std::runtime_error("Failed to import model " + modelPath);
+
+    m_Bounds = mesh.Bounds;
+    m_Decode = mesh.Decode;
+    CreateBuffers(mesh.Vertices.data(), mesh.VertexCount, mesh.Indices.data(), static_cast<uint32_t>(mesh.Indices.size()),
+        mesh.Meshlets.data(), static_cast<uint32_t>(mesh.Meshlets.size()), mesh.Lods.data(), static_cast<uint32_t>(mesh.Lods.size()));
 }
 
-Model::Model(RefPtr<Device> device, const std::string& modelPath)
-    :m_Device(device)
+Model::Model(RefPtr<Device> device, const PackedMesh& mesh, const VertexFormat& format, GeometryPool* pool)
+    :m_Device(device), m_Format(format), m_Pool(pool), m_PoolMesh(0)
 {
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> mats;
-	tinyobj::attrib_t attrib;
-	std::string warn, err;
-	RAYD_ASSERT(tinyobj::LoadObj(&attrib, &shapes, &mats, &warn, &err, modelPath.c_str()), warn + err);
-
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
-
-            vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
-            };
-
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-
-            vertex.color = { 1.0f, 1.0f, 1.0f };
-
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-
-            indices.push_back(uniqueVertices[vertex]);
-        }
+    RAYD_PROFILE_SCOPE("Model::Model");
+    RAYD_ASSERT(mesh.Format == format, "Mesh was packed in a different vertex format!");
+    CreateLayout();
+
+    m_Bounds = mesh.Bounds;
+    m_Decode = mesh.Decode;
+    CreateBuffers(mesh.Vertices.data(), mesh.VertexCount, mesh.Indices.data(), static_cast<uint32_t>(mesh.Indices.size()),
+        mesh.Meshlets.data(), static_cast<uint32_t>(mesh.Meshlets.size()), mesh.Lods.data(), static_cast<uint32_t>(mesh.Lods.size()));
+}
+
+void Model::CreateLayout()
+{
+    //Locations stay fixed whichever attributes the format keeps, so shaders never renumber their inputs
+    m_VLayout.AddAttribute(0, 0, GetPositionFormat(m_Format.Position));
+    if (m_Format.Normal == NormalEncoding::Octahedral)
+        m_VLayout.AddAttribute(1, 0, VK_FORMAT_R16G16_SNORM);
+    if (m_Format.TexCoord != TexCoordEncoding::None)
+        m_VLayout.AddAttribute(2, 0, GetTexCoordFormat(m_Format.TexCoord));
+    m_VLayout.AddBinding(0, m_Format.GetStride(), VK_VERTEX_INPUT_RATE_VERTEX);
+}
 
+glm::mat4 Model::GetDecodeTransform() const
+{
+    glm::mat4 decode(m_Decode.Scale);
+    decode[3] = glm::vec4(m_Decode.Offset, 1.0f);
+    return decode;
+}
+
+void Model::CreateBuffers(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const Meshlet* meshlets, uint32_t meshletCount,
+    const MeshLod* lods, uint32_t lodCount)
+{
+    //Culling and LOD selection work in packed space, the same space the decode-folded instance transforms map from
+    m_PackedBounds = { (m_Bounds.Center - m_Decode.Offset) / m_Decode.Scale, m_Bounds.Radius / m_Decode.Scale };
+    m_Lods.assign(lods, lods + lodCount);
+    for (auto& lod : m_Lods)
+        lod.Error /= m_Decode.Scale;
+    //Every copy below records into the pending batch
+    m_UploadToken = Upload::GetPendingToken();
+
+    if (m_Pool && !m_Pool->CanFit(vertexCount, indexCount, meshletCount, lodCount)) {
+        RAYD_WARN("Geometry pool is full, a mesh with {0} vertices and {1} indices gets its own buffers and is skipped by the GPU-driven paths",
+            vertexCount, indexCount);
+        m_Pool = nullptr;
     }
 
-    m_VLayout.AddAttribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT);
-    m_VLayout.AddAttribute(1, 0, VK_FORMAT_R32G32B32_SFLOAT);
-    m_VLayout.AddAttribute(2, 0, VK_FORMAT_R32G32_SFLOAT);
-    m_VLayout.AddBinding(0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX);
-    m_VBuffer = MakeScopedPtr<VertexBuffer>(m_Device, vertices.size(), vertices.size() * sizeof(Vertex), vertices.data());
-    m_IBuffer = MakeScopedPtr<IndexBuffer>(m_Device, indices.size(), indices.size() * sizeof(uint32_t), indices.data());
+    if (m_Pool) {
+        //The decode scale is uniform, so cone axes carry over unchanged
+        std::vector<Meshlet> packedMeshlets(meshlets, meshlets + meshletCount);
+        for (auto& meshlet : packedMeshlets) {
+            glm::vec3 center = (glm::vec3(meshlet.Sphere) - m_Decode.Offset) / m_Decode.Scale;
+            meshlet.Sphere = glm::vec4(center, meshlet.Sphere.w / m_Decode.Scale);
+        }
+        m_PoolMesh = m_Pool->AddMesh(vertices, vertexCount, indices, indexCount, m_PackedBounds, packedMeshlets.data(), meshletCount,
+            m_Lods.data(), lodCount);
+        return;
+    }
+
+    VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(vertexCount) * m_Format.GetStride();
+    m_VBuffer = MakeScopedPtr<VertexBuffer>(m_Device, vertexCount, vertexBytes, vertices);
+    m_IBuffer = MakeScopedPtr<IndexBuffer>(m_Device, indexCount, indexCount * sizeof(uint32_t), indices);
 }
 
-void Model::Render(VkCommandBuffer& cbuff)
+uint32_t Model::SelectLod(const glm::mat4& transform, const glm::vec3& eye, float lodScale) const
 {
+    glm::vec3 center(transform * glm::vec4(m_PackedBounds.Center, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    float distance = std::max(glm::length(center - eye) - m_PackedBounds.Radius * scale, 0.0f);
+
+    uint32_t lod = 0;
+    for (uint32_t i = 1; i < m_Lods.size(); i++)
+        if (m_Lods[i].Error * scale * lodScale <= distance)
+            lod = i;
+    return lod;
+}
+
+float Model::GetScreenExtent(const glm::mat4& transform, const glm::vec3& eye, float pixelScale) const
+{
+    glm::vec3 center(transform * glm::vec4(m_PackedBounds.Center, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    float distance = std::max(glm::length(center - eye) - m_PackedBounds.Radius * scale, 1e-4f);
+    return 2.0f * m_PackedBounds.Radius * scale * pixelScale / distance;
+}
+
+void Model::Render(VkCommandBuffer& cbuff, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod)
+{
+    const MeshLod& range = m_Lods[lod];
+    if (m_Pool) {
+        const MeshRecord& mesh = m_Pool->GetMesh(m_PoolMesh);
+        m_Pool->Bind(cbuff);
+        vkCmdDrawIndexed(cbuff, range.IndexCount, instanceCount, mesh.FirstIndex + range.FirstIndex, mesh.VertexOffset, firstInstance);
+        return;
+    }
+
     m_VBuffer->Bind(cbuff);
     m_IBuffer->Bind(cbuff);
 
-    vkCmdDrawIndexed(cbuff, m_IBuffer->GetIndexCount(), 1, 0, 0, 0);
+    vkCmdDrawIndexed(cbuff, range.IndexCount, instanceCount, range.FirstIndex, 0, firstInstance);
 }
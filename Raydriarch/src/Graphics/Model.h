@@ -3,15 +3,50 @@
 #include "GraphicsCore.h"
 #include "Device.h"
 #include "Buffer.h"
+#include "GeometryPool.h"
+#include "Core/ThreadPool.h"
+#include "Asset/VertexPacker.h"
 
 class Model {
 public:
-	Model(RefPtr<Device> device, const std::string& modelPath);
-	void Render(VkCommandBuffer& cbuff);
+	//With a pool the geometry goes into its shared buffers instead of buffers owned by the model, whose vertex stride
+	//must match the format; workers, when given, parse uncached OBJs in parallel
+	Model(RefPtr<Device> device, const std::string& modelPath, const VertexFormat& format = VertexFormat(), GeometryPool* pool = nullptr, ThreadPool* workers = nullptr);
+	//Uploads a mesh decoded elsewhere, typically by MeshCache::Load on a worker; it must be packed in format
+	Model(RefPtr<Device> device, const PackedMesh& mesh, const VertexFormat& format = VertexFormat(), GeometryPool* pool = nullptr);
+	void Render(VkCommandBuffer& cbuff, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
+	//Coarsest LOD whose error, projected at the nearest point of the transformed bounds, stays under the budget folded
+	//into lodScale; the same test the culling shaders run
+	uint32_t SelectLod(const glm::mat4& transform, const glm::vec3& eye, float lodScale) const;
+	//Diameter in pixels of the bounds drawn with transform, where pixelScale is the pixel size of one unit at unit distance
+	float GetScreenExtent(const glm::mat4& transform, const glm::vec3& eye, float pixelScale) const;
+	inline uint32_t GetLodCount() const { return static_cast<uint32_t>(m_Lods.size()); }
 	inline VertexLayout& GetVertexLayout() { return m_VLayout; }
+	inline const MeshBounds& GetBounds() const { return m_Bounds; }
+	inline const VertexFormat& GetVertexFormat() const { return m_Format; }
+	//Maps packed positions to model space; applied ahead of the model's instance transforms
+	glm::mat4 GetDecodeTransform() const;
+	inline bool IsPooled() const { return m_Pool != nullptr; }
+	inline uint32_t GetPoolMesh() const { return m_PoolMesh; }
+	//True once the upload batch holding the geometry has finished on the GPU
+	inline bool IsResident() const { return Upload::IsComplete(m_UploadToken); }
+private:
+	void CreateLayout();
+	void CreateBuffers(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const Meshlet* meshlets, uint32_t meshletCount,
+		const MeshLod* lods, uint32_t lodCount);
 private:
 	RefPtr<Device> m_Device;
 	ScopedPtr<VertexBuffer > m_VBuffer;
 	ScopedPtr<IndexBuffer> m_IBuffer;
 	VertexLayout m_VLayout;
+	VertexFormat m_Format;
+	MeshBounds m_Bounds;
+	VertexDecode m_Decode;
+	//Index ranges are relative to the model's indices; bounds and errors are in packed space, like the instance transforms
+	std::vector<MeshLod> m_Lods;
+	MeshBounds m_PackedBounds;
+
+	GeometryPool* m_Pool;
+	uint32_t m_PoolMesh;
+	UploadToken m_UploadToken = 0;
 };
\ No newline at end of file
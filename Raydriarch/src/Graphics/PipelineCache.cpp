@@ -0,0 +1,147 @@
+#include "raydpch.h"
+#include "PipelineCache.h"
+
+//Layout the spec fixes for the start of every cache blob
+struct DriverCacheHeader {
+	uint32_t HeaderSize;
+	uint32_t HeaderVersion;
+	uint32_t VendorID;
+	uint32_t DeviceID;
+	uint8_t UUID[VK_UUID_SIZE];
+};
+
+static uint64_t HashBytes(const uint8_t* data, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+PipelineCache::PipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties)
+	:m_Device(device), m_Properties(properties)
+{
+	m_Cache = Create(nullptr, 0);
+}
+
+PipelineCache::~PipelineCache()
+{
+	vkDestroyPipelineCache(m_Device, m_Cache, nullptr);
+}
+
+bool PipelineCache::Load(const std::string& path)
+{
+	std::ifstream input(path, std::ios::in | std::ios::binary);
+	if (!input)
+		return false;
+
+	PipelineCacheFileHeader header{};
+	input.read(reinterpret_cast<char*>(&header), sizeof(header));
+	std::error_code error;
+	uint64_t fileSize = std::filesystem::file_size(path, error);
+	if (!input || error || header.Magic != PIPELINE_CACHE_MAGIC || header.Version != PIPELINE_CACHE_VERSION ||
+		header.DriverVersion != m_Properties.driverVersion || header.DataSize != fileSize - sizeof(header)) {
+		RAYD_WARN("Ignoring pipeline cache {0}: truncated, or written by another version or driver", path);
+		return false;
+	}
+
+	std::vector<uint8_t> data(header.DataSize);
+	input.read(reinterpret_cast<char*>(data.data()), data.size());
+	if (!input || HashBytes(data.data(), data.size()) != header.DataHash || !IsCompatible(data.data(), data.size())) {
+		RAYD_WARN("Ignoring pipeline cache {0}: corrupt or written for another device", path);
+		return false;
+	}
+
+	//Merging keeps the handle pipelines were already given valid
+	VkPipelineCache loaded = Create(data.data(), data.size());
+	VkResult result = vkMergePipelineCaches(m_Device, m_Cache, 1, &loaded);
+	vkDestroyPipelineCache(m_Device, loaded, nullptr);
+	if (result != VK_SUCCESS)
+		return false;
+
+	m_Stats.Warm = true;
+	m_Stats.LoadedBytes = data.size();
+	return true;
+}
+
+bool PipelineCache::Save(const std::string& path) const
+{
+	size_t size = 0;
+	if (vkGetPipelineCacheData(m_Device, m_Cache, &size, nullptr) != VK_SUCCESS)
+		return false;
+	std::vector<uint8_t> data(size);
+	if (vkGetPipelineCacheData(m_Device, m_Cache, &size, data.data()) != VK_SUCCESS)
+		return false;
+	data.resize(size);
+
+	PipelineCacheFileHeader header{};
+	header.Magic = PIPELINE_CACHE_MAGIC;
+	header.Version = PIPELINE_CACHE_VERSION;
+	header.DriverVersion = m_Properties.driverVersion;
+	header.DataSize = data.size();
+	header.DataHash = HashBytes(data.data(), data.size());
+
+	//Written beside the target and renamed over it, so a crash never leaves a torn cache behind
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream output(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!output)
+			return false;
+
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!output)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		RAYD_WARN("Failed to write pipeline cache {0}: {1}", path, error.message());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+void PipelineCache::Reset()
+{
+	vkDestroyPipelineCache(m_Device, m_Cache, nullptr);
+	m_Cache = Create(nullptr, 0);
+	m_Stats = {};
+}
+
+void PipelineCache::RecordCreation(float milliseconds)
+{
+	m_Stats.PipelinesCreated++;
+	m_Stats.CreateMs += milliseconds;
+}
+
+VkPipelineCache PipelineCache::Create(const void* data, size_t size)
+{
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = size;
+	createInfo.pInitialData = data;
+
+	VkPipelineCache cache;
+	VkResult result = vkCreatePipelineCache(m_Device, &createInfo, nullptr, &cache);
+	RAYD_VK_VALIDATE(result, "Failed to create pipeline cache!");
+	return cache;
+}
+
+bool PipelineCache::IsCompatible(const uint8_t* data, size_t size) const
+{
+	//Drivers should reject a foreign blob themselves, but not all of them do so gracefully
+	DriverCacheHeader header;
+	if (size < sizeof(header))
+		return false;
+
+	memcpy(&header, data, sizeof(header));
+	return header.HeaderSize >= sizeof(header) && header.HeaderVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header.VendorID == m_Properties.vendorID && header.DeviceID == m_Properties.deviceID &&
+		memcmp(header.UUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
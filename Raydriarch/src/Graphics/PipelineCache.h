@@ -0,0 +1,55 @@
+#pragma once
+
+#include "GraphicsCore.h"
+
+#define PIPELINE_CACHE_MAGIC 0x43505252
+#define PIPELINE_CACHE_VERSION 1
+
+//Precedes the driver's blob on disk; the blob's own header is checked too, but it carries no driver version
+struct PipelineCacheFileHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t DriverVersion;
+	uint32_t Reserved;
+	uint64_t DataSize;
+	//FNV-1a of the blob, so a truncated or corrupted file is never handed to the driver
+	uint64_t DataHash;
+};
+
+struct PipelineCacheStats {
+	//Whether Load found a cache for this device and driver
+	bool Warm;
+	uint64_t LoadedBytes;
+	uint32_t PipelinesCreated;
+	//Wall time spent inside vkCreate*Pipelines
+	float CreateMs;
+};
+
+//VkPipelineCache every pipeline of a device is created through, persisted between runs so shaders already compiled by
+//this driver are not compiled again
+class PipelineCache {
+public:
+	PipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties);
+	~PipelineCache();
+
+	//Merges a cache saved by an earlier run; false, leaving the cache as it was, when the file is missing or was written
+	//for another device or driver
+	bool Load(const std::string& path);
+	bool Save(const std::string& path) const;
+	//Drops everything compiled so far, to measure cold pipeline creation
+	void Reset();
+
+	//Pipelines report the time spent creating them, so the cache's effect can be measured
+	void RecordCreation(float milliseconds);
+
+	inline VkPipelineCache GetHandle() const { return m_Cache; }
+	inline const PipelineCacheStats& GetStats() const { return m_Stats; }
+private:
+	VkPipelineCache Create(const void* data, size_t size);
+	bool IsCompatible(const uint8_t* data, size_t size) const;
+private:
+	VkDevice m_Device;
+	VkPhysicalDeviceProperties m_Properties;
+	VkPipelineCache m_Cache;
+	PipelineCacheStats m_Stats{};
+};
@@ -0,0 +1,78 @@
+#include "raydpch.h"
+#include "PipelineRegistry.h"
+
+#include "SwapChain.h"
+
+template<typename T>
+static void AppendKey(std::string& key, const T& value)
+{
+	key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static void AppendKey(std::string& key, const std::vector<T>& values)
+{
+	AppendKey(key, values.size());
+	key.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+static void AppendKey(std::string& key, const std::string& value)
+{
+	AppendKey(key, value.size());
+	key.append(value);
+}
+
+PipelineRegistry::PipelineRegistry(RefPtr<Device> device)
+	:m_Device(device)
+{
+}
+
+RefPtr<GraphicsPipeline> PipelineRegistry::GetGraphicsPipeline(ScopedPtr<SwapChain>& swapChain, RefPtr<DescriptorSetLayout> descSetLayout,
+	const std::string& vertShaderPath, const std::string& fragShaderPath, const std::vector<VkPushConstantRange>& pushConstants, VertexLayout& vlayout)
+{
+	//Everything else the pipeline sets is fixed in GraphicsPipeline itself
+	std::string key;
+	AppendKey(key, vertShaderPath);
+	AppendKey(key, fragShaderPath);
+	AppendKey(key, descSetLayout->GetHandle());
+	AppendKey(key, pushConstants);
+	AppendKey(key, vlayout.GetBindings());
+	AppendKey(key, vlayout.GetAttributes());
+	AppendKey(key, swapChain->GetRenderPass());
+	AppendKey(key, swapChain->GetSampleCount());
+
+	auto it = m_Pipelines.find(key);
+	if (it != m_Pipelines.end()) {
+		m_Stats.Hits++;
+		return it->second;
+	}
+
+	m_Stats.Misses++;
+	RefPtr<Shader> shader = GetShader(vertShaderPath, fragShaderPath);
+	RefPtr<GraphicsPipeline> pipeline = MakeRefPtr<GraphicsPipeline>(m_Device, swapChain, descSetLayout, *shader, pushConstants, vlayout);
+	m_Pipelines.emplace(std::move(key), pipeline);
+	return pipeline;
+}
+
+void PipelineRegistry::ReleaseUnused()
+{
+	for (auto it = m_Pipelines.begin(); it != m_Pipelines.end();) {
+		if (it->second.use_count() == 1)
+			it = m_Pipelines.erase(it);
+		else
+			++it;
+	}
+}
+
+RefPtr<Shader> PipelineRegistry::GetShader(const std::string& vertShaderPath, const std::string& fragShaderPath)
+{
+	std::string key = vertShaderPath + '\0' + fragShaderPath;
+	auto it = m_Shaders.find(key);
+	if (it != m_Shaders.end())
+		return it->second;
+
+	m_Stats.ShaderLoads++;
+	RefPtr<Shader> shader = MakeRefPtr<Shader>(m_Device, vertShaderPath, fragShaderPath);
+	m_Shaders.emplace(std::move(key), shader);
+	return shader;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "GraphicsPipeline.h"
+
+struct PipelineRegistryStats {
+	//Requests answered with a pipeline that already existed
+	uint32_t Hits;
+	uint32_t Misses;
+	uint32_t ShaderLoads;
+};
+
+//Hands out one pipeline per distinct state, so asking twice for the same state costs a lookup instead of a compile.
+//Shader modules stay loaded for the registry's lifetime, so rebuilding a pipeline never reads its SPIR-V again.
+class PipelineRegistry {
+public:
+	PipelineRegistry(RefPtr<Device> device);
+
+	RefPtr<GraphicsPipeline> GetGraphicsPipeline(ScopedPtr<SwapChain>& swapChain, RefPtr<DescriptorSetLayout> descSetLayout,
+		const std::string& vertShaderPath, const std::string& fragShaderPath, const std::vector<VkPushConstantRange>& pushConstants, VertexLayout& vlayout);
+	//Destroys the pipelines no one else holds; call after dropping the ones built for a render pass that is going away
+	void ReleaseUnused();
+
+	inline const PipelineRegistryStats& GetStats() const { return m_Stats; }
+	inline uint32_t GetPipelineCount() const { return static_cast<uint32_t>(m_Pipelines.size()); }
+private:
+	RefPtr<Shader> GetShader(const std::string& vertShaderPath, const std::string& fragShaderPath);
+private:
+	RefPtr<Device> m_Device;
+	std::unordered_map<std::string, RefPtr<Shader>> m_Shaders;
+	//Keyed by the raw bytes of every input that reaches vkCreateGraphicsPipelines, so equal keys mean equal pipelines
+	std::unordered_map<std::string, RefPtr<GraphicsPipeline>> m_Pipelines;
+	PipelineRegistryStats m_Stats{};
+};
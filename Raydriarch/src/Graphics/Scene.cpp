@@ -0,0 +1,105 @@
+#include "raydpch.h"
+#include "Scene.h"
+
+EntityID Scene::CreateEntity(RefPtr<Model> model, const glm::mat4& transform)
+{
+	uint32_t batchIndex = GetBatch(model);
+
+	EntityID entity;
+	if (!m_FreeIDs.empty()) {
+		entity = m_FreeIDs.back();
+		m_FreeIDs.pop_back();
+	}
+	else {
+		entity = static_cast<EntityID>(m_Entities.size());
+		m_Entities.emplace_back();
+	}
+
+	Batch& batch = m_Batches[batchIndex];
+	m_Entities[entity] = { batchIndex, static_cast<uint32_t>(batch.Transforms.size()), true };
+	batch.Transforms.push_back(transform * model->GetDecodeTransform());
+	batch.Owners.push_back(entity);
+	m_EntityCount++;
+
+	return entity;
+}
+
+void Scene::DestroyEntity(EntityID entity)
+{
+	RAYD_ASSERT(entity < m_Entities.size() && m_Entities[entity].Alive, "Invalid entity!");
+
+	RemoveFromBatch(entity);
+	m_Entities[entity].Alive = false;
+	m_FreeIDs.push_back(entity);
+	m_EntityCount--;
+}
+
+void Scene::SetTransform(EntityID entity, const glm::mat4& transform)
+{
+	RAYD_ASSERT(entity < m_Entities.size() && m_Entities[entity].Alive, "Invalid entity!");
+
+	EntityRecord& record = m_Entities[entity];
+	Batch& batch = m_Batches[record.Batch];
+	batch.Transforms[record.Slot] = transform * batch.Mesh->GetDecodeTransform();
+}
+
+void Scene::SetModel(EntityID entity, RefPtr<Model> model)
+{
+	RAYD_ASSERT(entity < m_Entities.size() && m_Entities[entity].Alive, "Invalid entity!");
+
+	EntityRecord& record = m_Entities[entity];
+	if (m_Batches[record.Batch].Mesh == model)
+		return;
+
+	//Decodes are an offset and a uniform scale, so unfolding the old one is exact enough to refold the new one
+	glm::mat4 decoded = m_Batches[record.Batch].Mesh->GetDecodeTransform();
+	glm::mat4 transform = RemoveFromBatch(entity) * glm::inverse(decoded);
+
+	uint32_t batchIndex = GetBatch(model);
+	Batch& batch = m_Batches[batchIndex];
+	record.Batch = batchIndex;
+	record.Slot = static_cast<uint32_t>(batch.Transforms.size());
+	batch.Transforms.push_back(transform * model->GetDecodeTransform());
+	batch.Owners.push_back(entity);
+}
+
+Model* Scene::GetModel(EntityID entity) const
+{
+	if (entity >= m_Entities.size() || !m_Entities[entity].Alive)
+		return nullptr;
+	return m_Batches[m_Entities[entity].Batch].Mesh.get();
+}
+
+void Scene::Clear()
+{
+	m_Batches.clear();
+	m_BatchLookup.clear();
+	m_Entities.clear();
+	m_FreeIDs.clear();
+	m_EntityCount = 0;
+}
+
+uint32_t Scene::GetBatch(const RefPtr<Model>& model)
+{
+	auto it = m_BatchLookup.find(model.get());
+	if (it == m_BatchLookup.end()) {
+		it = m_BatchLookup.emplace(model.get(), static_cast<uint32_t>(m_Batches.size())).first;
+		m_Batches.push_back({ model, {}, {} });
+	}
+	return it->second;
+}
+
+glm::mat4 Scene::RemoveFromBatch(EntityID entity)
+{
+	//Swap the last instance of the batch into the freed slot to keep transforms packed
+	EntityRecord& record = m_Entities[entity];
+	Batch& batch = m_Batches[record.Batch];
+	glm::mat4 transform = batch.Transforms[record.Slot];
+	EntityID moved = batch.Owners.back();
+	batch.Transforms[record.Slot] = batch.Transforms.back();
+	batch.Owners[record.Slot] = moved;
+	m_Entities[moved].Slot = record.Slot;
+	batch.Transforms.pop_back();
+	batch.Owners.pop_back();
+	return transform;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Model.h"
+
+#include <glm/glm.hpp>
+
+using EntityID = uint32_t;
+
+//Entities grouped by the model they draw, so each model renders with one instanced call
+class Scene {
+public:
+	//Transforms are kept densely packed so a batch uploads straight into the instance stream;
+	//each already has the model's vertex decode folded in
+	struct Batch {
+		RefPtr<Model> Mesh;
+		std::vector<glm::mat4> Transforms;
+		std::vector<EntityID> Owners;
+	};
+
+	EntityID CreateEntity(RefPtr<Model> model, const glm::mat4& transform = glm::mat4(1.0f));
+	void DestroyEntity(EntityID entity);
+	void SetTransform(EntityID entity, const glm::mat4& transform);
+	//Moves the entity into the model's batch, keeping its ID and transform; how a placeholder hands over to the real asset
+	void SetModel(EntityID entity, RefPtr<Model> model);
+	void Clear();
+
+	//Null for an entity that was destroyed or cleared away
+	Model* GetModel(EntityID entity) const;
+	inline const std::vector<Batch>& GetBatches() const { return m_Batches; }
+	inline uint32_t GetEntityCount() const { return m_EntityCount; }
+private:
+	struct EntityRecord {
+		uint32_t Batch;
+		uint32_t Slot;
+		bool Alive;
+	};
+
+	std::vector<Batch> m_Batches;
+	std::unordered_map<Model*, uint32_t> m_BatchLookup;
+	std::vector<EntityRecord> m_Entities;
+	std::vector<EntityID> m_FreeIDs;
+	uint32_t m_EntityCount = 0;
+private:
+	uint32_t GetBatch(const RefPtr<Model>& model);
+	//Takes the entity's transform out of its batch, with the decode still folded in
+	glm::mat4 RemoveFromBatch(EntityID entity);
+};
@@ -11,10 +11,18 @@ Shader::Shader(RefPtr<Device> device, const std::string& vertPath, const std::st
 	m_FragModule = CreateModule(fragPath);
 }
 
+Shader::Shader(RefPtr<Device> device, const std::string& compPath)
+	:m_Device(device)
+{
+	m_CompModule = CreateModule(compPath);
+}
+
 Shader::~Shader()
 {
+	//Destroying a null module is a no-op, so unused stages need no special casing
 	vkDestroyShaderModule(m_Device->GetDeviceHandle(), m_VertModule, nullptr);
 	vkDestroyShaderModule(m_Device->GetDeviceHandle(), m_FragModule, nullptr);
+	vkDestroyShaderModule(m_Device->GetDeviceHandle(), m_CompModule, nullptr);
 }
 
 std::optional<std::string> Shader::ReadFile(const std::string& filePath)
@@ -5,16 +5,19 @@
 class Shader {
 public:
 	Shader(RefPtr<class Device> device, const std::string& vertPath, const std::string& fragPath);
+	Shader(RefPtr<class Device> device, const std::string& compPath);
 	~Shader();
 
 	inline const VkShaderModule& GetVertexShaderModule() const { return m_VertModule; }
 	inline const VkShaderModule& GetFragmentShaderModule() const { return m_FragModule; }
+	inline const VkShaderModule& GetComputeShaderModule() const { return m_CompModule; }
 private:
 	std::optional<std::string> ReadFile(const std::string& filePath);
 	VkShaderModule CreateModule(const std::string& filePath);
 
 private:
 	RefPtr<Device> m_Device;
-	VkShaderModule m_VertModule;
-	VkShaderModule m_FragModule;
+	VkShaderModule m_VertModule = VK_NULL_HANDLE;
+	VkShaderModule m_FragModule = VK_NULL_HANDLE;
+	VkShaderModule m_CompModule = VK_NULL_HANDLE;
 };
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "raydpch.h"
+#include "StagingRing.h"
+
+static inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+StagingRing::StagingRing(RefPtr<Device> device, VkDeviceSize size)
+	:m_Device(device), m_Head(0), m_Tail(0), m_Used(0), m_Peak(0)
+{
+	m_Buffer = MakeScopedPtr<StagingBuffer>(m_Device, size);
+}
+
+bool StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, UploadToken token, StagingRegion& region)
+{
+	VkDeviceSize capacity = GetCapacity();
+	if (m_Pending.empty())
+		m_Head = m_Tail = 0;
+
+	//Head never catches up with tail exactly, so head == tail always means empty
+	VkDeviceSize offset = AlignUp(m_Head, alignment);
+	VkDeviceSize consumed;
+	if (m_Head >= m_Tail) {
+		if (offset + size <= capacity)
+			consumed = offset + size - m_Head;
+		else if (size < m_Tail) {
+			consumed = capacity - m_Head + size;
+			offset = 0;
+		}
+		else
+			return false;
+	}
+	else if (offset + size < m_Tail)
+		consumed = offset + size - m_Head;
+	else
+		return false;
+
+	m_Head = offset + size;
+	m_Used += consumed;
+	m_Peak = std::max(m_Peak, m_Used);
+
+	if (!m_Pending.empty() && m_Pending.back().Token == token) {
+		m_Pending.back().End = m_Head;
+		m_Pending.back().Bytes += consumed;
+	}
+	else
+		m_Pending.push_back({ token, m_Head, consumed });
+
+	region.Buffer = m_Buffer->GetBufferHandle();
+	region.Offset = offset;
+	region.Mapped = m_Buffer->GetMapped() + offset;
+	return true;
+}
+
+void StagingRing::Reclaim(UploadToken completedToken)
+{
+	while (!m_Pending.empty() && m_Pending.front().Token <= completedToken) {
+		m_Tail = m_Pending.front().End;
+		m_Used -= m_Pending.front().Bytes;
+		m_Pending.pop_front();
+	}
+}
+
+ScopedPtr<StagingBuffer> StagingRing::Grow(VkDeviceSize minSize)
+{
+	VkDeviceSize size = GetCapacity() * 2;
+	while (size < minSize)
+		size *= 2;
+
+	RAYD_INFO("Growing staging ring to {0:.1f} MB", size / (1024.0 * 1024.0));
+
+	auto old = std::move(m_Buffer);
+	m_Buffer = MakeScopedPtr<StagingBuffer>(m_Device, size);
+	m_Head = m_Tail = m_Used = 0;
+	m_Pending.clear();
+
+	return old;
+}
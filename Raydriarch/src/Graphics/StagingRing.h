@@ -0,0 +1,35 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Buffer.h"
+
+//Persistently mapped ring that upload batches sub-allocate from; space is reclaimed when a batch's token completes
+class StagingRing {
+public:
+	StagingRing(RefPtr<Device> device, VkDeviceSize size);
+
+	bool Allocate(VkDeviceSize size, VkDeviceSize alignment, UploadToken token, StagingRegion& region);
+	void Reclaim(UploadToken completedToken);
+	//Swaps in a larger buffer; the old one is handed back so it can be destroyed once its batches retire
+	ScopedPtr<StagingBuffer> Grow(VkDeviceSize minSize);
+
+	inline VkDeviceSize GetCapacity() const { return m_Buffer->GetSize(); }
+	inline VkDeviceSize GetBytesInFlight() const { return m_Used; }
+	inline VkDeviceSize GetPeakBytesInFlight() const { return m_Peak; }
+	inline bool IsEmpty() const { return m_Pending.empty(); }
+private:
+	struct PendingBatch {
+		UploadToken Token;
+		VkDeviceSize End;
+		VkDeviceSize Bytes;
+	};
+
+	RefPtr<Device> m_Device;
+	ScopedPtr<StagingBuffer> m_Buffer;
+
+	VkDeviceSize m_Head;
+	VkDeviceSize m_Tail;
+	VkDeviceSize m_Used;
+	VkDeviceSize m_Peak;
+	std::deque<PendingBatch> m_Pending;
+};
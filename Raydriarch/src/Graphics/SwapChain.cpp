@@ -4,32 +4,159 @@
 #include "Image.h"
 #include "Surface.h"
 
+//Enough for every frame in flight to render while another waits
+#define HEADLESS_IMAGE_COUNT 3
+
 SwapChain::SwapChain(RefPtr<Device> device, ScopedPtr<Surface>& surface,
     uint32_t framebufferWidth, uint32_t framebufferHeight)
-    :m_Device(device)
+    :m_Device(device), m_Surface(surface ? surface->GetSurfaceHandle() : VK_NULL_HANDLE), m_SwapChain(VK_NULL_HANDLE)
 {
-    m_Device->UpdateSwapChainSupportDetails(surface->GetSurfaceHandle());
     auto& physicalDevice = device->GetPhysicalDeviceHandle();
-    auto& details = device->GetSwapChainSupportDetails();
-	VkSurfaceFormatKHR& surfaceFormat = FindSurfaceFormat(physicalDevice, details, surface->GetSurfaceHandle());
-    m_Format = surfaceFormat.format;
-	VkPresentModeKHR presentMode = FindPresentMode(physicalDevice, details, surface->GetSurfaceHandle());
+    if (surface) {
+        m_Device->UpdateSwapChainSupportDetails(surface->GetSurfaceHandle());
+        auto& details = device->GetSwapChainSupportDetails();
+        VkSurfaceFormatKHR surfaceFormat = FindSurfaceFormat(physicalDevice, details, surface->GetSurfaceHandle());
+        m_Format = surfaceFormat.format;
+        m_ColorSpace = surfaceFormat.colorSpace;
+        m_PresentMode = FindPresentMode(physicalDevice, details, surface->GetSurfaceHandle());
+    }
+    else {
+        //What FindSurfaceFormat prefers, so headless frames cost what windowed ones do
+        m_Format = VK_FORMAT_B8G8R8A8_SRGB;
+        m_ColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+        m_PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+
+    VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts & physicalDeviceProperties.limits.framebufferDepthSampleCounts;
+    m_SampleCount = VK_SAMPLE_COUNT_1_BIT;
+    if(counts & VK_SAMPLE_COUNT_64_BIT) 
+        m_SampleCount = VK_SAMPLE_COUNT_64_BIT;
+    else if(counts & VK_SAMPLE_COUNT_32_BIT)
+        m_SampleCount = VK_SAMPLE_COUNT_32_BIT;
+    else if (counts & VK_SAMPLE_COUNT_16_BIT)
+        m_SampleCount = VK_SAMPLE_COUNT_16_BIT;
+    else if (counts & VK_SAMPLE_COUNT_8_BIT)
+        m_SampleCount = VK_SAMPLE_COUNT_8_BIT;
+    else if (counts & VK_SAMPLE_COUNT_4_BIT)
+        m_SampleCount = VK_SAMPLE_COUNT_4_BIT;
+    else if (counts & VK_SAMPLE_COUNT_2_BIT)
+        m_SampleCount = VK_SAMPLE_COUNT_2_BIT;
+
+    CreateRenderPass();
+    CreateSizedObjects(framebufferWidth, framebufferHeight);
+}
+
+SwapChain::~SwapChain()
+{
+    RetiredObjects current = TakeSizedObjects(0);
+    Destroy(current);
+    for (auto& retired : m_Retired)
+        Destroy(retired);
+    vkDestroyRenderPass(m_Device->GetDeviceHandle(), m_RenderPass, nullptr);
+}
+
+void SwapChain::Resize(uint32_t framebufferWidth, uint32_t framebufferHeight, uint64_t firstFrame)
+{
+    //The surface's capabilities change with the window, its formats do not
+    if (!IsHeadless())
+        m_Device->UpdateSwapChainSupportDetails(m_Surface);
+
+    //The old handle stays in m_SwapChain until the new one replaces it, so it is passed on as oldSwapchain
+    RetiredObjects retired = TakeSizedObjects(firstFrame);
+    m_SwapChain = retired.SwapChain;
+    CreateSizedObjects(framebufferWidth, framebufferHeight);
+    m_Retired.push_back(std::move(retired));
+}
+
+void SwapChain::ReleaseRetired(uint64_t completedFrame)
+{
+    //The presentation engine reports nothing back, but frame firstFrame was queued behind every present to the old swap
+    //chain, so once it has completed those presents have been consumed
+    while (!m_Retired.empty() && m_Retired.front().ReleaseFrame <= completedFrame) {
+        Destroy(m_Retired.front());
+        m_Retired.pop_front();
+    }
+}
+
+VkResult SwapChain::AcquireNextImage(VkSemaphore imageAvailable, uint32_t& imageIndex)
+{
+    if (IsHeadless()) {
+        imageIndex = m_NextOffscreenImage;
+        m_NextOffscreenImage = (m_NextOffscreenImage + 1) % m_Images.size();
+        return VK_SUCCESS;
+    }
+
+    return vkAcquireNextImageKHR(m_Device->GetDeviceHandle(), m_SwapChain, UINT64_MAX, imageAvailable, VK_NULL_HANDLE, &imageIndex);
+}
+
+VkResult SwapChain::Present(VkQueue queue, VkSemaphore renderFinished, uint32_t imageIndex)
+{
+    if (IsHeadless())
+        return VK_SUCCESS;
+
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &renderFinished;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &m_SwapChain;
+    presentInfo.pImageIndices = &imageIndex;
+
+    return vkQueuePresentKHR(queue, &presentInfo);
+}
+
+void SwapChain::CreateSizedObjects(uint32_t framebufferWidth, uint32_t framebufferHeight)
+{
+    if (IsHeadless())
+        CreateOffscreenImages(framebufferWidth, framebufferHeight);
+    else
+        CreateSwapChain(framebufferWidth, framebufferHeight);
+
+    m_ColorBuffer = MakeScopedPtr<Image>(m_Device, m_Extent.width, m_Extent.height, m_Format, 
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_SampleCount);
+    m_DepthBuffer = MakeScopedPtr<Image>(m_Device, m_Extent.width, m_Extent.height, Image::GetDepthFormat(m_Device),
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, m_SampleCount);
+    CreateFramebuffers();
+}
+
+void SwapChain::CreateOffscreenImages(uint32_t framebufferWidth, uint32_t framebufferHeight)
+{
+    m_Extent = { framebufferWidth, framebufferHeight };
+    m_NextOffscreenImage = 0;
+
+    for (uint32_t i = 0; i < HEADLESS_IMAGE_COUNT; i++) {
+        //Transfer source so a frame can be read back
+        m_OffscreenImages.push_back(MakeScopedPtr<Image>(m_Device, m_Extent.width, m_Extent.height, m_Format, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT));
+        m_Images.push_back(m_OffscreenImages.back()->GetImageHandle());
+        m_ImageViews.push_back(m_OffscreenImages.back()->GetViewHandle());
+    }
+}
+
+void SwapChain::CreateSwapChain(uint32_t framebufferWidth, uint32_t framebufferHeight)
+{
+    auto& details = m_Device->GetSwapChainSupportDetails();
     m_Extent = FindSwapExtent(details, framebufferWidth, framebufferHeight);
 
     uint32_t imageCount = details.Capabilities.minImageCount + 1;
-    imageCount = std::clamp(imageCount, details.Capabilities.minImageCount, details.Capabilities.maxImageCount);
+    //A maxImageCount of 0 means there is no limit
+    if (details.Capabilities.maxImageCount > 0)
+        imageCount = std::min(imageCount, details.Capabilities.maxImageCount);
 
     VkSwapchainCreateInfoKHR swapChainInfo{};
     swapChainInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-    swapChainInfo.surface = surface->GetSurfaceHandle();
+    swapChainInfo.surface = m_Surface;
     swapChainInfo.minImageCount = imageCount;
     swapChainInfo.imageFormat = m_Format;
-    swapChainInfo.imageColorSpace = surfaceFormat.colorSpace;
+    swapChainInfo.imageColorSpace = m_ColorSpace;
     swapChainInfo.imageExtent = m_Extent;
     swapChainInfo.imageArrayLayers = 1;
     swapChainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-    auto& queueFamilies = device->GetQueueFamilies();
+    auto& queueFamilies = m_Device->GetQueueFamilies();
     uint32_t queueFamilyIndices[] = { *queueFamilies.Graphics.Index, *queueFamilies.Present.Index };
 
     if (queueFamilyIndices[0] != queueFamilyIndices[1]) {
@@ -42,61 +169,66 @@ SwapChain::SwapChain(RefPtr<Device> device, ScopedPtr<Surface>& surface,
        
     swapChainInfo.preTransform = details.Capabilities.currentTransform;
     swapChainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    swapChainInfo.presentMode = presentMode;
+    swapChainInfo.presentMode = m_PresentMode;
     swapChainInfo.clipped = VK_TRUE;
-    swapChainInfo.oldSwapchain = nullptr;
+    //Lets the driver reuse the old swap chain's resources and keeps the frames already queued to it presenting
+    swapChainInfo.oldSwapchain = m_SwapChain;
 
-    RAYD_VK_VALIDATE(vkCreateSwapchainKHR(m_Device->GetDeviceHandle(), &swapChainInfo, nullptr, &m_SwapChain),
-        "Failed to create swap chain!");
+    VkSwapchainKHR swapChain;
+    VkResult result = vkCreateSwapchainKHR(m_Device->GetDeviceHandle(), &swapChainInfo, nullptr, &swapChain);
+    RAYD_VK_VALIDATE(result, "Failed to create swap chain!");
+    m_SwapChain = swapChain;
 
     vkGetSwapchainImagesKHR(m_Device->GetDeviceHandle(), m_SwapChain, &imageCount, nullptr);
     m_Images.resize(imageCount);
     vkGetSwapchainImagesKHR(m_Device->GetDeviceHandle(), m_SwapChain, &imageCount, m_Images.data());
 
-    m_Format = surfaceFormat.format;
-
     m_ImageViews.resize(m_Images.size());
 
     for (size_t i = 0; i < m_Images.size(); i++) 
         m_ImageViews[i] = Image::CreateImageView(m_Device, m_Images[i], m_Format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+}
 
-    VkPhysicalDeviceProperties physicalDeviceProperties;
-    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
-
-    VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts & physicalDeviceProperties.limits.framebufferDepthSampleCounts;
-    m_SampleCount = VK_SAMPLE_COUNT_1_BIT;
-    if(counts & VK_SAMPLE_COUNT_64_BIT) 
-        m_SampleCount = VK_SAMPLE_COUNT_64_BIT;
-    else if(counts & VK_SAMPLE_COUNT_32_BIT)
-        m_SampleCount = VK_SAMPLE_COUNT_32_BIT;
-    else if (counts & VK_SAMPLE_COUNT_16_BIT)
-        m_SampleCount = VK_SAMPLE_COUNT_16_BIT;
-    else if (counts & VK_SAMPLE_COUNT_8_BIT)
-        m_SampleCount = VK_SAMPLE_COUNT_8_BIT;
-    else if (counts & VK_SAMPLE_COUNT_4_BIT)
-        m_SampleCount = VK_SAMPLE_COUNT_4_BIT;
-    else if (counts & VK_SAMPLE_COUNT_2_BIT)
-        m_SampleCount = VK_SAMPLE_COUNT_2_BIT;
-
-    m_ColorBuffer = MakeScopedPtr<Image>(m_Device, m_Extent.width, m_Extent.height, m_Format, 
-        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_SampleCount);
-    m_DepthBuffer = MakeScopedPtr<Image>(m_Device, m_Extent.width, m_Extent.height, Image::GetDepthFormat(m_Device),
-        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, m_SampleCount);
-    CreateRenderPass();
-    CreateFramebuffers();
+SwapChain::RetiredObjects SwapChain::TakeSizedObjects(uint64_t releaseFrame)
+{
+    RetiredObjects objects;
+    objects.ReleaseFrame = releaseFrame;
+    objects.SwapChain = m_SwapChain;
+    //Offscreen images own their views
+    if (!IsHeadless())
+        objects.ImageViews = std::move(m_ImageViews);
+    objects.OffscreenImages = std::move(m_OffscreenImages);
+    objects.Framebuffers = std::move(m_Framebuffers);
+    objects.ColorBuffer = std::move(m_ColorBuffer);
+    objects.DepthBuffer = std::move(m_DepthBuffer);
+
+    m_SwapChain = VK_NULL_HANDLE;
+    m_ImageViews.clear();
+    m_OffscreenImages.clear();
+    m_Framebuffers.clear();
+    //Owned by the swap chain, which destroys them with itself
+    m_Images.clear();
+    return objects;
 }
 
-SwapChain::~SwapChain()
+void SwapChain::Destroy(RetiredObjects& objects)
 {
-    for (auto& framebuffer : m_Framebuffers)
+    for (auto& framebuffer : objects.Framebuffers)
         vkDestroyFramebuffer(m_Device->GetDeviceHandle(), framebuffer, nullptr);
+    objects.Framebuffers.clear();
 
-    vkDestroyRenderPass(m_Device->GetDeviceHandle(), m_RenderPass, nullptr);
+    objects.ColorBuffer.reset();
+    objects.DepthBuffer.reset();
 
-    for (auto& imageView : m_ImageViews) 
+    for (auto& imageView : objects.ImageViews) 
         vkDestroyImageView(m_Device->GetDeviceHandle(), imageView, nullptr);
+    objects.ImageViews.clear();
+    objects.OffscreenImages.clear();
 
-    vkDestroySwapchainKHR(m_Device->GetDeviceHandle(), m_SwapChain, nullptr);
+    //Headless devices never load the swap chain extension
+    if (objects.SwapChain)
+        vkDestroySwapchainKHR(m_Device->GetDeviceHandle(), objects.SwapChain, nullptr);
+    objects.SwapChain = VK_NULL_HANDLE;
 }
 
 VkSurfaceFormatKHR SwapChain::FindSurfaceFormat(const VkPhysicalDevice& physicalDevice, const SwapChainSupportDetails& details, VkSurfaceKHR& surface)
@@ -162,7 +294,8 @@ void SwapChain::CreateRenderPass()
     colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    //Headless frames are never presented, and PRESENT_SRC needs the swap chain extension
+    colorAttachmentResolve.finalLayout = IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentResolveRef{};
     colorAttachmentResolveRef.attachment = 2;
@@ -6,12 +6,30 @@
 #include "RenderPass.h"
 #include "Image.h"
 
+//Format, sample count and render pass are chosen once and outlive every resize, so pipelines built against the render
+//pass stay valid; only the objects sized to the window are recreated
 class SwapChain {
 public:
+	//Without a surface the swap chain is headless: it cycles through offscreen images with the same render pass and never
+	//presents them
 	SwapChain(RefPtr<Device> device, ScopedPtr<class Surface>& surface, 
 		uint32_t framebufferWidth, uint32_t framebufferHeight);
 	~SwapChain();
 
+	//Recreates the swap chain, its views, the multisampled color and depth targets and the framebuffers without waiting for
+	//the GPU. The old swap chain is handed to the new one and the old objects are kept until frame firstFrame, the first one
+	//rendered into the new swap chain, has completed
+	void Resize(uint32_t framebufferWidth, uint32_t framebufferHeight, uint64_t firstFrame);
+	//Destroys what earlier resizes retired, once completedFrame shows no frame still uses it
+	void ReleaseRetired(uint64_t completedFrame);
+	inline uint32_t GetRetiredCount() const { return static_cast<uint32_t>(m_Retired.size()); }
+
+	//Headless swap chains hand out the next image right away and leave the semaphores alone, so the caller neither waits
+	//on nor signals them
+	VkResult AcquireNextImage(VkSemaphore imageAvailable, uint32_t& imageIndex);
+	VkResult Present(VkQueue queue, VkSemaphore renderFinished, uint32_t imageIndex);
+	inline bool IsHeadless() const { return m_Surface == VK_NULL_HANDLE; }
+
 	inline const VkSwapchainKHR& GetSwapChainHandle() const { return m_SwapChain; }
 	inline const VkRenderPass& GetRenderPass() const { return m_RenderPass; }
 
@@ -22,17 +40,36 @@ public:
 	inline const std::vector<VkImage>& GetImages() const { return m_Images; }
 	inline const std::vector<VkImageView>& GetImageViews() const { return m_ImageViews; }
 	inline const std::vector<VkFramebuffer>& GetFramebuffers() const { return m_Framebuffers; }
+private:
+	//Objects sized to the window, set aside by a resize until the frames still using them have completed
+	struct RetiredObjects {
+		uint64_t ReleaseFrame;
+		VkSwapchainKHR SwapChain;
+		std::vector<VkImageView> ImageViews;
+		std::vector<VkFramebuffer> Framebuffers;
+		std::vector<ScopedPtr<Image>> OffscreenImages;
+		ScopedPtr<Image> ColorBuffer;
+		ScopedPtr<Image> DepthBuffer;
+	};
 private:
 	VkSurfaceFormatKHR FindSurfaceFormat(const VkPhysicalDevice& physicalDevice, const SwapChainSupportDetails& details, VkSurfaceKHR& surface);
 	VkPresentModeKHR FindPresentMode(const VkPhysicalDevice& physicalDevice, const SwapChainSupportDetails& details, VkSurfaceKHR& surface);
 	VkExtent2D FindSwapExtent(const SwapChainSupportDetails& details, uint32_t framebufferWidth, uint32_t framebufferHeight);
 	void CreateRenderPass();
 	void CreateFramebuffers();
+	void CreateSizedObjects(uint32_t framebufferWidth, uint32_t framebufferHeight);
+	void CreateSwapChain(uint32_t framebufferWidth, uint32_t framebufferHeight);
+	void CreateOffscreenImages(uint32_t framebufferWidth, uint32_t framebufferHeight);
+	RetiredObjects TakeSizedObjects(uint64_t releaseFrame);
+	void Destroy(RetiredObjects& objects);
 private:
 	RefPtr<Device> m_Device;
+	VkSurfaceKHR m_Surface;
 
 	VkSwapchainKHR m_SwapChain;
 	VkFormat m_Format;
+	VkColorSpaceKHR m_ColorSpace;
+	VkPresentModeKHR m_PresentMode;
 	VkExtent2D m_Extent;
 	VkSampleCountFlagBits m_SampleCount;
 
@@ -41,6 +78,11 @@ private:
 	std::vector<VkImage> m_Images;
 	std::vector<VkImageView> m_ImageViews;
 	std::vector<VkFramebuffer> m_Framebuffers;
+	//Stand in for the swap chain's images when headless; their views are the ones in m_ImageViews
+	std::vector<ScopedPtr<Image>> m_OffscreenImages;
+	uint32_t m_NextOffscreenImage = 0;
 	ScopedPtr<Image> m_ColorBuffer;
 	ScopedPtr<Image> m_DepthBuffer;
+
+	std::deque<RetiredObjects> m_Retired;
 };
\ No newline at end of file
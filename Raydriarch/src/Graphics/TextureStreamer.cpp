@@ -0,0 +1,235 @@
+#include "raydpch.h"
+#include "TextureStreamer.h"
+
+TextureStreamer::TextureStreamer(RefPtr<Device> device, VkDeviceSize budget, RefPtr<ThreadPool> workers)
+	:m_Device(device), m_Budget(budget), m_Frame(1), m_Promotions(0), m_Evictions(0), m_Workers(workers)
+{
+	//Mid grey, so a texture that is still baking reads as untextured rather than black
+	const uint8_t grey[4] = { 128, 128, 128, 255 };
+	TextureCacheLevel level{ 1, 1, 0, sizeof(grey) };
+	m_Placeholder = MakeRefPtr<Image>(m_Device, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, 1);
+	m_Placeholder->Transition(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	m_Placeholder->CopyLevels(Upload::Stage(grey, sizeof(grey), sizeof(grey)), &level, 0, 1);
+	m_Placeholder->Transition(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	//Jobs write into the textures and the completed list, so none may outlive them
+	for (auto& texture : m_Textures)
+		if (texture->m_Job)
+			m_Workers->Wait(texture->m_Job);
+}
+
+RefPtr<StreamedTexture> TextureStreamer::Load(const std::string& path, TextureFormat format, bool srgb)
+{
+	RAYD_PROFILE_SCOPE("TextureStreamer::Load");
+	//Same choices as a fully loaded Image, so both share one cache file
+	srgb = srgb && format != TextureFormat::BC5;
+	if (!m_Device->SupportsTextureCompressionBC())
+		format = TextureFormat::RGBA8;
+
+	RefPtr<StreamedTexture> texture = MakeRefPtr<StreamedTexture>();
+	texture->m_Path = path;
+	texture->m_Format = format;
+	texture->m_Srgb = srgb;
+	texture->m_VkFormat = Image::GetTextureFormat(format, srgb);
+	texture->m_Placeholder = m_Placeholder;
+	m_Textures.push_back(texture);
+
+	LoadResult result{ texture.get(), MakeScopedPtr<TextureCache>(TextureCache::GetCachePath(path), path, format, srgb), 0, 0, {} };
+	if (result.Cache->IsValid()) {
+		Apply(result);
+		return texture;
+	}
+
+	//Baking decodes and encodes the whole chain, which is exactly the startup cost streaming avoids
+	texture->m_Loading = true;
+	texture->m_Job = m_Workers->Schedule("bake " + std::filesystem::path(path).filename().string(), [this, target = texture.get(), path, format, srgb]() {
+		LoadResult result{ target, nullptr, 0, 0, {} };
+		BakedTexture baked;
+		if (TextureCache::Bake(path, format, srgb, baked, m_Workers.get()))
+			result.Cache = MakeScopedPtr<TextureCache>(TextureCache::GetCachePath(path), path, format, srgb);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Completed.push_back(std::move(result));
+	});
+	return texture;
+}
+
+void TextureStreamer::Request(StreamedTexture& texture, float screenExtent)
+{
+	texture.m_LastUsed = m_Frame;
+	if (!texture.m_Cache)
+		return;
+
+	//The finest level at least as large as the extent, so the texture is never magnified by streaming
+	const TextureCacheLevel& base = texture.m_Cache->GetHeader().Levels[0];
+	float texels = static_cast<float>(std::max(base.Width, base.Height));
+	uint32_t mip = screenExtent >= texels ? 0 : static_cast<uint32_t>(std::floor(std::log2(texels / std::max(screenExtent, 1.0f))));
+	texture.m_RequestedMip = std::min(texture.m_RequestedMip, std::min(mip, texture.m_TailMip));
+}
+
+void TextureStreamer::Update()
+{
+	std::vector<LoadResult> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		completed.swap(m_Completed);
+	}
+	for (auto& result : completed)
+		Apply(result);
+
+	Plan();
+
+	for (auto& texture : m_Textures)
+		texture->m_RequestedMip = UINT32_MAX;
+	m_Frame++;
+}
+
+void TextureStreamer::Plan()
+{
+	//Tails always stay; what is left of the budget goes to textures in order of most recent use, so the ones unused the
+	//longest are the first to lose levels
+	std::vector<StreamedTexture*> order;
+	VkDeviceSize remaining = m_Budget;
+	for (auto& texture : m_Textures)
+		if (texture->m_Cache) {
+			order.push_back(texture.get());
+			VkDeviceSize tail = GetChainSize(*texture, texture->m_TailMip);
+			remaining -= std::min(remaining, tail);
+		}
+	std::stable_sort(order.begin(), order.end(), [](StreamedTexture* a, StreamedTexture* b) { return a->m_LastUsed > b->m_LastUsed; });
+
+	for (StreamedTexture* texture : order) {
+		//Textures nothing drew with this frame keep what they have until the budget needs it
+		uint32_t wanted = texture->m_RequestedMip != UINT32_MAX ? texture->m_RequestedMip : texture->m_ResidentMip;
+		VkDeviceSize tail = GetChainSize(*texture, texture->m_TailMip);
+		uint32_t mip = wanted;
+		while (mip < texture->m_TailMip && GetChainSize(*texture, mip) - tail > remaining)
+			mip++;
+		remaining -= GetChainSize(*texture, mip) - tail;
+		texture->m_TargetMip = mip;
+
+		if (mip > texture->m_ResidentMip) {
+			//Evicting only copies the levels that stay, so it never waits on the disk
+			Rebuild(*texture, mip);
+			m_Evictions++;
+		}
+		else if (mip < texture->m_ResidentMip && !texture->m_Loading) {
+			texture->m_Loading = true;
+			uint32_t first = mip;
+			uint32_t last = texture->m_ResidentMip;
+			std::string name = "stream " + std::filesystem::path(texture->m_Path).filename().string() + " mips " + std::to_string(first) + "-" + std::to_string(last - 1);
+			texture->m_Job = m_Workers->Schedule(name, [this, texture, first, last]() {
+				//Copying out of the mapping faults its pages in here instead of on the render thread
+				const TextureCacheHeader& header = texture->m_Cache->GetHeader();
+				const uint8_t* data = texture->m_Cache->GetData();
+				LoadResult result{ texture, nullptr, first, last, {} };
+				result.Data.assign(data + header.Levels[first].Offset, data + header.Levels[last - 1].Offset + header.Levels[last - 1].Size);
+
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Completed.push_back(std::move(result));
+			});
+		}
+	}
+}
+
+void TextureStreamer::Apply(LoadResult& result)
+{
+	RAYD_PROFILE_SCOPE("TextureStreamer::Apply");
+	StreamedTexture& texture = *result.Texture;
+	texture.m_Loading = false;
+	texture.m_Job.reset();
+
+	if (result.Cache) {
+		if (!result.Cache->IsValid()) {
+			RAYD_ERROR("Failed to bake texture {0}", texture.m_Path);
+			return;
+		}
+
+		texture.m_Cache = std::move(result.Cache);
+		const TextureCacheHeader& header = texture.m_Cache->GetHeader();
+		texture.m_TailMip = header.LevelCount - 1;
+		while (texture.m_TailMip > 0 && std::max(header.Levels[texture.m_TailMip - 1].Width, header.Levels[texture.m_TailMip - 1].Height) <= TEXTURE_STREAM_TAIL_SIZE)
+			texture.m_TailMip--;
+
+		//The tail is small enough to read from the mapping right here
+		texture.m_TargetMip = texture.m_TailMip;
+		Rebuild(texture, texture.m_TailMip, texture.m_Cache->GetData() + header.Levels[texture.m_TailMip].Offset);
+		return;
+	}
+
+	//The budget may have shrunk, or the texture lost levels, while the job ran; the data then either goes partly unused
+	//or no longer reaches the resident levels and the next plan asks again
+	const TextureCacheLevel* levels = texture.m_Cache->GetHeader().Levels;
+	uint32_t mip = std::max(result.FirstMip, texture.m_TargetMip);
+	if (mip >= texture.m_ResidentMip || result.EndMip < texture.m_ResidentMip)
+		return;
+
+	Rebuild(texture, mip, result.Data.data() + (levels[mip].Offset - levels[result.FirstMip].Offset));
+	m_Promotions++;
+}
+
+void TextureStreamer::Rebuild(StreamedTexture& texture, uint32_t mip, const uint8_t* data)
+{
+	const TextureCacheHeader& header = texture.m_Cache->GetHeader();
+	const TextureCacheLevel* levels = header.Levels;
+	VkFormat format = texture.m_VkFormat;
+
+	RefPtr<Image> image = MakeRefPtr<Image>(m_Device, levels[mip].Width, levels[mip].Height, format, header.LevelCount - mip);
+	image->Transition(format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	//Levels finer than what the old image holds come from data, the rest from the old image
+	RefPtr<Image> old = texture.m_Image;
+	uint32_t oldMip = old ? texture.m_ResidentMip : header.LevelCount;
+	uint32_t sharedMip = std::max(mip, oldMip);
+	uint32_t stagedCount = sharedMip - mip;
+	if (stagedCount > 0) {
+		RAYD_ASSERT(data, "Texture levels missing from a streaming rebuild!");
+		const TextureCacheLevel& last = levels[sharedMip - 1];
+		StagingRegion staging = Upload::Stage(data, last.Offset + last.Size - levels[mip].Offset, TEXTURE_CACHE_ALIGNMENT);
+		image->CopyLevels(staging, &levels[mip], 0, stagedCount);
+	}
+
+	if (old) {
+		//Only the levels being copied leave the sampled layout; the old image is released with the batch that reads it,
+		//which is ordered after every frame that could still sample it
+		uint32_t sharedCount = header.LevelCount - sharedMip;
+		old->Transition(format, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, sharedMip - oldMip, sharedCount);
+		image->CopyLevels(*old, sharedMip - oldMip, stagedCount, sharedCount);
+		Upload::OnComplete([old]() {});
+	}
+
+	image->Transition(format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	texture.m_Image = image;
+	texture.m_ResidentMip = mip;
+	texture.m_ResidentBytes = GetChainSize(texture, mip);
+}
+
+VkDeviceSize TextureStreamer::GetChainSize(const StreamedTexture& texture, uint32_t mip) const
+{
+	const TextureCacheHeader& header = texture.m_Cache->GetHeader();
+	VkDeviceSize size = 0;
+	for (uint32_t i = mip; i < header.LevelCount; i++)
+		size += header.Levels[i].Size;
+	return size;
+}
+
+TextureStreamStats TextureStreamer::GetStats() const
+{
+	TextureStreamStats stats{ static_cast<uint32_t>(m_Textures.size()), 0, 0, m_Budget, m_Promotions, m_Evictions };
+	for (auto& texture : m_Textures) {
+		stats.Loading += texture->m_Loading ? 1 : 0;
+		stats.ResidentBytes += texture->m_ResidentBytes;
+	}
+	return stats;
+}
+
+bool TextureStreamer::IsSettled() const
+{
+	for (auto& texture : m_Textures)
+		if (texture->m_Loading || (texture->m_Cache && texture->m_ResidentMip != texture->m_TargetMip))
+			return false;
+	return true;
+}
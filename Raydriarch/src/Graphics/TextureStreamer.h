@@ -0,0 +1,103 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Image.h"
+#include "Core/ThreadPool.h"
+#include "Asset/TextureCache.h"
+
+//Levels no larger than this on either side form the mip tail, which is loaded up front and never evicted
+#define TEXTURE_STREAM_TAIL_SIZE 128
+
+struct TextureStreamStats {
+	uint32_t TextureCount;
+	uint32_t Loading;
+	VkDeviceSize ResidentBytes;
+	VkDeviceSize Budget;
+	uint32_t Promotions;
+	uint32_t Evictions;
+};
+
+//Texture whose image holds only its finest resident level and the levels below it
+class StreamedTexture {
+public:
+	//Until the cache has been baked this is a shared placeholder
+	inline VkImageView GetView() const { return m_Image ? m_Image->GetViewHandle() : m_Placeholder->GetViewHandle(); }
+	inline uint32_t GetLevelCount() const { return m_Cache ? m_Cache->GetHeader().LevelCount : 0; }
+	//Index into the full chain of the finest level the image holds
+	inline uint32_t GetResidentMip() const { return m_ResidentMip; }
+	inline VkDeviceSize GetResidentBytes() const { return m_ResidentBytes; }
+private:
+	friend class TextureStreamer;
+
+	std::string m_Path;
+	TextureFormat m_Format;
+	bool m_Srgb;
+	VkFormat m_VkFormat;
+	ScopedPtr<TextureCache> m_Cache;
+	RefPtr<Image> m_Image;
+	RefPtr<Image> m_Placeholder;
+
+	uint32_t m_ResidentMip = 0;
+	uint32_t m_TailMip = 0;
+	//Finest level the budget currently grants
+	uint32_t m_TargetMip = 0;
+	//Finest level asked for this frame; UINT32_MAX when nothing drew with the texture
+	uint32_t m_RequestedMip = UINT32_MAX;
+	uint64_t m_LastUsed = 0;
+	VkDeviceSize m_ResidentBytes = 0;
+	bool m_Loading = false;
+	//Bake or level read in flight, set while m_Loading is
+	RefPtr<Job> m_Job;
+};
+
+//Keeps textures resident at the detail their on-screen size needs. Only the mip tail is uploaded when a texture is
+//loaded; finer levels are read from the cache on background threads as draws ask for them, and the least recently
+//used textures give levels back whenever the total would exceed the budget. Changing residency replaces the image with
+//one sized for the new level count, copying the levels both share on the GPU so only new levels are staged.
+class TextureStreamer {
+public:
+	TextureStreamer(RefPtr<Device> device, VkDeviceSize budget, RefPtr<ThreadPool> workers);
+	~TextureStreamer();
+
+	//Uploads the tail from the cache right away, or bakes the cache in the background and shows a placeholder meanwhile
+	RefPtr<StreamedTexture> Load(const std::string& path, TextureFormat format = TextureFormat::BC7, bool srgb = true);
+	//Asks for enough detail to cover screenExtent pixels with the texture's full width; the finest request of a frame wins
+	void Request(StreamedTexture& texture, float screenExtent);
+	//Applies finished loads, plans residency against the budget and starts the loads it needs; records into the pending
+	//upload batch, so call it before that batch is flushed for the frame
+	void Update();
+
+	inline void SetBudget(VkDeviceSize budget) { m_Budget = budget; }
+	TextureStreamStats GetStats() const;
+	//True when no bake or level read is in flight and every texture holds the levels the last plan granted it
+	bool IsSettled() const;
+private:
+	struct LoadResult {
+		StreamedTexture* Texture;
+		//Set when the texture's cache has just been opened or baked
+		ScopedPtr<TextureCache> Cache;
+		//Data holds levels [FirstMip, EndMip)
+		uint32_t FirstMip;
+		uint32_t EndMip;
+		std::vector<uint8_t> Data;
+	};
+
+	void Plan();
+	void Apply(LoadResult& result);
+	//Replaces the texture's image with one holding [mip, levelCount), staging the levels in data that the old image lacks
+	void Rebuild(StreamedTexture& texture, uint32_t mip, const uint8_t* data = nullptr);
+	VkDeviceSize GetChainSize(const StreamedTexture& texture, uint32_t mip) const;
+private:
+	RefPtr<Device> m_Device;
+	VkDeviceSize m_Budget;
+	uint64_t m_Frame;
+	uint32_t m_Promotions;
+	uint32_t m_Evictions;
+
+	std::vector<RefPtr<StreamedTexture>> m_Textures;
+	RefPtr<Image> m_Placeholder;
+
+	RefPtr<ThreadPool> m_Workers;
+	std::mutex m_Mutex;
+	std::vector<LoadResult> m_Completed;
+};
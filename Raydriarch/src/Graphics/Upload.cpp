@@ -0,0 +1,314 @@
+#include "raydpch.h"
+#include "Upload.h"
+
+#include "StagingRing.h"
+#include "Command.h"
+#include "GpuProfiler.h"
+
+struct UploadBatch {
+	VkCommandBuffer TransferCommands;
+	VkCommandBuffer GraphicsCommands;
+	VkSemaphore TransferDone;
+	VkFence Fence;
+	UploadToken Token;
+	//Spans the graphics side of the batch; transfer queue copies are not timed
+	uint64_t Scope;
+	std::vector<std::function<void()>> Callbacks;
+};
+
+static struct UploadObjects {
+	RefPtr<Device> GPU;
+	VkCommandPool TransferPool;
+	VkCommandPool GraphicsPool;
+	bool Dedicated;
+
+	ScopedPtr<StagingRing> Staging;
+	uint32_t StagingStalls = 0;
+	uint32_t StagingGrows = 0;
+
+	ScopedPtr<UploadBatch> Recording;
+	std::deque<ScopedPtr<UploadBatch>> InFlight;
+	std::vector<ScopedPtr<UploadBatch>> Free;
+
+	UploadToken NextToken = 1;
+	UploadToken CompletedToken = 0;
+}*s_Objects = new UploadObjects;
+
+static VkCommandPool CreatePool(uint32_t queueFamily)
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+
+	VkCommandPool pool;
+	VkResult result = vkCreateCommandPool(s_Objects->GPU->GetDeviceHandle(), &poolInfo, nullptr, &pool);
+	RAYD_VK_VALIDATE(result, "Failed to create upload command pool!");
+	return pool;
+}
+
+static VkCommandBuffer AllocateCommands(VkCommandPool pool)
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = pool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	VkResult result = vkAllocateCommandBuffers(s_Objects->GPU->GetDeviceHandle(), &allocInfo, &commandBuffer);
+	RAYD_VK_VALIDATE(result, "Failed to allocate upload command buffer!");
+	return commandBuffer;
+}
+
+static void BeginBatch()
+{
+	auto device = s_Objects->GPU->GetDeviceHandle();
+
+	if (!s_Objects->Free.empty()) {
+		s_Objects->Recording = std::move(s_Objects->Free.back());
+		s_Objects->Free.pop_back();
+		vkResetFences(device, 1, &s_Objects->Recording->Fence);
+	}
+	else {
+		s_Objects->Recording = MakeScopedPtr<UploadBatch>();
+		auto& batch = s_Objects->Recording;
+		batch->TransferCommands = AllocateCommands(s_Objects->TransferPool);
+		batch->GraphicsCommands = s_Objects->Dedicated ? AllocateCommands(s_Objects->GraphicsPool) : batch->TransferCommands;
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkResult result = vkCreateFence(device, &fenceInfo, nullptr, &batch->Fence);
+		RAYD_VK_VALIDATE(result, "Failed to create upload fence!");
+
+		batch->TransferDone = VK_NULL_HANDLE;
+		if (s_Objects->Dedicated) {
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			result = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch->TransferDone);
+			RAYD_VK_VALIDATE(result, "Failed to create upload semaphore!");
+		}
+	}
+
+	auto& batch = s_Objects->Recording;
+	batch->Token = s_Objects->NextToken++;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(batch->TransferCommands, &beginInfo);
+	if (s_Objects->Dedicated)
+		vkBeginCommandBuffer(batch->GraphicsCommands, &beginInfo);
+	batch->Scope = GpuProfiler::BeginScope(batch->GraphicsCommands, "upload");
+}
+
+static void Retire()
+{
+	auto device = s_Objects->GPU->GetDeviceHandle();
+
+	while (!s_Objects->InFlight.empty()) {
+		auto& batch = s_Objects->InFlight.front();
+		if (vkGetFenceStatus(device, batch->Fence) != VK_SUCCESS)
+			break;
+
+		for (auto& callback : batch->Callbacks)
+			callback();
+		batch->Callbacks.clear();
+
+		s_Objects->CompletedToken = batch->Token;
+		s_Objects->Free.push_back(std::move(batch));
+		s_Objects->InFlight.pop_front();
+	}
+
+	s_Objects->Staging->Reclaim(s_Objects->CompletedToken);
+}
+
+void Upload::Init(RefPtr<Device> device, VkDeviceSize stagingSize)
+{
+	s_Objects->GPU = device;
+	s_Objects->Dedicated = device->HasDedicatedTransferQueue();
+	s_Objects->Staging = MakeScopedPtr<StagingRing>(device, stagingSize);
+
+	auto& queueFamilies = device->GetQueueFamilies();
+	s_Objects->TransferPool = CreatePool(*queueFamilies.Transfer.Index);
+	s_Objects->GraphicsPool = s_Objects->Dedicated ? CreatePool(*queueFamilies.Graphics.Index) : s_Objects->TransferPool;
+
+	if (s_Objects->Dedicated)
+		RAYD_INFO("Uploading through dedicated transfer queue family {0}", *queueFamilies.Transfer.Index);
+}
+
+void Upload::Shutdown()
+{
+	Wait(Flush());
+
+	auto stats = GetStagingStats();
+	RAYD_INFO("Staging ring: {0:.1f} MB capacity, {1:.1f} MB peak in flight, {2} stalls, {3} grows", stats.Capacity / (1024.0 * 1024.0),
+		stats.PeakBytesInFlight / (1024.0 * 1024.0), stats.Stalls, stats.Grows);
+	s_Objects->Staging.reset();
+
+	auto device = s_Objects->GPU->GetDeviceHandle();
+	for (auto& batch : s_Objects->Free) {
+		vkDestroyFence(device, batch->Fence, nullptr);
+		if (batch->TransferDone)
+			vkDestroySemaphore(device, batch->TransferDone, nullptr);
+	}
+
+	vkDestroyCommandPool(device, s_Objects->TransferPool, nullptr);
+	if (s_Objects->Dedicated)
+		vkDestroyCommandPool(device, s_Objects->GraphicsPool, nullptr);
+
+	delete s_Objects;
+}
+
+VkCommandBuffer Upload::GetTransferCommands()
+{
+	if (!s_Objects->Recording)
+		BeginBatch();
+
+	return s_Objects->Recording->TransferCommands;
+}
+
+VkCommandBuffer Upload::GetGraphicsCommands()
+{
+	if (!s_Objects->Recording)
+		BeginBatch();
+
+	return s_Objects->Recording->GraphicsCommands;
+}
+
+StagingRegion Upload::Stage(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+{
+	UploadToken token = GetPendingToken();
+	auto& ring = s_Objects->Staging;
+
+	StagingRegion region;
+	while (!ring->Allocate(size, alignment, token, region)) {
+		if (!s_Objects->InFlight.empty()) {
+			//Ring is full of earlier batches; wait for the oldest one to hand its space back
+			s_Objects->StagingStalls++;
+			auto& oldest = s_Objects->InFlight.front();
+			vkWaitForFences(s_Objects->GPU->GetDeviceHandle(), 1, &oldest->Fence, VK_TRUE, UINT64_MAX);
+			Retire();
+		}
+		else {
+			//Only the batch being recorded holds space, so waiting can't help
+			s_Objects->StagingGrows++;
+			auto old = ring->Grow(size + alignment);
+			OnComplete([buffer = std::shared_ptr<StagingBuffer>(std::move(old))]() {});
+		}
+	}
+
+	memcpy(region.Mapped, data, size);
+	return region;
+}
+
+StagingStats Upload::GetStagingStats()
+{
+	auto& ring = s_Objects->Staging;
+	return { ring->GetCapacity(), ring->GetBytesInFlight(), ring->GetPeakBytesInFlight(), s_Objects->StagingStalls, s_Objects->StagingGrows };
+}
+
+void Upload::OnComplete(std::function<void()> callback)
+{
+	if (!s_Objects->Recording)
+		BeginBatch();
+
+	s_Objects->Recording->Callbacks.push_back(std::move(callback));
+}
+
+UploadToken Upload::GetPendingToken()
+{
+	if (!s_Objects->Recording)
+		BeginBatch();
+
+	return s_Objects->Recording->Token;
+}
+
+UploadToken Upload::Flush()
+{
+	if (!s_Objects->Recording)
+		return s_Objects->NextToken - 1;
+
+	auto& batch = s_Objects->Recording;
+	auto& queueFamilies = s_Objects->GPU->GetQueueFamilies();
+
+	//Makes everything this batch wrote visible to the draws that consume it
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	Command::PipelineBarrier(batch->GraphicsCommands,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+	GpuProfiler::EndScope(batch->GraphicsCommands, batch->Scope);
+
+	vkEndCommandBuffer(batch->TransferCommands);
+
+	if (s_Objects->Dedicated) {
+		vkEndCommandBuffer(batch->GraphicsCommands);
+
+		VkSubmitInfo transferSubmit{};
+		transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		transferSubmit.commandBufferCount = 1;
+		transferSubmit.pCommandBuffers = &batch->TransferCommands;
+		transferSubmit.signalSemaphoreCount = 1;
+		transferSubmit.pSignalSemaphores = &batch->TransferDone;
+		VkResult result = Command::Submit(queueFamilies.Transfer.Queue, 1, &transferSubmit, VK_NULL_HANDLE);
+		RAYD_VK_VALIDATE(result, "Failed to submit transfer batch!");
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		VkSubmitInfo graphicsSubmit{};
+		graphicsSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		graphicsSubmit.waitSemaphoreCount = 1;
+		graphicsSubmit.pWaitSemaphores = &batch->TransferDone;
+		graphicsSubmit.pWaitDstStageMask = &waitStage;
+		graphicsSubmit.commandBufferCount = 1;
+		graphicsSubmit.pCommandBuffers = &batch->GraphicsCommands;
+		result = Command::Submit(queueFamilies.Graphics.Queue, 1, &graphicsSubmit, batch->Fence);
+		RAYD_VK_VALIDATE(result, "Failed to submit upload batch!");
+	}
+	else {
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch->TransferCommands;
+		VkResult result = Command::Submit(queueFamilies.Graphics.Queue, 1, &submitInfo, batch->Fence);
+		RAYD_VK_VALIDATE(result, "Failed to submit upload batch!");
+	}
+
+	UploadToken token = batch->Token;
+	s_Objects->InFlight.push_back(std::move(s_Objects->Recording));
+	Retire();
+
+	return token;
+}
+
+bool Upload::IsComplete(UploadToken token)
+{
+	Retire();
+	return token <= s_Objects->CompletedToken;
+}
+
+bool Upload::IsIdle()
+{
+	Retire();
+	return !s_Objects->Recording && s_Objects->InFlight.empty();
+}
+
+void Upload::Wait(UploadToken token)
+{
+	if (s_Objects->Recording && token >= s_Objects->Recording->Token)
+		Flush();
+
+	auto device = s_Objects->GPU->GetDeviceHandle();
+	for (auto& batch : s_Objects->InFlight) {
+		if (batch->Token > token)
+			break;
+		vkWaitForFences(device, 1, &batch->Fence, VK_TRUE, UINT64_MAX);
+	}
+
+	Retire();
+}
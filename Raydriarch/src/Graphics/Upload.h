@@ -0,0 +1,46 @@
+#pragma once
+
+#include "GraphicsCore.h"
+#include "Device.h"
+
+using UploadToken = uint64_t;
+
+struct StagingRegion {
+	VkBuffer Buffer;
+	VkDeviceSize Offset;
+	void* Mapped;
+};
+
+struct StagingStats {
+	VkDeviceSize Capacity;
+	VkDeviceSize BytesInFlight;
+	VkDeviceSize PeakBytesInFlight;
+	uint32_t Stalls;
+	uint32_t Grows;
+};
+
+//Batches copies, layout transitions and mip blits into one submission instead of a queue stall per resource
+class Upload {
+public:
+	Upload() = delete;
+	static void Init(RefPtr<Device> device, VkDeviceSize stagingSize = 32 * 1024 * 1024);
+	static void Shutdown();
+
+	//Runs on the dedicated transfer queue when the device exposes one
+	static VkCommandBuffer GetTransferCommands();
+	//Blits and transitions into shader-readable layouts need a graphics-capable queue
+	static VkCommandBuffer GetGraphicsCommands();
+	//Copies data into the staging ring; the region stays valid until the current batch completes
+	static StagingRegion Stage(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+	static StagingStats GetStagingStats();
+	//Invoked once the batch currently being recorded has finished executing on the GPU
+	static void OnComplete(std::function<void()> callback);
+
+	//Token the batch currently being recorded will complete with
+	static UploadToken GetPendingToken();
+	static UploadToken Flush();
+	static bool IsComplete(UploadToken token);
+	static void Wait(UploadToken token);
+	//True when nothing is being recorded and every submitted batch has finished
+	static bool IsIdle();
+};
@@ -4,5 +4,22 @@
 #include <iostream>
 #include <optional>
 #include <fstream>
+#include <mutex>
+#include <set>
+#include <map>
+#include <array>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <charconv>
+#include <atomic>
 
-#include "Core/Log.h"
\ No newline at end of file
+#include "Core/Log.h"
+#include "Core/Profiler.h"
\ No newline at end of file
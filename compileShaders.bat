@@ -1,4 +1,24 @@
-call Vulkan\glslc.exe Raydriarch\res\shaders\Basic.vert -o Raydriarch\res\shaders\vert.spv
-call Vulkan\glslc.exe Raydriarch\res\shaders\Basic.frag -o Raydriarch\res\shaders\frag.spv
+@echo off
+rem Rebuilds the SPIR-V the renderer loads. Prefers the bundled glslc, then the Vulkan SDK's. The build passes "nopause"
+rem so it is never left waiting on a key press.
+setlocal
+pushd "%~dp0"
+set RESULT=0
+set "GLSLC=Vulkan\glslc.exe"
+if not exist "%GLSLC%" set "GLSLC=%VULKAN_SDK%\Bin\glslc.exe"
+if not exist "%GLSLC%" goto missing
 
-PAUSE
\ No newline at end of file
+call "%GLSLC%" Raydriarch\res\shaders\Basic.vert -o Raydriarch\res\shaders\vert.spv || set RESULT=1
+call "%GLSLC%" Raydriarch\res\shaders\Basic.frag -o Raydriarch\res\shaders\frag.spv || set RESULT=1
+call "%GLSLC%" Raydriarch\res\shaders\Cull.comp -o Raydriarch\res\shaders\cull.spv || set RESULT=1
+call "%GLSLC%" Raydriarch\res\shaders\Meshlet.comp -o Raydriarch\res\shaders\meshlet.spv || set RESULT=1
+goto end
+
+:missing
+echo error: glslc was not found in Vulkan\ or %%VULKAN_SDK%%\Bin; install the Vulkan SDK to build the shaders
+set RESULT=1
+
+:end
+popd
+if not "%~1"=="nopause" PAUSE
+exit /b %RESULT%
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Rebuilds the SPIR-V the renderer loads, like compileShaders.bat. Uses glslc from the Vulkan SDK when VULKAN_SDK is
+# set and from the PATH otherwise.
+cd "$(dirname "$0")" || exit 1
+
+if [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/glslc" ]; then
+	GLSLC="$VULKAN_SDK/bin/glslc"
+elif command -v glslc >/dev/null 2>&1; then
+	GLSLC=glslc
+else
+	echo "error: glslc was not found in \$VULKAN_SDK/bin or on the PATH; install the Vulkan SDK to build the shaders" >&2
+	exit 1
+fi
+
+SHADERS=Raydriarch/res/shaders
+RESULT=0
+"$GLSLC" $SHADERS/Basic.vert -o $SHADERS/vert.spv || RESULT=1
+"$GLSLC" $SHADERS/Basic.frag -o $SHADERS/frag.spv || RESULT=1
+"$GLSLC" $SHADERS/Cull.comp -o $SHADERS/cull.spv || RESULT=1
+"$GLSLC" $SHADERS/Meshlet.comp -o $SHADERS/meshlet.spv || RESULT=1
+exit $RESULT
@@ -13,6 +13,12 @@ workspace "Raydriarch"
 		"MultiProcessorCompile"
 	}
 
+newoption
+{
+	trigger = "profile",
+	description = "Compile the CPU profiler into Raydriarch so --trace records zones"
+}
+
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
 -- Rendering/Display includes
@@ -60,8 +66,6 @@ project "Raydriarch"
 		"GLFW_INCLUDE_VULKAN"
 	}
 
-	libdirs { "Raydriarch/vendor/Vulkan/lib" }
-
 	includedirs
 	{
 		"%{prj.name}/src",
@@ -76,8 +80,7 @@ project "Raydriarch"
 
 	links 
 	{ 
-		"GLFW",
-		"vulkan-1.lib"
+		"GLFW"
 	}
 
 	filter "system:windows"
@@ -87,6 +90,83 @@ project "Raydriarch"
 		{
 		}
 
+		libdirs { "Raydriarch/vendor/Vulkan/lib" }
+		links { "vulkan-1.lib" }
+
+		-- Shaders are recompiled before every build so the SPIR-V never falls behind its GLSL; a missing glslc fails
+		-- the build
+		prebuildcommands { "call ..\\compileShaders.bat nopause" }
+
+	filter "system:not windows"
+		prebuildcommands { "sh ../compileShaders.sh" }
+
+	-- The loader comes from the system's Vulkan package; the static GLFW build needs X11 and dl, and the worker
+	-- threads need pthread
+	filter "system:linux"
+		links { "vulkan", "X11", "dl", "pthread" }
+
+	filter "configurations:Debug"
+		defines "RAYD_DEBUG"
+		runtime "Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		defines "RAYD_RELEASE"
+		runtime "Release"
+		optimize "on"
+
+	-- Raydriarch only: RaydBench does not compile Profiler.cpp
+	filter "options:profile"
+		defines "RAYD_PROFILE"
+
+project "RaydBench"
+	location "RaydBench"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	-- CPU-only: shares the asset pipeline with the engine but never touches Vulkan or a window
+	files
+	{
+		"%{prj.name}/src/**.h",
+		"%{prj.name}/src/**.cpp",
+		"Raydriarch/src/Asset/**.h",
+		"Raydriarch/src/Asset/**.cpp",
+		"Raydriarch/src/Core/Log.h",
+		"Raydriarch/src/Core/Log.cpp",
+		"Raydriarch/src/Core/MappedFile.h",
+		"Raydriarch/src/Core/MappedFile.cpp",
+		"Raydriarch/src/Core/ThreadPool.h",
+		"Raydriarch/src/Core/ThreadPool.cpp",
+		"Raydriarch/vendor/stb/**.h",
+		"Raydriarch/vendor/stb/**.cpp"
+	}
+
+	defines
+	{
+		"_CRT_SECURE_NO_WARNINGS"
+	}
+
+	includedirs
+	{
+		"%{prj.name}/src",
+		"Raydriarch/src",
+		"%{IncludeDir.spdlog}",
+		"%{IncludeDir.glm}",
+		"%{IncludeDir.stb}",
+		"%{IncludeDir.tinyobjloader}"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "system:linux"
+		links { "pthread" }
+
 	filter "configurations:Debug"
 		defines "RAYD_DEBUG"
 		runtime "Debug"